@@ -0,0 +1,318 @@
+/*
+ * bench.c - Editor Keystroke and DOS Call Micro-Benchmarks
+ * Times typing into a full-size buffer with a whole-text line rescan per
+ * keystroke (the old parse_lines approach) against the incremental index,
+ * and the int86() path against the inline INT 21h calls (int21.h) for
+ * directory enumeration, copy loops and keyboard polling
+ * Uses DOS INT 21h only (no BIOS calls) for Victor compatibility
+ *
+ * Build: make bench
+ */
+
+#include <dos.h>
+#include <i86.h>
+#include "igc.h"
+#include "editor.h"
+#include "textbuf.h"
+#include "util.h"
+#include "dosapi.h"
+#include "int21.h"
+
+#define BENCH_LINES     EDIT_LINES_HIGH
+#define BENCH_KEYS      200
+
+#define BENCH_DIR_PASSES 20         /* Enumerations of the current dir */
+#define BENCH_FILE      "BENCH.TMP"
+#define BENCH_FILE_SIZE 16384       /* Bytes copied per pass */
+#define BENCH_BLOCK     128         /* Bytes per read/write call */
+#define BENCH_IO_PASSES 20
+#define BENCH_POLLS     5000        /* Keyboard status calls */
+
+static char __far g_data[EDIT_BUF_HIGH];
+static uint32_t __far g_offs[EDIT_LINES_HIGH];
+static TextBuf g_tb;
+static LineIndex g_li;
+
+/*---------------------------------------------------------------------------
+ * puts_raw - Print a string to stdout (DOS INT 21h AH=02)
+ *---------------------------------------------------------------------------*/
+static void puts_raw(const char *s)
+{
+    union REGS regs;
+
+    while (*s) {
+        regs.h.ah = 0x02;
+        regs.h.dl = *s++;
+        int86(0x21, &regs, &regs);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * put_num - Print a decimal number
+ *---------------------------------------------------------------------------*/
+static void put_num(uint32_t n)
+{
+    char buf[12];
+
+    num_format_simple(buf, n);
+    puts_raw(buf);
+}
+
+/*---------------------------------------------------------------------------
+ * ticks - Time of day in 1/100 s (DOS INT 21h AH=2Ch)
+ *---------------------------------------------------------------------------*/
+static uint32_t ticks(void)
+{
+    union REGS regs;
+
+    regs.h.ah = 0x2C;
+    int86(0x21, &regs, &regs);
+
+    return (((uint32_t)regs.h.ch * 60 + regs.h.cl) * 60 + regs.h.dh) * 100 +
+           regs.h.dl;
+}
+
+/*---------------------------------------------------------------------------
+ * fill - Build a buffer of BENCH_LINES short CRLF lines
+ *---------------------------------------------------------------------------*/
+static void fill(void)
+{
+    static const char line[] = "The quick brown fox jumps.\r\n";
+    uint16_t i;
+
+    tb_init(&g_tb, g_data, sizeof(g_data));
+    for (i = 0; i < BENCH_LINES - 1; i++) {
+        tb_insert(&g_tb, tb_length(&g_tb), line, sizeof(line) - 1);
+    }
+
+    li_init(&g_li, g_offs, EDIT_LINES_HIGH);
+    li_build(&g_li, &g_tb);
+}
+
+/*---------------------------------------------------------------------------
+ * run - Type BENCH_KEYS characters mid-file, return elapsed 1/100 s
+ *---------------------------------------------------------------------------*/
+static uint32_t run(bool_t incremental)
+{
+    uint32_t pos;
+    uint32_t start;
+    uint16_t i;
+    char c = 'x';
+
+    fill();
+    pos = g_li.offs[g_li.count / 2];
+
+    start = ticks();
+    for (i = 0; i < BENCH_KEYS; i++) {
+        tb_insert(&g_tb, pos, &c, 1);
+        if (incremental) {
+            li_insert(&g_li, pos, &c, 1);
+        } else {
+            li_build(&g_li, &g_tb);
+        }
+        pos++;
+    }
+
+    return ticks() - start;
+}
+
+/*---------------------------------------------------------------------------
+ * int86 versions of the inline calls, as dosapi.c had them
+ *---------------------------------------------------------------------------*/
+static int old_find_next(void)
+{
+    union REGS regs;
+
+    regs.h.ah = 0x4F;
+    int86(0x21, &regs, &regs);
+
+    return regs.x.cflag ? -1 : 0;
+}
+
+static int16_t old_io(uint8_t ah, dos_handle_t handle, void __far *buf,
+                      uint16_t count)
+{
+    union REGS regs;
+    struct SREGS sregs;
+
+    segread(&sregs);
+
+    regs.h.ah = ah;
+    regs.x.bx = handle;
+    regs.x.cx = count;
+    regs.x.dx = FP_OFF(buf);
+    sregs.ds = FP_SEG(buf);
+
+    int86x(0x21, &regs, &regs, &sregs);
+
+    if (regs.x.cflag) {
+        return -1;
+    }
+    return (int16_t)regs.x.ax;
+}
+
+static uint8_t old_con_status(void)
+{
+    union REGS regs;
+
+    regs.h.ah = 0x0B;
+    int86(0x21, &regs, &regs);
+
+    return regs.h.al;
+}
+
+/*---------------------------------------------------------------------------
+ * run_dir - Enumerate the current directory, return elapsed 1/100 s
+ *---------------------------------------------------------------------------*/
+static uint32_t run_dir(bool_t inline_call, uint32_t *calls)
+{
+    static DTA dta;
+    uint32_t start;
+    uint16_t pass;
+
+    *calls = 0;
+    dos_set_dta(&dta);
+
+    start = ticks();
+    for (pass = 0; pass < BENCH_DIR_PASSES; pass++) {
+        if (dos_find_first("*.*", DOS_ATTR_DIRECTORY) != 0) {
+            break;
+        }
+        do {
+            (*calls)++;
+        } while ((inline_call ? dos_find_next() : old_find_next()) == 0);
+    }
+
+    return ticks() - start;
+}
+
+/*---------------------------------------------------------------------------
+ * run_io - Write and read back BENCH_FILE in BENCH_BLOCK calls, return
+ * elapsed 1/100 s
+ *---------------------------------------------------------------------------*/
+static uint32_t run_io(bool_t inline_call, uint32_t *calls)
+{
+    dos_handle_t h;
+    uint32_t start;
+    uint16_t pass;
+    uint16_t i;
+    int16_t n = 0;
+
+    *calls = 0;
+    h = dos_create(BENCH_FILE, 0);
+    if (h < 0) {
+        return 0;
+    }
+
+    start = ticks();
+    for (pass = 0; pass < BENCH_IO_PASSES; pass++) {
+        dos_seek(h, 0, DOS_SEEK_SET);
+        for (i = 0; i < BENCH_FILE_SIZE / BENCH_BLOCK; i++) {
+            n = inline_call ? dos_write(h, g_data, BENCH_BLOCK) :
+                              old_io(0x40, h, g_data, BENCH_BLOCK);
+        }
+        dos_seek(h, 0, DOS_SEEK_SET);
+        for (i = 0; i < BENCH_FILE_SIZE / BENCH_BLOCK; i++) {
+            n = inline_call ? dos_read(h, g_data, BENCH_BLOCK) :
+                              old_io(0x3F, h, g_data, BENCH_BLOCK);
+        }
+        *calls += 2 * (BENCH_FILE_SIZE / BENCH_BLOCK);
+    }
+    start = ticks() - start;
+
+    dos_close(h);
+    dos_delete(BENCH_FILE);
+    return (n == BENCH_BLOCK) ? start : 0;
+}
+
+/*---------------------------------------------------------------------------
+ * run_poll - Poll the keyboard status, return elapsed 1/100 s
+ *---------------------------------------------------------------------------*/
+static uint32_t run_poll(bool_t inline_call, uint32_t *calls)
+{
+    uint32_t start;
+    uint16_t i;
+
+    start = ticks();
+    for (i = 0; i < BENCH_POLLS; i++) {
+        if (inline_call) {
+            int21_con_status();
+        } else {
+            old_con_status();
+        }
+    }
+    *calls = BENCH_POLLS;
+
+    return ticks() - start;
+}
+
+/*---------------------------------------------------------------------------
+ * report_calls - Print one DOS call result line
+ *---------------------------------------------------------------------------*/
+static void report_calls(const char *label, uint32_t cs, uint32_t calls)
+{
+    puts_raw(label);
+    put_num(cs * 10);
+    puts_raw(" ms, ");
+    put_num(calls);
+    puts_raw(" calls, ");
+    put_num(calls ? cs * 10000 / calls : 0);
+    puts_raw(" us/call\r\n");
+}
+
+/*---------------------------------------------------------------------------
+ * compare - Time one DOS call both ways and print the saving per call
+ *---------------------------------------------------------------------------*/
+static void compare(const char *title,
+                    uint32_t (*run_one)(bool_t inline_call, uint32_t *calls))
+{
+    uint32_t old_cs, new_cs;
+    uint32_t old_calls, new_calls;
+
+    puts_raw(title);
+    puts_raw("\r\n");
+    old_cs = run_one(FALSE, &old_calls);
+    new_cs = run_one(TRUE, &new_calls);
+    report_calls("  int86:    ", old_cs, old_calls);
+    report_calls("  inline:   ", new_cs, new_calls);
+
+    if (old_calls != 0 && new_calls != 0 && old_cs > new_cs) {
+        puts_raw("  saved:    ");
+        put_num((old_cs * 10000 / old_calls) - (new_cs * 10000 / new_calls));
+        puts_raw(" us/call\r\n");
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * report - Print one result line
+ *---------------------------------------------------------------------------*/
+static void report(const char *label, uint32_t cs)
+{
+    puts_raw(label);
+    put_num(cs * 10);
+    puts_raw(" ms total, ");
+    put_num(cs * 10 / BENCH_KEYS);
+    puts_raw(" ms/key\r\n");
+}
+
+/*---------------------------------------------------------------------------
+ * main
+ *---------------------------------------------------------------------------*/
+int main(void)
+{
+    puts_raw("IGC editor benchmark: ");
+    put_num(BENCH_KEYS);
+    puts_raw(" keys into ");
+    put_num(BENCH_LINES);
+    puts_raw(" lines\r\n");
+
+    report("Full rescan:  ", run(FALSE));
+    report("Incremental:  ", run(TRUE));
+
+    puts_raw("\r\nIGC DOS call benchmark (int86 vs inline INT 21h)\r\n");
+    compare("Find next, current directory:", run_dir);
+    compare("Copy loop, 128-byte write + read:", run_io);
+    compare("Keyboard status poll:", run_poll);
+
+    return 0;
+}
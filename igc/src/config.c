@@ -5,6 +5,9 @@
 #include "config.h"
 #include "panel.h"
 #include "dosapi.h"
+#include "fileops.h"
+#include "swap.h"
+#include "exec.h"
 #include "util.h"
 
 /*---------------------------------------------------------------------------
@@ -21,6 +24,22 @@ static const char *skip_whitespace(const char *s)
     return s;
 }
 
+/*---------------------------------------------------------------------------
+ * key_is - Match a "Key=value" line against a key name (case-insensitive)
+ *---------------------------------------------------------------------------*/
+static bool_t key_is(const char *line, const char *name)
+{
+    while (*name) {
+        if (char_upper(*line) != char_upper(*name)) {
+            return FALSE;
+        }
+        line++;
+        name++;
+    }
+    line = skip_whitespace(line);
+    return (*line == '=') ? TRUE : FALSE;
+}
+
 /*---------------------------------------------------------------------------
  * parse_line - Parse a configuration line
  *---------------------------------------------------------------------------*/
@@ -54,7 +73,23 @@ static void parse_line(Config *cfg, const char *line)
     value = skip_whitespace(p + 1);
 
     /* Match known keys */
-    if (str_cmp_i(key, "LeftDrive") == 0 || line[0] == 'L') {
+    if (key_is(key, "Verify")) {
+        cfg->verify = (*value == '1') ? 1 : 0;
+    }
+    else if (key_is(key, "SwapDrive")) {
+        /* Empty or anything but a letter leaves swapping off */
+        if (*value >= 'A' && *value <= 'Z') {
+            cfg->swap_drive = *value - 'A' + 1;
+        } else if (*value >= 'a' && *value <= 'z') {
+            cfg->swap_drive = *value - 'a' + 1;
+        } else {
+            cfg->swap_drive = 0;
+        }
+    }
+    else if (key_is(key, "ExecSwap")) {
+        cfg->exec_swap = (*value == '0') ? 0 : 1;
+    }
+    else if (str_cmp_i(key, "LeftDrive") == 0 || line[0] == 'L') {
         /* Parse drive letter */
         if (*value >= 'A' && *value <= 'Z') {
             cfg->left_drive = *value - 'A';
@@ -123,6 +158,9 @@ bool_t config_load(Config *cfg)
     cfg->right_path[0] = '\\';
     cfg->right_path[1] = '\0';
     cfg->active_panel = 0;
+    cfg->verify = 0;
+    cfg->swap_drive = 0;
+    cfg->exec_swap = 1;
 
     /* Try to open config file */
     h = dos_open(CONFIG_FILE, DOS_OPEN_READ);
@@ -237,6 +275,26 @@ bool_t config_save(const Config *cfg)
     len = str_len(buf);
     dos_write(h, buf, len);
 
+    /* Verify after copy */
+    str_copy(buf, cfg->verify ? "Verify=1\r\n" : "Verify=0\r\n");
+    len = str_len(buf);
+    dos_write(h, buf, len);
+
+    /* Swap drive (empty = off) */
+    str_copy(buf, "SwapDrive=");
+    len = str_len(buf);
+    if (cfg->swap_drive != 0) {
+        buf[len++] = 'A' + cfg->swap_drive - 1;
+    }
+    buf[len++] = '\r';
+    buf[len++] = '\n';
+    dos_write(h, buf, len);
+
+    /* Swap heap out while a program runs */
+    str_copy(buf, cfg->exec_swap ? "ExecSwap=1\r\n" : "ExecSwap=0\r\n");
+    len = str_len(buf);
+    dos_write(h, buf, len);
+
     dos_close(h);
     return TRUE;
 }
@@ -256,6 +314,10 @@ void config_apply(const Config *cfg)
 
     /* Set active panel */
     g_active_panel = cfg->active_panel;
+
+    fops_set_verify(cfg->verify);
+    swap_set_drive(cfg->swap_drive);
+    exec_set_swap(cfg->exec_swap);
 }
 
 /*---------------------------------------------------------------------------
@@ -268,4 +330,7 @@ void config_build(Config *cfg)
     cfg->right_drive = g_right_panel.drive;
     str_copy(cfg->right_path, g_right_panel.path);
     cfg->active_panel = g_active_panel;
+    cfg->verify = fops_get_verify();
+    cfg->swap_drive = swap_get_drive();
+    cfg->exec_swap = exec_get_swap();
 }
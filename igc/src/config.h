@@ -17,6 +17,9 @@ typedef struct {
     uint8_t right_drive;            /* Right panel drive */
     char    right_path[MAX_PATH_LEN]; /* Right panel path */
     uint8_t active_panel;           /* Active panel (0=left, 1=right) */
+    uint8_t verify;                 /* Verify copies with CRC-32 (0/1) */
+    uint8_t swap_drive;             /* Drive for IGC.SWP (1=A, 0=none) */
+    uint8_t exec_swap;              /* Swap heap out to run programs (0/1) */
 } Config;
 
 /*---------------------------------------------------------------------------
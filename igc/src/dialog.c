@@ -15,7 +15,7 @@
 bool_t dlg_open(DialogWindow *win, uint8_t x, uint8_t y, uint8_t w, uint8_t h,
                 const char *title)
 {
-    uint32_t save_size;
+    uint16_t save_size;
     uint8_t i;
     uint16_t title_len;
     uint8_t title_x;
@@ -25,9 +25,9 @@ bool_t dlg_open(DialogWindow *win, uint8_t x, uint8_t y, uint8_t w, uint8_t h,
     win->w = w;
     win->h = h;
 
-    /* Allocate save buffer */
-    save_size = (uint32_t)w * h * 2;
-    win->save = (uint16_t __far *)mem_alloc(save_size);
+    /* Allocate save buffer (dialogs close in reverse order of opening) */
+    save_size = (uint16_t)w * h * 2;
+    win->save = (uint16_t __far *)mem_alloc_lifo(save_size);
 
     if (win->save == (uint16_t __far *)0) {
         return FALSE;
@@ -376,27 +376,75 @@ int dlg_input(const char *title, const char *prompt, char *buf, uint16_t maxlen)
 }
 
 /*---------------------------------------------------------------------------
- * dlg_drive_select - Drive selection dialog
+ * list_drives - Collect the drives in the drive map
+ * Returns the count; *selected is set to the index of current_drive.
  *---------------------------------------------------------------------------*/
-int dlg_drive_select(uint8_t current_drive)
+static uint8_t list_drives(uint8_t *drives, uint8_t current_drive,
+                           uint8_t *selected)
 {
-    DialogWindow win;
-    uint8_t drives[26];
-    uint8_t drive_count = 0;
+    uint8_t count = 0;
     uint8_t i;
-    uint8_t selected = 0;
-    KeyEvent key;
 
-    /* Find valid drives */
-    for (i = 0; i < 26; i++) {
+    *selected = 0;
+    for (i = 0; i < MAX_DRIVE; i++) {
         if (dos_is_drive_valid(i)) {
             if (i == current_drive) {
-                selected = drive_count;
+                *selected = count;
             }
-            drives[drive_count++] = i;
+            drives[count++] = i;
         }
     }
+    return count;
+}
+
+/*---------------------------------------------------------------------------
+ * drive_label - " A: Floppy" etc. from the drive map
+ *---------------------------------------------------------------------------*/
+static void drive_label(char *label, uint8_t drive)
+{
+    static const char *type_names[] = {
+        "", "", "Floppy", "Hard disk", "Network"
+    };
+
+    label[0] = ' ';
+    label[1] = 'A' + drive;
+    label[2] = ':';
+    label[3] = ' ';
+    if (dos_drive_state(drive) == DRIVE_NOT_READY) {
+        str_copy(&label[4], "Not ready");
+    } else {
+        str_copy(&label[4], type_names[dos_drive_type(drive)]);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * drive_ready - TRUE if a drive can be selected
+ * Media can change in anything but a hard disk, so those are asked again.
+ *---------------------------------------------------------------------------*/
+static bool_t drive_ready(uint8_t drive)
+{
+    if (dos_drive_type(drive) == DRIVE_FIXED &&
+        dos_drive_state(drive) == DRIVE_READY) {
+        return TRUE;
+    }
+    return dos_is_drive_ready(drive);
+}
 
+/*---------------------------------------------------------------------------
+ * dlg_drive_select - Drive selection dialog
+ * The list comes from the cached drive map; F2 rebuilds it and checks
+ * every removable drive for media.
+ *---------------------------------------------------------------------------*/
+int dlg_drive_select(uint8_t current_drive)
+{
+    DialogWindow win;
+    uint8_t drives[MAX_DRIVE];
+    uint8_t drive_count;
+    uint8_t i;
+    uint8_t selected;
+    KeyEvent key;
+
+    drive_count = list_drives(drives, current_drive, &selected);
     if (drive_count == 0) {
         return -1;
     }
@@ -405,6 +453,7 @@ int dlg_drive_select(uint8_t current_drive)
     if (!dlg_open(&win, 30, 8, 20, drive_count + 4, "Select Drive")) {
         return -1;
     }
+    scr_puts_n_xy(win.x + 2, win.y + drive_count + 2, "F2 Refresh", 16, ATTR_DIM);
 
     kbd_flush();
 
@@ -412,11 +461,8 @@ int dlg_drive_select(uint8_t current_drive)
         /* Draw drive list */
         for (i = 0; i < drive_count; i++) {
             uint8_t attr = (i == selected) ? ATTR_DIM_REV : ATTR_DIM;
-            char label[4];
-            label[0] = ' ';
-            label[1] = 'A' + drives[i];
-            label[2] = ':';
-            label[3] = '\0';
+            char label[16];
+            drive_label(label, drives[i]);
             scr_puts_n_xy(win.x + 2, win.y + 1 + i, label, 16, attr);
         }
 
@@ -426,7 +472,7 @@ int dlg_drive_select(uint8_t current_drive)
             switch (key.code) {
                 case KEY_ENTER:
                     /* Check if drive is ready before selecting */
-                    if (!dos_is_drive_ready(drives[selected])) {
+                    if (!drive_ready(drives[selected])) {
                         dlg_alert("Error", "Drive not ready");
                         break;
                     }
@@ -445,7 +491,7 @@ int dlg_drive_select(uint8_t current_drive)
                         for (i = 0; i < drive_count; i++) {
                             if (drives[i] == drive) {
                                 /* Check if drive is ready before selecting */
-                                if (!dos_is_drive_ready(drive)) {
+                                if (!drive_ready(drive)) {
                                     dlg_alert("Error", "Drive not ready");
                                     break;
                                 }
@@ -470,6 +516,20 @@ int dlg_drive_select(uint8_t current_drive)
                 case KEY_END:
                     selected = drive_count - 1;
                     break;
+                case KEY_F2:
+                    /* Drives may come or go: reopen at the new size */
+                    scr_puts_n_xy(win.x + 2, win.y + drive_count + 2,
+                                  "Checking...", 16, ATTR_DIM);
+                    dos_drives_scan(TRUE);
+                    dlg_close(&win);
+                    drive_count = list_drives(drives, current_drive, &selected);
+                    if (drive_count == 0 ||
+                        !dlg_open(&win, 30, 8, 20, drive_count + 4, "Select Drive")) {
+                        return -1;
+                    }
+                    scr_puts_n_xy(win.x + 2, win.y + drive_count + 2,
+                                  "F2 Refresh", 16, ATTR_DIM);
+                    break;
                 case KEY_F7:
                 case KEY_F10:
                     dlg_close(&win);
@@ -0,0 +1,742 @@
+/*
+ * diff.c - IGC Two-File Compare Implementation
+ *
+ * Each line is reduced to a 16-bit hash (plus its length, which the
+ * offset table gives for free), so the diff itself never touches the
+ * files.  The diff is Myers' linear-space algorithm: find the middle
+ * snake of the shortest edit path, then split there and recurse.  Only
+ * two diagonal arrays are needed, whatever the distance.  Past
+ * DIFF_COST_MAX edit steps the search settles for the furthest point
+ * reached, so files that have little in common still finish quickly.
+ */
+
+#include "diff.h"
+#include "screen.h"
+#include "keyboard.h"
+#include "mem.h"
+#include "ui.h"
+#include "util.h"
+#include "dialog.h"
+
+#define DIAG_FAR    0x7FFF      /* Backward search has not reached here */
+
+/*---------------------------------------------------------------------------
+ * Static Variables
+ *---------------------------------------------------------------------------*/
+static DiffFile g_a;                /* Left file */
+static DiffFile g_b;                /* Right file */
+
+/* Diagonal arrays, indexed -(b lines + 1) .. a lines + 1 */
+static int16_t __far *g_diag = (int16_t __far *)0;
+static int16_t __far *g_fd;         /* Furthest x reached going forward */
+static int16_t __far *g_bd;         /* Nearest x reached going backward */
+
+static DiffHunk __far *g_hunks = (DiffHunk __far *)0;
+static uint16_t g_hunk_count = 0;
+static uint16_t g_rows = 0;         /* Rows in the side-by-side view */
+static uint16_t g_top = 0;          /* First row on screen */
+static uint16_t g_focus = 0;        /* Row N and P move on from */
+static uint16_t g_left_col = 0;     /* Left column for horizontal scroll */
+
+/* Same line in both files: equal hashes and equal lengths */
+#define SAME(x, y) \
+    (g_a.hash[x] == g_b.hash[y] && \
+     g_a.offs[(x) + 1] - g_a.offs[x] == g_b.offs[(y) + 1] - g_b.offs[y])
+
+/*---------------------------------------------------------------------------
+ * hash_file - Hash every line and record where it starts
+ * Returns FALSE if the file has more than max lines.
+ *---------------------------------------------------------------------------*/
+static bool_t hash_file(DiffFile *f, uint16_t max, char __far *buf)
+{
+    uint32_t off = 0;
+    uint16_t h = 0;
+    int16_t n;
+    uint16_t i;
+    char c;
+
+    f->lines = 0;
+    f->offs[0] = 0;
+    if (dos_seek(f->handle, 0L, DOS_SEEK_SET) < 0) {
+        return FALSE;
+    }
+
+    for (;;) {
+        n = dos_read(f->handle, buf, DIFF_CHUNK);
+        if (n <= 0) {
+            break;
+        }
+        for (i = 0; i < (uint16_t)n; i++) {
+            c = buf[i];
+            h = (h << 5) - h + (uint8_t)c;
+            if (c == '\n') {
+                if (f->lines == max) {
+                    return FALSE;
+                }
+                f->hash[f->lines++] = h;
+                f->offs[f->lines] = off + i + 1;
+                h = 0;
+            }
+        }
+        off += (uint16_t)n;
+    }
+
+    /* Last line without a newline */
+    if (off > f->offs[f->lines]) {
+        if (f->lines == max) {
+            return FALSE;
+        }
+        f->hash[f->lines++] = h;
+        f->offs[f->lines] = off;
+    }
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * split - Find where to divide the shortest edit path
+ *
+ * Runs the forward search from (xoff, yoff) and the backward search
+ * from (xlim, ylim) one edit step at a time until they overlap on a
+ * diagonal; the overlap is the middle snake.  After DIFF_COST_MAX steps
+ * it instead takes whichever search has got furthest.
+ *---------------------------------------------------------------------------*/
+static void split(int16_t xoff, int16_t xlim, int16_t yoff, int16_t ylim,
+                  int16_t *xmid, int16_t *ymid)
+{
+    int16_t dmin = xoff - ylim;
+    int16_t dmax = xlim - yoff;
+    int16_t fmid = xoff - yoff;
+    int16_t bmid = xlim - ylim;
+    int16_t fmin = fmid, fmax = fmid;
+    int16_t bmin = bmid, bmax = bmid;
+    bool_t odd = ((fmid - bmid) & 1) ? TRUE : FALSE;
+    int16_t best, best_x;
+    int16_t c, d, x, y;
+
+    g_fd[fmid] = xoff;
+    g_bd[bmid] = xlim;
+
+    for (c = 1;; c++) {
+        /* Forward: one more edit on every diagonal in reach */
+        if (fmin > dmin) g_fd[--fmin - 1] = -1; else fmin++;
+        if (fmax < dmax) g_fd[++fmax + 1] = -1; else fmax--;
+        for (d = fmax; d >= fmin; d -= 2) {
+            x = (g_fd[d - 1] >= g_fd[d + 1]) ? g_fd[d - 1] + 1 : g_fd[d + 1];
+            y = x - d;
+            while (x < xlim && y < ylim && SAME(x, y)) {
+                x++;
+                y++;
+            }
+            g_fd[d] = x;
+            if (odd && bmin <= d && d <= bmax && g_bd[d] <= x) {
+                *xmid = x;
+                *ymid = y;
+                return;
+            }
+        }
+
+        /* Backward, likewise */
+        if (bmin > dmin) g_bd[--bmin - 1] = DIAG_FAR; else bmin++;
+        if (bmax < dmax) g_bd[++bmax + 1] = DIAG_FAR; else bmax--;
+        for (d = bmax; d >= bmin; d -= 2) {
+            x = (g_bd[d - 1] < g_bd[d + 1]) ? g_bd[d - 1] : g_bd[d + 1] - 1;
+            y = x - d;
+            while (x > xoff && y > yoff && SAME(x - 1, y - 1)) {
+                x--;
+                y--;
+            }
+            g_bd[d] = x;
+            if (!odd && fmin <= d && d <= fmax && x <= g_fd[d]) {
+                *xmid = x;
+                *ymid = y;
+                return;
+            }
+        }
+
+        if (c < DIFF_COST_MAX) {
+            continue;
+        }
+
+        /* Too expensive: furthest forward point (largest x + y) ... */
+        best = -1;
+        best_x = xoff;
+        for (d = fmax; d >= fmin; d -= 2) {
+            x = (g_fd[d] < xlim) ? g_fd[d] : xlim;
+            y = x - d;
+            if (y > ylim) {
+                x = ylim + d;
+                y = ylim;
+            }
+            if (x + y > best) {
+                best = x + y;
+                best_x = x;
+            }
+        }
+        *xmid = best_x;
+        *ymid = best - best_x;
+
+        /* ... unless the backward search got further from its end */
+        best = DIAG_FAR;
+        for (d = bmax; d >= bmin; d -= 2) {
+            x = (g_bd[d] > xoff) ? g_bd[d] : xoff;
+            y = x - d;
+            if (y < yoff) {
+                x = yoff + d;
+                y = yoff;
+            }
+            if (x + y < best) {
+                best = x + y;
+                best_x = x;
+            }
+        }
+        if ((xlim + ylim) - best >= (*xmid + *ymid) - (xoff + yoff)) {
+            *xmid = best_x;
+            *ymid = best - best_x;
+        }
+        return;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * compare_seq - Mark the changed lines in [xoff, xlim) and [yoff, ylim)
+ *---------------------------------------------------------------------------*/
+static void compare_seq(int16_t xoff, int16_t xlim, int16_t yoff, int16_t ylim)
+{
+    int16_t xmid;
+    int16_t ymid;
+
+    /* A common head and tail need no search */
+    while (xoff < xlim && yoff < ylim && SAME(xoff, yoff)) {
+        xoff++;
+        yoff++;
+    }
+    while (xoff < xlim && yoff < ylim && SAME(xlim - 1, ylim - 1)) {
+        xlim--;
+        ylim--;
+    }
+
+    if (xoff == xlim || yoff == ylim) {
+        while (xoff < xlim) g_a.chg[xoff++] = 1;
+        while (yoff < ylim) g_b.chg[yoff++] = 1;
+        return;
+    }
+
+    split(xoff, xlim, yoff, ylim, &xmid, &ymid);
+
+    /* A split that divides nothing: treat the rest as all changed */
+    if ((xmid == xoff && ymid == yoff) || (xmid == xlim && ymid == ylim)) {
+        while (xoff < xlim) g_a.chg[xoff++] = 1;
+        while (yoff < ylim) g_b.chg[yoff++] = 1;
+        return;
+    }
+
+    compare_seq(xoff, xmid, yoff, ymid);
+    compare_seq(xmid, xlim, ymid, ylim);
+}
+
+/*---------------------------------------------------------------------------
+ * build_hunks - Collect runs of changed lines (count only if !fill)
+ *---------------------------------------------------------------------------*/
+static uint16_t build_hunks(bool_t fill)
+{
+    uint16_t i = 0;
+    uint16_t j = 0;
+    uint16_t n = 0;
+    uint16_t row = 0;
+    DiffHunk h;
+
+    while (i < g_a.lines || j < g_b.lines) {
+        if (i < g_a.lines && j < g_b.lines && !g_a.chg[i] && !g_b.chg[j]) {
+            i++;
+            j++;
+            row++;
+            continue;
+        }
+
+        h.a = i;
+        h.b = j;
+        h.row = row;
+        while (i < g_a.lines && g_a.chg[i]) i++;
+        while (j < g_b.lines && g_b.chg[j]) j++;
+        h.a_len = i - h.a;
+        h.b_len = j - h.b;
+        if (h.a_len == 0 && h.b_len == 0) {
+            break;      /* Unmatched common lines: cannot happen */
+        }
+
+        row += (h.a_len > h.b_len) ? h.a_len : h.b_len;
+        if (fill) {
+            g_hunks[n] = h;
+        }
+        n++;
+    }
+
+    g_rows = row;
+    return n;
+}
+
+/*---------------------------------------------------------------------------
+ * hunk_at - Last hunk starting at or before row, -1 if none
+ *---------------------------------------------------------------------------*/
+static int16_t hunk_at(uint16_t row)
+{
+    int16_t lo = 0;
+    int16_t hi = (int16_t)g_hunk_count - 1;
+    int16_t mid;
+
+    if (g_hunk_count == 0 || g_hunks[0].row > row) {
+        return -1;
+    }
+    while (lo < hi) {
+        mid = (lo + hi + 1) >> 1;
+        if (g_hunks[mid].row <= row) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+/*---------------------------------------------------------------------------
+ * row_lines - Lines shown on a row; returns TRUE for a changed row
+ *---------------------------------------------------------------------------*/
+static bool_t row_lines(uint16_t row, uint16_t *la, uint16_t *lb)
+{
+    int16_t k = hunk_at(row);
+    DiffHunk __far *h;
+    uint16_t size;
+    uint16_t i;
+
+    if (k < 0) {
+        *la = row;
+        *lb = row;
+        return FALSE;
+    }
+
+    h = &g_hunks[k];
+    size = (h->a_len > h->b_len) ? h->a_len : h->b_len;
+    i = row - h->row;
+    if (i < size) {
+        *la = (i < h->a_len) ? h->a + i : DIFF_NONE;
+        *lb = (i < h->b_len) ? h->b + i : DIFF_NONE;
+        return TRUE;
+    }
+
+    i -= size;
+    *la = h->a + h->a_len + i;
+    *lb = h->b + h->b_len + i;
+    return FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * file_bytes - len bytes at off, from the file's window
+ *---------------------------------------------------------------------------*/
+static const char __far *file_bytes(DiffFile *f, uint32_t off, uint16_t *len)
+{
+    uint32_t start;
+    int16_t n;
+
+    if (off < f->win_off || off - f->win_off + *len > f->win_len) {
+        /* Going up the file, end the window here rather than start it */
+        start = off;
+        if (off < f->win_off) {
+            start = (off + *len > DIFF_WIN_SIZE) ? off + *len - DIFF_WIN_SIZE : 0;
+        }
+        f->win_off = start;
+        f->win_len = 0;
+        if (dos_seek(f->handle, (int32_t)start, DOS_SEEK_SET) >= 0) {
+            n = dos_read(f->handle, f->win, DIFF_WIN_SIZE);
+            if (n > 0) {
+                f->win_len = (uint16_t)n;
+            }
+        }
+    }
+
+    if (off - f->win_off >= f->win_len) {
+        *len = 0;
+    } else if (off - f->win_off + *len > f->win_len) {
+        *len = f->win_len - (uint16_t)(off - f->win_off);
+    }
+    return f->win + (uint16_t)(off - f->win_off);
+}
+
+/*---------------------------------------------------------------------------
+ * draw_side - Draw one file's line in half a row
+ *---------------------------------------------------------------------------*/
+static void draw_side(DiffFile *f, uint16_t line, uint8_t x, uint8_t y, uint8_t attr)
+{
+    const char __far *p;
+    uint32_t start;
+    uint32_t end;
+    uint16_t len;
+    uint16_t i;
+    char c;
+
+    if (line == DIFF_NONE || line >= f->lines) {
+        return;
+    }
+
+    start = f->offs[line] + g_left_col;
+    end = f->offs[line + 1];
+    if (start >= end) {
+        return;
+    }
+    len = (end - start > DIFF_COLS) ? DIFF_COLS : (uint16_t)(end - start);
+    p = file_bytes(f, start, &len);
+
+    for (i = 0; i < len; i++) {
+        c = p[i];
+        if (c == '\r' || c == '\n') break;
+        if (c == '\t') c = ' ';
+        if (c < 32) c = '.';
+        scr_putc_xy(x + (uint8_t)i, y, c, attr);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * draw_row - Draw one screen row of the side-by-side view
+ *
+ * Changed lines are bright, common lines dim.  The middle column shows
+ * '<' for a line only on the left, '>' only on the right, '*' for a
+ * line that differs.
+ *---------------------------------------------------------------------------*/
+static void draw_row(uint16_t screen_row)
+{
+    uint8_t y = EDIT_TOP_ROW + screen_row;
+    uint16_t row = g_top + screen_row;
+    uint16_t la;
+    uint16_t lb;
+    uint8_t attr;
+    char mark;
+
+    scr_fill_rect(0, y, 80, 1, ' ', ATTR_DIM);
+
+    if (row >= g_rows) {
+        scr_putc_xy(0, y, '~', ATTR_DIM);
+        return;
+    }
+
+    if (row_lines(row, &la, &lb)) {
+        attr = ATTR_NORMAL;
+        mark = (la == DIFF_NONE) ? '>' : (lb == DIFF_NONE) ? '<' : '*';
+        scr_putc_xy(DIFF_COLS, y, mark, ATTR_DIM_REV);
+    } else {
+        attr = ATTR_DIM;
+        scr_putc_xy(DIFF_COLS, y, '|', ATTR_DIM);
+    }
+
+    draw_side(&g_a, la, 0, y, attr);
+    draw_side(&g_b, lb, DIFF_COLS + 1, y, attr);
+}
+
+/*---------------------------------------------------------------------------
+ * draw_bars - Draw the file names and the help bar
+ *---------------------------------------------------------------------------*/
+static void draw_bars(void)
+{
+    char buf[24];
+    int16_t k = hunk_at(g_focus);
+
+    scr_fill_rect(0, 0, 80, 1, ' ', ATTR_DIM_REV);
+    scr_puts_n_xy(1, 0, g_a.name, DIFF_COLS - 2, ATTR_DIM_REV);
+    scr_puts_n_xy(DIFF_COLS + 1, 0, g_b.name, DIFF_COLS - 1, ATTR_DIM_REV);
+
+    scr_fill_rect(0, 24, 80, 1, ' ', ATTR_DIM);
+    scr_puts_xy(0, 24, "7Exit   ", ATTR_DIM_REV);
+    scr_puts_xy(11, 24, "N Next  ", ATTR_DIM_REV);
+    scr_puts_xy(22, 24, "P Prev  ", ATTR_DIM_REV);
+
+    /* Right: which difference is in view */
+    num_format(buf, (uint32_t)(k + 1));
+    str_copy(buf + str_len(buf), " of ");
+    num_format(buf + str_len(buf), g_hunk_count);
+    scr_puts_xy(79 - str_len(buf), 24, buf, ATTR_DIM);
+}
+
+/*---------------------------------------------------------------------------
+ * draw_screen - Draw the whole view
+ *---------------------------------------------------------------------------*/
+static void draw_screen(void)
+{
+    uint16_t i;
+
+    for (i = 0; i < EDIT_ROWS; i++) {
+        draw_row(i);
+    }
+    draw_bars();
+}
+
+/*---------------------------------------------------------------------------
+ * max_top - Top row that shows the last screenful
+ *---------------------------------------------------------------------------*/
+static uint16_t max_top(void)
+{
+    return (g_rows > EDIT_ROWS) ? g_rows - EDIT_ROWS : 0;
+}
+
+/*---------------------------------------------------------------------------
+ * scroll_to - Show row top (clamped); N and P then continue from there
+ *---------------------------------------------------------------------------*/
+static void scroll_to(int32_t top)
+{
+    if (top > (int32_t)max_top()) top = max_top();
+    if (top < 0) top = 0;
+
+    g_top = (uint16_t)top;
+    g_focus = g_top + DIFF_CONTEXT;
+}
+
+/*---------------------------------------------------------------------------
+ * show_hunk - Bring difference k into view, a few lines down
+ *---------------------------------------------------------------------------*/
+static void show_hunk(int16_t k)
+{
+    scroll_to((int32_t)g_hunks[k].row - DIFF_CONTEXT);
+    g_focus = g_hunks[k].row;
+}
+
+/*---------------------------------------------------------------------------
+ * diff_run - Side-by-side view loop
+ *---------------------------------------------------------------------------*/
+static void diff_run(void)
+{
+    KeyEvent key;
+    bool_t running = TRUE;
+    int16_t k;
+
+    g_top = 0;
+    g_left_col = 0;
+    show_hunk(0);
+    draw_screen();
+
+    while (running) {
+        key = kbd_wait();
+
+        if (key.type == KEY_ASCII) {
+            switch (key.code) {
+                case KEY_ESC:
+                    running = FALSE;
+                    break;
+                case 'n':
+                case 'N':
+                case KEY_SPACE:
+                    k = hunk_at(g_focus) + 1;
+                    if (k < (int16_t)g_hunk_count) {
+                        show_hunk(k);
+                        draw_screen();
+                    } else {
+                        ui_status("No more differences");
+                    }
+                    break;
+                case 'p':
+                case 'P':
+                    k = (g_focus > 0) ? hunk_at(g_focus - 1) : -1;
+                    if (k >= 0) {
+                        show_hunk(k);
+                        draw_screen();
+                    } else {
+                        ui_status("No earlier differences");
+                    }
+                    break;
+            }
+        } else if (key.type == KEY_EXTENDED) {
+            ui_clear_status();
+            switch (key.code) {
+                case KEY_UP:
+                    scroll_to((int32_t)g_top - 1);
+                    break;
+                case KEY_DOWN:
+                    scroll_to((int32_t)g_top + 1);
+                    break;
+                case KEY_PGUP:
+                    scroll_to((int32_t)g_top - EDIT_ROWS);
+                    break;
+                case KEY_PGDN:
+                    scroll_to((int32_t)g_top + EDIT_ROWS);
+                    break;
+                case KEY_HOME:
+                    scroll_to(0);
+                    g_left_col = 0;
+                    break;
+                case KEY_END:
+                    scroll_to(max_top());
+                    break;
+                case KEY_LEFT:
+                    g_left_col = (g_left_col > 8) ? g_left_col - 8 : 0;
+                    break;
+                case KEY_RIGHT:
+                    if (g_left_col < 1024) {
+                        g_left_col += 8;
+                    }
+                    break;
+                case KEY_F3:
+                case KEY_F7:
+                case KEY_F10:
+                    running = FALSE;
+                    break;
+            }
+            if (running) {
+                draw_screen();
+            }
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * open_file - Open one side and allocate its tables; NULL, or the reason
+ * it could not be done
+ *---------------------------------------------------------------------------*/
+static const char *open_file(DiffFile *f, const char *name, uint16_t max)
+{
+    str_copy_n(f->name, name, sizeof(f->name) - 1);
+    f->win_off = 0;
+    f->win_len = 0;
+
+    f->handle = dos_open(name, DOS_OPEN_READ);
+    if (f->handle < 0) {
+        return "Cannot open file";
+    }
+
+    f->hash = (uint16_t __far *)mem_alloc((uint32_t)max * sizeof(uint16_t),
+                                          MEM_TAG_DIFF);
+    f->offs = (uint32_t __far *)mem_alloc(((uint32_t)max + 1) * sizeof(uint32_t),
+                                          MEM_TAG_DIFF);
+    f->win = (char __far *)mem_alloc(DIFF_WIN_SIZE, MEM_TAG_DIFF);
+    if (f->hash == (uint16_t __far *)0 || f->offs == (uint32_t __far *)0 ||
+        f->win == (char __far *)0) {
+        return "Not enough memory";
+    }
+    return (const char *)0;
+}
+
+/*---------------------------------------------------------------------------
+ * close_file - Close one side and free its tables
+ *---------------------------------------------------------------------------*/
+static void close_file(DiffFile *f)
+{
+    if (f->chg != (uint8_t __far *)0) mem_free(f->chg);
+    if (f->win != (char __far *)0) mem_free(f->win);
+    if (f->offs != (uint32_t __far *)0) mem_free(f->offs);
+    if (f->hash != (uint16_t __far *)0) mem_free(f->hash);
+    if (f->handle >= 0) dos_close(f->handle);
+
+    f->chg = (uint8_t __far *)0;
+    f->win = (char __far *)0;
+    f->offs = (uint32_t __far *)0;
+    f->hash = (uint16_t __far *)0;
+    f->handle = -1;
+}
+
+/*---------------------------------------------------------------------------
+ * alloc_flags - Allocate a side's changed-line flags, all clear
+ *---------------------------------------------------------------------------*/
+static bool_t alloc_flags(DiffFile *f)
+{
+    f->chg = (uint8_t __far *)mem_alloc((uint32_t)f->lines + 1, MEM_TAG_DIFF);
+    if (f->chg == (uint8_t __far *)0) {
+        return FALSE;
+    }
+    mem_set_far(f->chg, 0, f->lines + 1);
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * diff_compare - Hash both files and mark the changed lines
+ * Returns NULL on success, else the reason it failed.
+ *---------------------------------------------------------------------------*/
+static const char *diff_compare(uint16_t max)
+{
+    char __far *buf;
+    bool_t ok;
+    uint32_t diags;
+
+    buf = (char __far *)mem_alloc(DIFF_CHUNK, MEM_TAG_DIFF);
+    if (buf == (char __far *)0) {
+        return "Not enough memory";
+    }
+    ok = hash_file(&g_a, max, buf) && hash_file(&g_b, max, buf);
+    mem_free(buf);
+    if (!ok) {
+        return "File too long to compare";
+    }
+
+    if (!alloc_flags(&g_a) || !alloc_flags(&g_b)) {
+        return "Not enough memory";
+    }
+
+    /* Two arrays of diagonals, -(b lines + 1) .. a lines + 1 */
+    diags = (uint32_t)g_a.lines + g_b.lines + 3;
+    g_diag = (int16_t __far *)mem_alloc(diags * 2 * sizeof(int16_t),
+                                        MEM_TAG_DIFF);
+    if (g_diag == (int16_t __far *)0) {
+        return "Not enough memory";
+    }
+    g_fd = g_diag + g_b.lines + 1;
+    g_bd = g_diag + (uint16_t)diags + g_b.lines + 1;
+
+    compare_seq(0, (int16_t)g_a.lines, 0, (int16_t)g_b.lines);
+
+    mem_free(g_diag);
+    g_diag = (int16_t __far *)0;
+    return (const char *)0;
+}
+
+/*---------------------------------------------------------------------------
+ * diff_files - Compare two files and show the differences
+ *---------------------------------------------------------------------------*/
+void diff_files(const char *left, const char *right)
+{
+    const char *err = (const char *)0;
+    uint16_t max;
+
+    switch (mem_get_tier()) {
+        case MEM_HIGH:   max = DIFF_LINES_HIGH;   break;
+        case MEM_MEDIUM: max = DIFF_LINES_MEDIUM; break;
+        case MEM_LOW:    max = DIFF_LINES_LOW;    break;
+        default:         max = DIFF_LINES_TINY;   break;
+    }
+
+    g_a.handle = g_b.handle = -1;
+    g_a.hash = g_b.hash = (uint16_t __far *)0;
+    g_a.offs = g_b.offs = (uint32_t __far *)0;
+    g_a.win = g_b.win = (char __far *)0;
+    g_a.chg = g_b.chg = (uint8_t __far *)0;
+
+    err = open_file(&g_a, left, max);
+    if (err == (const char *)0) {
+        err = open_file(&g_b, right, max);
+    }
+
+    if (err == (const char *)0) {
+        ui_status("Comparing...");
+        err = diff_compare(max);
+        ui_clear_status();
+    }
+
+    if (err == (const char *)0) {
+        g_hunk_count = build_hunks(FALSE);
+        if (g_hunk_count == 0) {
+            dlg_alert("Compare", "Files are identical");
+        } else {
+            g_hunks = (DiffHunk __far *)mem_alloc((uint32_t)g_hunk_count * sizeof(DiffHunk),
+                                                  MEM_TAG_DIFF);
+            if (g_hunks == (DiffHunk __far *)0) {
+                err = "Not enough memory";
+            } else {
+                build_hunks(TRUE);
+                scr_clear();
+                diff_run();
+                mem_free(g_hunks);
+                g_hunks = (DiffHunk __far *)0;
+            }
+        }
+    }
+
+    if (err != (const char *)0) {
+        dlg_alert("Compare", err);
+    }
+
+    close_file(&g_b);
+    close_file(&g_a);
+}
@@ -0,0 +1,67 @@
+/*
+ * diff.h - IGC Two-File Compare
+ * Line diff of two text files, shown side by side
+ */
+
+#ifndef DIFF_H
+#define DIFF_H
+
+#include "igc.h"
+#include "editor.h"
+#include "dosapi.h"
+
+/*---------------------------------------------------------------------------
+ * Limits (lines per file, by memory tier, as for the editor)
+ *---------------------------------------------------------------------------*/
+#define DIFF_LINES_TINY   EDIT_LINES_TINY
+#define DIFF_LINES_LOW    EDIT_LINES_LOW
+#define DIFF_LINES_MEDIUM EDIT_LINES_MEDIUM
+#define DIFF_LINES_HIGH   8000      /* Keeps the diagonal arrays under 64KB */
+
+#define DIFF_COST_MAX     200       /* Edit distance searched before settling */
+#define DIFF_CHUNK        4096      /* Bytes read per hashing step */
+#define DIFF_WIN_SIZE     2048      /* Bytes of each file held for display */
+#define DIFF_COLS         39        /* Text columns per side */
+#define DIFF_CONTEXT      3         /* Lines shown above a difference */
+
+#define DIFF_NONE         0xFFFF    /* No line on this side */
+
+/*---------------------------------------------------------------------------
+ * One compared file
+ * hash[i] is a 16-bit hash of line i, offs[i] its file offset (offs[lines]
+ * is the file size).  chg[i] is set for lines not common to both files.
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    dos_handle_t handle;            /* Open file */
+    uint16_t lines;                 /* Lines in the file */
+    uint16_t __far *hash;           /* Line hashes */
+    uint32_t __far *offs;           /* Line start offsets */
+    uint8_t __far *chg;             /* Changed-line flags */
+    char __far *win;                /* Window of file bytes for display */
+    uint32_t win_off;               /* File offset of win[0] */
+    uint16_t win_len;               /* Valid bytes in win */
+    char     name[80];              /* File name */
+} DiffFile;
+
+/*---------------------------------------------------------------------------
+ * A run of changed lines: a_len lines of the left file at a stand where
+ * b_len lines of the right file at b stand.  row is its first screen row
+ * in the side-by-side view.
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    uint16_t a;
+    uint16_t a_len;
+    uint16_t b;
+    uint16_t b_len;
+    uint16_t row;
+} DiffHunk;
+
+/*---------------------------------------------------------------------------
+ * Compare
+ *---------------------------------------------------------------------------*/
+
+/* Compare two files and show the differences side by side (the caller
+ * redraws the screen afterwards) */
+void diff_files(const char *left, const char *right);
+
+#endif /* DIFF_H */
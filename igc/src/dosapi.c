@@ -7,6 +7,7 @@
 #include <i86.h>
 #include <string.h>
 #include "dosapi.h"
+#include "int21.h"
 
 /*---------------------------------------------------------------------------
  * Critical Error Handler (INT 24h)
@@ -121,10 +122,17 @@ void dos_set_drive(uint8_t drive)
 }
 
 /*---------------------------------------------------------------------------
- * dos_is_drive_valid - Check if drive is valid (exists in system)
+ * Drive map
+ *---------------------------------------------------------------------------*/
+static uint8_t g_drive_type[MAX_DRIVE];
+static uint8_t g_drive_ready[MAX_DRIVE];
+static bool_t g_drives_built = FALSE;
+
+/*---------------------------------------------------------------------------
+ * probe_drive_valid - Check if drive exists by selecting it (DOS 2.x map)
  * Uses critical error handler to suppress "Abort, Retry, Fail?" prompts
  *---------------------------------------------------------------------------*/
-bool_t dos_is_drive_valid(uint8_t drive)
+static bool_t probe_drive_valid(uint8_t drive)
 {
     union REGS regs;
     uint8_t old_drive;
@@ -185,9 +193,116 @@ bool_t dos_is_drive_ready(uint8_t drive)
     dos_restore_crit_handler();
 
     /* CF set means error (drive not ready) */
+    if (drive < MAX_DRIVE) {
+        g_drive_ready[drive] = regs.x.cflag ? DRIVE_NOT_READY : DRIVE_READY;
+    }
     return regs.x.cflag ? FALSE : TRUE;
 }
 
+/*---------------------------------------------------------------------------
+ * last_drive - Number of drive letters DOS has (LASTDRIVE)
+ * Selecting the current drive again (AH=0Eh) reports it in AL.
+ *---------------------------------------------------------------------------*/
+static uint8_t last_drive(void)
+{
+    union REGS regs;
+
+    regs.h.ah = 0x0E;
+    regs.h.dl = dos_get_drive();
+    int86(0x21, &regs, &regs);
+
+    return (regs.h.al < MAX_DRIVE) ? regs.h.al : MAX_DRIVE;
+}
+
+/*---------------------------------------------------------------------------
+ * ioctl_drive_type - Drive type from IOCTL (DOS 3.0+)
+ * 4409h flags a redirected drive (bit 12); network redirectors usually
+ * fail 4408h, so it is asked first.  Error 0Fh means no such drive; any
+ * other error leaves the type unknown.
+ *---------------------------------------------------------------------------*/
+static uint8_t ioctl_drive_type(uint8_t drive)
+{
+    union REGS regs;
+
+    regs.x.ax = 0x4409;
+    regs.h.bl = drive + 1;
+    int86(0x21, &regs, &regs);
+    if (regs.x.cflag && regs.x.ax == 0x0F) {
+        return DRIVE_NONE;
+    }
+    if (!regs.x.cflag && (regs.x.dx & 0x1000)) {
+        return DRIVE_REMOTE;
+    }
+
+    regs.x.ax = 0x4408;
+    regs.h.bl = drive + 1;
+    int86(0x21, &regs, &regs);
+    if (regs.x.cflag) {
+        return (regs.x.ax == 0x0F) ? DRIVE_NONE : DRIVE_UNKNOWN;
+    }
+    return (regs.x.ax == 0) ? DRIVE_REMOVABLE : DRIVE_FIXED;
+}
+
+/*---------------------------------------------------------------------------
+ * dos_drives_scan - Rebuild the drive map
+ * DOS 2.x has no IOCTL for this, so drives are found there by selecting
+ * each one in turn.
+ *---------------------------------------------------------------------------*/
+void dos_drives_scan(bool_t probe)
+{
+    uint8_t count = last_drive();
+    bool_t ioctl = ((dos_get_version() & 0xFF) >= 3) ? TRUE : FALSE;
+    uint8_t type;
+    uint8_t i;
+
+    for (i = 0; i < MAX_DRIVE; i++) {
+        if (i >= count) {
+            type = DRIVE_NONE;
+        } else if (ioctl) {
+            type = ioctl_drive_type(i);
+        } else {
+            type = probe_drive_valid(i) ? DRIVE_UNKNOWN : DRIVE_NONE;
+        }
+
+        g_drive_type[i] = type;
+        g_drive_ready[i] = (type == DRIVE_FIXED) ? DRIVE_READY : DRIVE_UNTESTED;
+        if (probe && type != DRIVE_NONE && type != DRIVE_FIXED) {
+            dos_is_drive_ready(i);
+        }
+    }
+    g_drives_built = TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * dos_drive_type - Drive type from the map
+ *---------------------------------------------------------------------------*/
+uint8_t dos_drive_type(uint8_t drive)
+{
+    if (!g_drives_built) {
+        dos_drives_scan(FALSE);
+    }
+    return (drive < MAX_DRIVE) ? g_drive_type[drive] : DRIVE_NONE;
+}
+
+/*---------------------------------------------------------------------------
+ * dos_drive_state - Cached readiness from the map
+ *---------------------------------------------------------------------------*/
+uint8_t dos_drive_state(uint8_t drive)
+{
+    if (!g_drives_built) {
+        dos_drives_scan(FALSE);
+    }
+    return (drive < MAX_DRIVE) ? g_drive_ready[drive] : DRIVE_UNTESTED;
+}
+
+/*---------------------------------------------------------------------------
+ * dos_is_drive_valid - Check if drive is valid (exists in system)
+ *---------------------------------------------------------------------------*/
+bool_t dos_is_drive_valid(uint8_t drive)
+{
+    return (dos_drive_type(drive) != DRIVE_NONE) ? TRUE : FALSE;
+}
+
 /*---------------------------------------------------------------------------
  * dos_get_valid_drives - Get bitmask of valid drives
  *---------------------------------------------------------------------------*/
@@ -196,8 +311,8 @@ uint32_t dos_get_valid_drives(void)
     uint32_t mask = 0;
     uint8_t i;
 
-    for (i = 0; i < 26; i++) {
-        if (dos_is_drive_valid(i)) {
+    for (i = 0; i < MAX_DRIVE; i++) {
+        if (dos_drive_type(i) != DRIVE_NONE) {
             mask |= (1UL << i);
         }
     }
@@ -206,17 +321,18 @@ uint32_t dos_get_valid_drives(void)
 }
 
 /*---------------------------------------------------------------------------
- * dos_get_dta - Get current DTA
+ * DTA in use by DOS, as last set through this module (NULL if unknown)
  *---------------------------------------------------------------------------*/
-DTA __far *dos_get_dta(void)
-{
-    union REGS regs;
-    struct SREGS sregs;
-
-    regs.h.ah = 0x2F;
-    int86x(0x21, &regs, &regs, &sregs);
+static DTA *g_cur_dta = (DTA *)0;
 
-    return (DTA __far *)MK_FP(sregs.es, regs.x.bx);
+/*---------------------------------------------------------------------------
+ * select_dta - Make a DTA current unless it already is
+ *---------------------------------------------------------------------------*/
+static void select_dta(DTA *dta)
+{
+    if (g_cur_dta != dta) {
+        dos_set_dta(dta);
+    }
 }
 
 /*---------------------------------------------------------------------------
@@ -234,6 +350,7 @@ void dos_set_dta(DTA *dta)
     sregs.ds = FP_SEG(dta);
 
     int86x(0x21, &regs, &regs, &sregs);
+    g_cur_dta = dta;
 }
 
 /*---------------------------------------------------------------------------
@@ -261,12 +378,54 @@ int dos_find_first(const char *pattern, uint8_t attr)
  *---------------------------------------------------------------------------*/
 int dos_find_next(void)
 {
-    union REGS regs;
+    return int21_find_next();
+}
 
-    regs.h.ah = 0x4F;
-    int86(0x21, &regs, &regs);
+/*---------------------------------------------------------------------------
+ * dir_open - Start a directory enumeration
+ *---------------------------------------------------------------------------*/
+bool_t dir_open(DirEnum *de, const char *pattern, uint8_t attr)
+{
+    select_dta(&de->dta);
+    de->have = (dos_find_first(pattern, attr) == 0) ? TRUE : FALSE;
+    de->done = !de->have;
+    return de->have;
+}
 
-    return regs.x.cflag ? -1 : 0;
+/*---------------------------------------------------------------------------
+ * dir_next - Next entry of an enumeration, without "." and ".."
+ *---------------------------------------------------------------------------*/
+DTA *dir_next(DirEnum *de)
+{
+    const char *name = de->dta.name;
+
+    while (!de->done) {
+        if (de->have) {
+            de->have = FALSE;
+        } else {
+            select_dta(&de->dta);
+            if (int21_find_next() != 0) {
+                de->done = TRUE;
+                break;
+            }
+        }
+
+        if (name[0] != '.' ||
+            (name[1] != '\0' && (name[1] != '.' || name[2] != '\0'))) {
+            return &de->dta;
+        }
+    }
+    return (DTA *)0;
+}
+
+/*---------------------------------------------------------------------------
+ * dir_close - End a directory enumeration
+ * DOS keeps no state for a search, so this only marks it finished.
+ *---------------------------------------------------------------------------*/
+void dir_close(DirEnum *de)
+{
+    de->have = FALSE;
+    de->done = TRUE;
 }
 
 /*---------------------------------------------------------------------------
@@ -412,27 +571,33 @@ int dos_close(dos_handle_t handle)
 }
 
 /*---------------------------------------------------------------------------
- * dos_read - Read from file
+ * dos_commit - Flush file to disk (duplicate handle, close duplicate)
+ *
+ * DOS 3.1 has no commit call (68h is 3.3+), but closing a duplicate
+ * handle writes the buffers and updates the directory entry while the
+ * original handle stays open.
  *---------------------------------------------------------------------------*/
-int16_t dos_read(dos_handle_t handle, void __far *buf, uint16_t count)
+int dos_commit(dos_handle_t handle)
 {
     union REGS regs;
-    struct SREGS sregs;
-
-    segread(&sregs);
 
-    regs.h.ah = 0x3F;
+    regs.h.ah = 0x45;
     regs.x.bx = handle;
-    regs.x.cx = count;
-    regs.x.dx = FP_OFF(buf);
-    sregs.ds = FP_SEG(buf);
-
-    int86x(0x21, &regs, &regs, &sregs);
+    int86(0x21, &regs, &regs);
 
     if (regs.x.cflag) {
         return -1;
     }
-    return (int16_t)regs.x.ax;
+
+    return dos_close((dos_handle_t)regs.x.ax);
+}
+
+/*---------------------------------------------------------------------------
+ * dos_read - Read from file
+ *---------------------------------------------------------------------------*/
+int16_t dos_read(dos_handle_t handle, void __far *buf, uint16_t count)
+{
+    return int21_read(handle, buf, count);
 }
 
 /*---------------------------------------------------------------------------
@@ -440,23 +605,27 @@ int16_t dos_read(dos_handle_t handle, void __far *buf, uint16_t count)
  *---------------------------------------------------------------------------*/
 int16_t dos_write(dos_handle_t handle, const void __far *buf, uint16_t count)
 {
-    union REGS regs;
-    struct SREGS sregs;
+    return int21_write(handle, buf, count);
+}
 
-    segread(&sregs);
+/*---------------------------------------------------------------------------
+ * dos_seek - Move file pointer (INT 21h AH=42h)
+ *---------------------------------------------------------------------------*/
+int32_t dos_seek(dos_handle_t handle, int32_t offset, uint8_t whence)
+{
+    union REGS regs;
 
-    regs.h.ah = 0x40;
+    regs.h.ah = 0x42;
+    regs.h.al = whence;
     regs.x.bx = handle;
-    regs.x.cx = count;
-    regs.x.dx = FP_OFF(buf);
-    sregs.ds = FP_SEG(buf);
-
-    int86x(0x21, &regs, &regs, &sregs);
+    regs.x.cx = (uint16_t)((uint32_t)offset >> 16);
+    regs.x.dx = (uint16_t)((uint32_t)offset & 0xFFFF);
+    int86(0x21, &regs, &regs);
 
     if (regs.x.cflag) {
-        return -1;
+        return -1L;
     }
-    return (int16_t)regs.x.ax;
+    return (int32_t)(((uint32_t)regs.x.dx << 16) | regs.x.ax);
 }
 
 /*---------------------------------------------------------------------------
@@ -604,6 +773,59 @@ int dos_set_attr(const char *path, uint8_t attr)
     return regs.x.cflag ? -1 : 0;
 }
 
+/*---------------------------------------------------------------------------
+ * dos_fcb_delete - Delete files matching a wildcard pattern
+ *
+ * INT 21h AH=29h parses the pattern into an FCB, then AH=13h deletes every
+ * matching file in a single call, so DOS rewrites the directory and FAT
+ * sectors once instead of once per file.  FCB calls work in the current
+ * directory of the drive named in the pattern.
+ *---------------------------------------------------------------------------*/
+int dos_fcb_delete(const char *pattern)
+{
+    union REGS regs;
+    struct SREGS sregs;
+    uint8_t fcb[37];
+
+    segread(&sregs);
+
+    /* Parse filename into FCB (AL=0: no leading separators, fill defaults) */
+    regs.h.ah = 0x29;
+    regs.h.al = 0x00;
+    regs.x.si = FP_OFF(pattern);
+    sregs.ds = FP_SEG(pattern);
+    regs.x.di = FP_OFF(fcb);
+    sregs.es = FP_SEG(fcb);
+
+    int86x(0x21, &regs, &regs, &sregs);
+
+    /* AL=FFh means invalid drive letter */
+    if (regs.h.al == 0xFF) {
+        return -1;
+    }
+
+    /* FCB delete - AL=00h if one or more files were deleted */
+    segread(&sregs);
+    regs.h.ah = 0x13;
+    regs.x.dx = FP_OFF(fcb);
+    sregs.ds = FP_SEG(fcb);
+
+    int86x(0x21, &regs, &regs, &sregs);
+
+    return (regs.h.al == 0) ? 0 : -1;
+}
+
+/*---------------------------------------------------------------------------
+ * dos_disk_reset - Flush all DOS disk buffers (INT 21h AH=0Dh)
+ *---------------------------------------------------------------------------*/
+void dos_disk_reset(void)
+{
+    union REGS regs;
+
+    regs.h.ah = 0x0D;
+    int86(0x21, &regs, &regs);
+}
+
 /*---------------------------------------------------------------------------
  * dos_get_free_space - Get free space on drive (in KB)
  *---------------------------------------------------------------------------*/
@@ -641,6 +863,179 @@ uint32_t dos_get_free_space(uint8_t drive)
     return free_bytes / 1024L;
 }
 
+/*---------------------------------------------------------------------------
+ * Program Execution
+ *---------------------------------------------------------------------------*/
+
+/* Parameter block for INT 21h AX=4B00h */
+typedef struct {
+    uint16_t env;               /* Environment segment (0 = copy of ours) */
+    char __far *tail;           /* Command tail: length, text, CR */
+    char __far *fcb1;           /* Default FCBs copied into the child's PSP */
+    char __far *fcb2;
+} ExecBlock;
+
+/* SS:SP across EXEC.  DOS 2.x returns from 4Bh with every register but
+ * CS:IP destroyed, so they are kept where CS alone can reach them. */
+static uint16_t __based(__segname("_CODE")) exec_ss;
+static uint16_t __based(__segname("_CODE")) exec_sp;
+
+static char exec_tail[128];
+static char exec_fcb[2][16];
+
+/*---------------------------------------------------------------------------
+ * dos_get_psp - Segment of our PSP (INT 21h AH=62h)
+ *---------------------------------------------------------------------------*/
+uint16_t dos_get_psp(void)
+{
+    union REGS regs;
+
+    regs.h.ah = 0x62;
+    int86(0x21, &regs, &regs);
+    return regs.x.bx;
+}
+
+/*---------------------------------------------------------------------------
+ * dos_get_env - Look up a variable in our environment block
+ *
+ * The block is a list of NAME=value strings ending in an empty string;
+ * its segment is at offset 2Ch of the PSP.
+ *---------------------------------------------------------------------------*/
+bool_t dos_get_env(const char *name, char *buf, uint16_t size)
+{
+    uint16_t env = *(uint16_t __far *)MK_FP(dos_get_psp(), 0x2C);
+    const char __far *p = (const char __far *)MK_FP(env, 0);
+    uint16_t i;
+    uint16_t n;
+
+    while (*p != '\0') {
+        for (i = 0; name[i] != '\0' && p[i] == name[i]; i++) {
+        }
+        if (name[i] == '\0' && p[i] == '=') {
+            p += i + 1;
+            for (n = 0; n + 1 < size && p[n] != '\0'; n++) {
+                buf[n] = p[n];
+            }
+            buf[n] = '\0';
+            return TRUE;
+        }
+        while (*p != '\0') {
+            p++;
+        }
+        p++;
+    }
+    return FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * dos_get_prog_dir - Directory our program was loaded from
+ *
+ * DOS 3.0 and later leave the program's full path after the environment
+ * block: the empty string that ends it, a word count, then the path.
+ *---------------------------------------------------------------------------*/
+bool_t dos_get_prog_dir(char *buf, uint16_t size)
+{
+    uint16_t env = *(uint16_t __far *)MK_FP(dos_get_psp(), 0x2C);
+    const char __far *p = (const char __far *)MK_FP(env, 0);
+    uint16_t n;
+    uint16_t cut = 0;
+
+    if ((dos_get_version() & 0xFF) < 3) {
+        return FALSE;
+    }
+
+    while (*p != '\0') {
+        while (*p != '\0') {
+            p++;
+        }
+        p++;
+    }
+    p += 3;                     /* Ending NUL and the string count */
+
+    for (n = 0; n + 1 < size && p[n] != '\0'; n++) {
+        buf[n] = p[n];
+        if (p[n] == '\\') {
+            cut = n + 1;
+        }
+    }
+    if (cut == 0) {
+        return FALSE;
+    }
+    buf[cut] = '\0';
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * dos_exec - Run a program and wait for it (INT 21h AX=4B00h)
+ *
+ * The child gets a copy of our environment, the arguments as its command
+ * tail and two blank FCBs.  Its exit code comes from AH=4Dh.
+ *---------------------------------------------------------------------------*/
+int16_t dos_exec(const char *path, const char *args)
+{
+    ExecBlock blk;
+    ExecBlock __far *blk_ptr = &blk;
+    union REGS regs;
+    uint8_t len = 0;
+    uint8_t i;
+    int16_t failed;
+
+    /* " args\r", preceded by the length without the CR */
+    if (args != (const char *)0 && args[0] != '\0') {
+        exec_tail[1] = ' ';
+        len = 1;
+        while (len < 126 && args[len - 1] != '\0') {
+            exec_tail[1 + len] = args[len - 1];
+            len++;
+        }
+    }
+    exec_tail[0] = (char)len;
+    exec_tail[1 + len] = '\r';
+
+    for (i = 0; i < 16; i++) {
+        exec_fcb[0][i] = exec_fcb[1][i] = (i >= 1 && i <= 11) ? ' ' : '\0';
+    }
+
+    blk.env = 0;
+    blk.tail = exec_tail;
+    blk.fcb1 = exec_fcb[0];
+    blk.fcb2 = exec_fcb[1];
+
+    _asm {
+        push    ds
+        push    si
+        push    di
+        push    bp
+        mov     word ptr cs:exec_sp, sp
+        mov     word ptr cs:exec_ss, ss
+        les     bx, blk_ptr
+        lds     dx, path
+        mov     ax, 4B00h
+        int     21h
+        cli
+        mov     ss, word ptr cs:exec_ss
+        mov     sp, word ptr cs:exec_sp
+        sti
+        pop     bp
+        pop     di
+        pop     si
+        pop     ds
+        sbb     cx, cx
+        mov     failed, cx
+    }
+
+    /* The child set the DTA to its own PSP; the next search resets it */
+    g_cur_dta = (DTA *)0;
+
+    if (failed) {
+        return -1;
+    }
+
+    regs.h.ah = 0x4D;
+    int86(0x21, &regs, &regs);
+    return (int16_t)regs.h.al;
+}
+
 /*---------------------------------------------------------------------------
  * dos_cursor_off - Hide cursor
  * Note: Victor 9000 doesn't support ANSI sequences - cursor control is
@@ -34,15 +34,41 @@ uint8_t dos_get_drive(void);
 /* Set current drive */
 void dos_set_drive(uint8_t drive);
 
-/* Check if drive is valid (exists in system) */
+/* Check if drive is valid (exists in system), from the drive map */
 bool_t dos_is_drive_valid(uint8_t drive);
 
-/* Check if drive is ready (has media) */
+/* Check if drive is ready (has media); asks DOS and updates the map */
 bool_t dos_is_drive_ready(uint8_t drive);
 
-/* Get number of valid drives (returns bitmask) */
+/* Get number of valid drives (returns bitmask), from the drive map */
 uint32_t dos_get_valid_drives(void);
 
+/*---------------------------------------------------------------------------
+ * Drive Map
+ * Built on first use from the DOS last-drive value and IOCTL, without
+ * selecting any drive.  Hard disks count as ready; other drives are
+ * probed only when asked (dos_is_drive_ready or a probing rescan).
+ *---------------------------------------------------------------------------*/
+#define DRIVE_NONE          0   /* No such drive */
+#define DRIVE_UNKNOWN       1   /* Exists, type not reported (DOS 2.x) */
+#define DRIVE_REMOVABLE     2   /* Floppy or other removable media */
+#define DRIVE_FIXED         3   /* Hard disk */
+#define DRIVE_REMOTE        4   /* Network (redirected) drive */
+
+#define DRIVE_UNTESTED      0   /* Readiness not known */
+#define DRIVE_NOT_READY     1   /* Last probe failed (no media) */
+#define DRIVE_READY         2   /* Has media */
+
+/* Rebuild the drive map; with probe, also test every non-fixed drive for
+ * media (floppies spin up) */
+void dos_drives_scan(bool_t probe);
+
+/* DRIVE_* type of a drive from the map */
+uint8_t dos_drive_type(uint8_t drive);
+
+/* Cached readiness of a drive (DRIVE_UNTESTED/NOT_READY/READY) */
+uint8_t dos_drive_state(uint8_t drive);
+
 /*---------------------------------------------------------------------------
  * Critical Error Handler
  *---------------------------------------------------------------------------*/
@@ -69,9 +95,6 @@ typedef struct {
  * Directory Operations
  *---------------------------------------------------------------------------*/
 
-/* Get current DTA */
-DTA __far *dos_get_dta(void);
-
 /* Set DTA */
 void dos_set_dta(DTA *dta);
 
@@ -81,6 +104,29 @@ int dos_find_first(const char *pattern, uint8_t attr);
 /* Find next file (returns 0 on success) */
 int dos_find_next(void);
 
+/*---------------------------------------------------------------------------
+ * Directory Enumerator
+ * Each enumeration owns its DTA, so nested walks need no save/restore:
+ * the DTA is switched (AH=1Ah) only when another enumeration, or
+ * dos_set_dta, selected a different one since the last call.
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    DTA      dta;               /* Find state and the current entry */
+    bool_t   have;              /* dta holds an entry not yet returned */
+    bool_t   done;              /* No more entries */
+} DirEnum;
+
+/* Start listing entries matching pattern with the given search attributes
+ * (returns FALSE if there are none) */
+bool_t dir_open(DirEnum *de, const char *pattern, uint8_t attr);
+
+/* Next entry, skipping "." and ".."; NULL at the end.  The entry is valid
+ * until the next dir_next on the same enumerator. */
+DTA *dir_next(DirEnum *de);
+
+/* End an enumeration (at the end or early) */
+void dir_close(DirEnum *de);
+
 /* Get current directory for a drive (0=current, 1=A, etc.) */
 /* Returns 0 on success, -1 on error */
 int dos_get_curdir(uint8_t drive, char *buf);
@@ -110,12 +156,18 @@ dos_handle_t dos_create(const char *path, uint8_t attr);
 /* Close file handle */
 int dos_close(dos_handle_t handle);
 
+/* Flush a file's buffers and directory entry without closing it */
+int dos_commit(dos_handle_t handle);
+
 /* Read from file, returns bytes read or -1 on error */
 int16_t dos_read(dos_handle_t handle, void __far *buf, uint16_t count);
 
 /* Write to file, returns bytes written or -1 on error */
 int16_t dos_write(dos_handle_t handle, const void __far *buf, uint16_t count);
 
+/* Move file pointer (DOS_SEEK_SET/CUR/END), returns new position or -1 */
+int32_t dos_seek(dos_handle_t handle, int32_t offset, uint8_t whence);
+
 /* Get file size (via seek to end and back) */
 uint32_t dos_file_size(dos_handle_t handle);
 
@@ -134,14 +186,41 @@ int16_t dos_get_attr(const char *path);
 /* Set file attributes */
 int dos_set_attr(const char *path, uint8_t attr);
 
+/* Delete all plain files matching "D:NAME.EXT" (wildcards allowed) in the
+ * drive's current directory with one FCB call.  Read-only, hidden and
+ * system files are left alone.  Returns 0 if any file was deleted. */
+int dos_fcb_delete(const char *pattern);
+
 /*---------------------------------------------------------------------------
  * Disk Space
  *---------------------------------------------------------------------------*/
 
+/* Flush DOS disk buffers so the next read comes from the media */
+void dos_disk_reset(void);
+
 /* Get free space on drive (in KB) */
 /* Returns 0 on error */
 uint32_t dos_get_free_space(uint8_t drive);
 
+/*---------------------------------------------------------------------------
+ * Program Execution
+ *---------------------------------------------------------------------------*/
+
+/* Segment of our PSP */
+uint16_t dos_get_psp(void);
+
+/* Copy an environment variable's value into buf (size bytes), FALSE if
+ * it is not set */
+bool_t dos_get_env(const char *name, char *buf, uint16_t size);
+
+/* Directory IGC was started from ("D:\PATH\") into buf (size bytes);
+ * FALSE on DOS 2.x, which does not record it */
+bool_t dos_get_prog_dir(char *buf, uint16_t size);
+
+/* Run a program (INT 21h AX=4B00h) with the given arguments.  Returns
+ * its exit code, or -1 if it could not be started. */
+int16_t dos_exec(const char *path, const char *args);
+
 /*---------------------------------------------------------------------------
  * Console Control
  *---------------------------------------------------------------------------*/
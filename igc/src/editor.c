@@ -10,6 +10,10 @@
 #include "ui.h"
 #include "util.h"
 #include "dialog.h"
+#include "undo.h"
+#include "viewer.h"
+#include "search.h"
+#include "swap.h"
 
 /*---------------------------------------------------------------------------
  * Static Variables
@@ -17,69 +21,136 @@
 static Editor g_editor;
 static uint16_t __far *g_screen_save = (uint16_t __far *)0;
 
+/* Buffer sizes from the memory tier, returned to when the editor closes */
+static uint32_t g_base_size = 0;
+static uint16_t g_base_lines = 0;
+
+/* Pages in IGC.SWP holding the text when memory could not */
+static SwapArea g_text_swap;
+
+/* Set once IGC.SWP has lost a page of the text: the buffer is read-only
+ * from then on and F2 refuses to save it */
+static bool_t g_text_lost = FALSE;
+
+/* Written first when saving a spilled text, then renamed over the file */
+#define SAVE_TEMP "IGC$SAVE.TMP"
+
 /* Cut buffer for Ctrl-K/Ctrl-U (multi-line cut/paste) */
 #define CUT_BUF_SIZE 4096
 static char g_cut_buffer[CUT_BUF_SIZE];
 static uint16_t g_cut_len = 0;
 static bool_t g_last_was_cut = FALSE;  /* Track consecutive cuts */
 
+/* File still being read in view mode, or -1 once it is all in */
+static dos_handle_t g_load = -1;
+
+/* Set while undo/redo edits the text, so those edits are not logged */
+static bool_t g_replaying = FALSE;
+
+/* Last search (Ctrl-F/Ctrl-B, repeated by Ctrl-L) */
+static char g_find[SEARCH_MAX + 1];
+static bool_t g_find_back = FALSE;
+
+/* Lines waiting to be repainted, [g_dirty_from, g_dirty_to) */
+#define DIRTY_END 0xFFFF
+static uint16_t g_dirty_from = DIRTY_END;
+static uint16_t g_dirty_to = 0;
+
+/* Status bar values on screen; each field is redrawn only on a change */
+#define STATUS_POS_COL 60
+static uint16_t g_shown_line = 0;
+static uint16_t g_shown_col = 0;
+static bool_t g_shown_modified = FALSE;
+static bool_t g_shown_loading = FALSE;
+
 /*---------------------------------------------------------------------------
  * editor_init - Initialize editor module
  *---------------------------------------------------------------------------*/
 bool_t editor_init(void)
 {
     uint8_t tier = mem_get_tier();
+    uint32_t buf_size;
+    uint16_t max_lines;
+    uint16_t undo_size;
+    uint32_t avail;
+    char __far *data;
+    uint32_t __far *offs;
 
     /* Set buffer sizes based on memory tier */
     switch (tier) {
         case MEM_HIGH:
-            g_editor.buf_size = EDIT_BUF_HIGH;
-            g_editor.max_lines = EDIT_LINES_HIGH;
+            /* Past 64KB: take what is free, less a reserve for the rest */
+            buf_size = EDIT_BUF_HIGH;
+            avail = mem_get_available_kb() * 1024L;
+            if (avail > (uint32_t)EDIT_BUF_HIGH + EDIT_RESERVE) {
+                buf_size = avail - EDIT_RESERVE;
+                if (buf_size > EDIT_BUF_MAX) {
+                    buf_size = EDIT_BUF_MAX;
+                }
+            }
+            max_lines = EDIT_LINES_HIGH;
+            if (buf_size / EDIT_LINE_AVG > max_lines) {
+                max_lines = (uint16_t)(buf_size / EDIT_LINE_AVG);
+            }
+            undo_size = UNDO_BUF_HIGH;
             break;
         case MEM_MEDIUM:
-            g_editor.buf_size = EDIT_BUF_MEDIUM;
-            g_editor.max_lines = EDIT_LINES_MEDIUM;
+            buf_size = EDIT_BUF_MEDIUM;
+            max_lines = EDIT_LINES_MEDIUM;
+            undo_size = UNDO_BUF_MEDIUM;
             break;
         case MEM_LOW:
-            g_editor.buf_size = EDIT_BUF_LOW;
-            g_editor.max_lines = EDIT_LINES_LOW;
+            buf_size = EDIT_BUF_LOW;
+            max_lines = EDIT_LINES_LOW;
+            undo_size = UNDO_BUF_LOW;
             break;
         case MEM_TINY:
         default:
-            g_editor.buf_size = EDIT_BUF_TINY;
-            g_editor.max_lines = EDIT_LINES_TINY;
+            buf_size = EDIT_BUF_TINY;
+            max_lines = EDIT_LINES_TINY;
+            undo_size = UNDO_BUF_TINY;
             break;
     }
 
     /* Allocate text buffer */
-    g_editor.buffer = (char __far *)mem_alloc(g_editor.buf_size);
-    if (g_editor.buffer == (char __far *)0) {
+    data = (char __far *)mem_alloc(buf_size, MEM_TAG_EDITOR);
+    if (data == (char __far *)0) {
         /* Try smallest buffer */
-        g_editor.buf_size = EDIT_BUF_TINY;
-        g_editor.max_lines = EDIT_LINES_TINY;
-        g_editor.buffer = (char __far *)mem_alloc(g_editor.buf_size);
-        if (g_editor.buffer == (char __far *)0) {
+        buf_size = EDIT_BUF_TINY;
+        max_lines = EDIT_LINES_TINY;
+        data = (char __far *)mem_alloc(buf_size, MEM_TAG_EDITOR);
+        if (data == (char __far *)0) {
             return FALSE;
         }
     }
+    tb_init(&g_editor.text, data, buf_size);
+    g_base_size = buf_size;
 
     /* Allocate line offset table */
-    g_editor.line_offs = (uint16_t __far *)mem_alloc(
-        (uint32_t)g_editor.max_lines * sizeof(uint16_t));
-    if (g_editor.line_offs == (uint16_t __far *)0) {
-        mem_free(g_editor.buffer);
-        g_editor.buffer = (char __far *)0;
+    offs = (uint32_t __far *)mem_alloc((uint32_t)max_lines * sizeof(uint32_t),
+                                       MEM_TAG_EDITOR);
+    if (offs == (uint32_t __far *)0) {
+        mem_free(g_editor.text.data);
+        g_editor.text.data = (char __far *)0;
         return FALSE;
     }
+    li_init(&g_editor.lines, offs, max_lines);
+    g_base_lines = max_lines;
 
     /* Allocate screen save buffer */
-    g_screen_save = (uint16_t __far *)mem_alloc(80 * 25 * 2);
+    g_screen_save = (uint16_t __far *)mem_alloc(80 * 25 * 2, MEM_TAG_EDITOR);
     if (g_screen_save == (uint16_t __far *)0) {
-        mem_free(g_editor.line_offs);
-        mem_free(g_editor.buffer);
+        mem_free(g_editor.lines.offs);
+        mem_free(g_editor.text.data);
         return FALSE;
     }
 
+    /* Undo log is optional: without it the editor just cannot undo */
+    undo_init(undo_size);
+
+    /* The text buffer is idle until a file is opened: lend it to copies */
+    mem_offer(g_editor.text.data, g_editor.text.size, MEM_TAG_EDITOR);
+
     return TRUE;
 }
 
@@ -88,71 +159,279 @@ bool_t editor_init(void)
  *---------------------------------------------------------------------------*/
 void editor_shutdown(void)
 {
+    mem_offer((void __far *)0, 0, MEM_TAG_EDITOR);
+    undo_shutdown();
     if (g_screen_save != (uint16_t __far *)0) {
         mem_free(g_screen_save);
         g_screen_save = (uint16_t __far *)0;
     }
-    if (g_editor.line_offs != (uint16_t __far *)0) {
-        mem_free(g_editor.line_offs);
-        g_editor.line_offs = (uint16_t __far *)0;
+    if (g_editor.lines.offs != (uint32_t __far *)0) {
+        mem_free(g_editor.lines.offs);
+        g_editor.lines.offs = (uint32_t __far *)0;
     }
-    if (g_editor.buffer != (char __far *)0) {
-        mem_free(g_editor.buffer);
-        g_editor.buffer = (char __far *)0;
+    if (g_editor.text.data != (char __far *)0) {
+        mem_free(g_editor.text.data);
+        g_editor.text.data = (char __far *)0;
     }
 }
 
 /*---------------------------------------------------------------------------
- * parse_lines - Build line offset table
+ * resize_text - Reallocate the text buffer (in place if DOS can)
  *---------------------------------------------------------------------------*/
-static void parse_lines(void)
+static bool_t resize_text(uint32_t size)
 {
-    uint32_t i;
-    uint16_t line = 0;
+    uint32_t len = tb_length(&g_editor.text);
+    char __far *data;
 
-    g_editor.line_offs[0] = 0;
-    line = 1;
+    /* With the gap at the end only the text itself has to be kept */
+    tb_move_gap(&g_editor.text, len);
+    data = (char __far *)mem_realloc(g_editor.text.data, len, size);
+    if (data == (char __far *)0) {
+        return FALSE;
+    }
+    tb_resize(&g_editor.text, data, size);
+    return TRUE;
+}
 
-    for (i = 0; i < g_editor.buf_used && line < g_editor.max_lines; i++) {
-        if (g_editor.buffer[i] == '\n') {
-            if (line < g_editor.max_lines) {
-                g_editor.line_offs[line] = (uint16_t)(i + 1);
-                line++;
-            }
+/*---------------------------------------------------------------------------
+ * spill_text - Move the text to IGC.SWP when memory cannot hold it
+ *
+ * Only when editing: F3 pages large files in constant memory already.
+ * The area is opened at EDIT_BUF_MAX so it never has to grow, and the
+ * memory buffer goes back to its tier size to leave room for lines.
+ *---------------------------------------------------------------------------*/
+static bool_t spill_text(void)
+{
+    uint32_t mem_size = g_editor.text.size;
+    char __far *data;
+
+    if (g_editor.readonly || g_editor.text.swap != (SwapArea *)0) {
+        return FALSE;
+    }
+    if (!swap_open(&g_text_swap, (uint16_t)(EDIT_BUF_MAX / SWAP_PAGE))) {
+        return FALSE;
+    }
+    if (!tb_spill(&g_editor.text, &g_text_swap)) {
+        swap_close(&g_text_swap);
+        return FALSE;
+    }
+
+    if (mem_size > g_base_size) {
+        data = (char __far *)mem_realloc(g_editor.text.data, 0, g_base_size);
+        if (data != (char __far *)0) {
+            g_editor.text.data = data;
         }
     }
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * grow_text - Grow the text buffer to hold at least need bytes
+ *
+ * Adds a quarter for typing room, up to EDIT_BUF_MAX, and leaves
+ * EDIT_GROW_RESERVE free for the rest of the program.  When memory runs
+ * out the text is spilled to the swap file instead.
+ *---------------------------------------------------------------------------*/
+static bool_t grow_text(uint32_t need)
+{
+    uint32_t size;
 
-    g_editor.total_lines = line;
+    if (need <= g_editor.text.size) {
+        return TRUE;
+    }
+    if (need > EDIT_BUF_MAX) {
+        return FALSE;
+    }
+
+    size = (need + need / 4 + 1023L) & ~1023L;
+    if (size > EDIT_BUF_MAX) {
+        size = EDIT_BUF_MAX;
+    }
+    if (size - g_editor.text.size + EDIT_GROW_RESERVE >
+        mem_get_available_kb() * 1024L) {
+        return spill_text();
+    }
+
+    return resize_text(size) || spill_text();
 }
 
 /*---------------------------------------------------------------------------
- * load_file - Load file into buffer
+ * make_room - TRUE if len bytes (and one spare) fit, growing if needed
  *---------------------------------------------------------------------------*/
-static bool_t load_file(const char *filename)
+static bool_t make_room(uint16_t len)
 {
-    dos_handle_t h;
-    int16_t bytes;
-    uint32_t total = 0;
+    return (tb_free(&g_editor.text) > len ||
+            grow_text(tb_length(&g_editor.text) + len + 1));
+}
 
-    str_copy(g_editor.filename, filename);
+/*---------------------------------------------------------------------------
+ * grow_lines - Double the line table, up to EDIT_LINES_MAX
+ *---------------------------------------------------------------------------*/
+static bool_t grow_lines(void)
+{
+    uint16_t max = g_editor.lines.max;
+    uint32_t old_bytes = (uint32_t)max * sizeof(uint32_t);
+    uint32_t __far *offs;
 
-    h = dos_open(filename, DOS_OPEN_READ);
-    if (h < 0) {
+    if (max >= EDIT_LINES_MAX) {
         return FALSE;
     }
+    max = (max > EDIT_LINES_MAX / 2) ? EDIT_LINES_MAX : max * 2;
 
-    /* Read file in chunks */
-    while (total < g_editor.buf_size) {
-        uint16_t to_read = (g_editor.buf_size - total > 4096) ?
-                           4096 : (uint16_t)(g_editor.buf_size - total);
-        bytes = dos_read(h, &g_editor.buffer[total], to_read);
-        if (bytes <= 0) break;
-        total += bytes;
+    offs = (uint32_t __far *)mem_realloc(g_editor.lines.offs, old_bytes,
+                                         (uint32_t)max * sizeof(uint32_t));
+    if (offs == (uint32_t __far *)0) {
+        return FALSE;
     }
+    li_resize(&g_editor.lines, offs, max);
+    return TRUE;
+}
 
-    dos_close(h);
+/*---------------------------------------------------------------------------
+ * fit_lines - Lines past a full index are dropped; grow it and index them
+ *---------------------------------------------------------------------------*/
+static void fit_lines(void)
+{
+    if (g_editor.lines.count >= g_editor.lines.max && grow_lines()) {
+        li_build(&g_editor.lines, &g_editor.text);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * shrink_buffers - Empty the editor, return grown buffers to tier size and
+ * offer the text buffer for lending again
+ *---------------------------------------------------------------------------*/
+static void shrink_buffers(void)
+{
+    uint32_t bytes;
+    uint32_t __far *offs;
+
+    /* A spilled text returns to the tier-sized memory buffer */
+    if (g_editor.text.swap != (SwapArea *)0) {
+        swap_close(&g_text_swap);
+        tb_init(&g_editor.text, g_editor.text.data, g_base_size);
+    }
+
+    tb_clear(&g_editor.text);
+    if (g_editor.text.size > g_base_size) {
+        resize_text(g_base_size);
+    }
+
+    if (g_editor.lines.max > g_base_lines) {
+        bytes = (uint32_t)g_base_lines * sizeof(uint32_t);
+        offs = (uint32_t __far *)mem_realloc(g_editor.lines.offs, 0, bytes);
+        if (offs != (uint32_t __far *)0) {
+            li_resize(&g_editor.lines, offs, g_base_lines);
+        }
+    }
+    li_build(&g_editor.lines, &g_editor.text);
+
+    mem_offer(g_editor.text.data, g_editor.text.size, MEM_TAG_EDITOR);
+}
+
+/*---------------------------------------------------------------------------
+ * text_insert - Insert into the buffer and patch the line index
+ *---------------------------------------------------------------------------*/
+static bool_t text_insert(uint32_t pos, const char __far *text, uint16_t len)
+{
+    if (!tb_insert(&g_editor.text, pos, text, len)) {
+        if (!grow_text(tb_length(&g_editor.text) + len + 1) ||
+            !tb_insert(&g_editor.text, pos, text, len)) {
+            return FALSE;
+        }
+    }
+    if (!g_replaying) {
+        undo_record_insert(pos, text, len);
+    }
+    li_insert(&g_editor.lines, pos, text, len);
+    fit_lines();
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * text_delete - Delete from the buffer and patch the line index
+ *---------------------------------------------------------------------------*/
+static void text_delete(uint32_t pos, uint16_t len)
+{
+    bool_t was_full = (g_editor.lines.count >= g_editor.lines.max);
+
+    if (!g_replaying) {
+        undo_record_delete(&g_editor.text, pos, len);
+    }
+    li_delete(&g_editor.lines, pos, len);
+    tb_delete(&g_editor.text, pos, len);
+
+    /* Lines past a full index were never indexed; pick them up now */
+    if (was_full && g_editor.lines.count < g_editor.lines.max) {
+        li_build(&g_editor.lines, &g_editor.text);
+    }
+}
 
-    g_editor.buf_used = total;
+/*---------------------------------------------------------------------------
+ * load_chunk - Read and index the next piece of the file being loaded
+ * Returns FALSE once the whole file is in; the file is then closed.
+ *---------------------------------------------------------------------------*/
+static bool_t load_chunk(void)
+{
+    uint32_t total = tb_length(&g_editor.text);
+    uint16_t to_read;
+    int16_t bytes = 0;
+    char __far *p = (char __far *)0;
+
+    if (g_load < 0) {
+        return FALSE;
+    }
+
+    if (total < g_editor.text.size) {
+        to_read = (g_editor.text.size - total > EDIT_LOAD_CHUNK) ?
+                  EDIT_LOAD_CHUNK : (uint16_t)(g_editor.text.size - total);
+        if (to_read > tb_span(&g_editor.text, total)) {
+            to_read = tb_span(&g_editor.text, total);
+        }
+        p = tb_addr(&g_editor.text, total);
+        if (p != (char __far *)0) {
+            bytes = dos_read(g_load, p, to_read);
+        }
+    }
+    if (bytes <= 0) {
+        dos_close(g_load);
+        g_load = -1;
+        return FALSE;
+    }
+
+    /* The gap stays at the end while loading, so this is an append */
+    tb_set_length(&g_editor.text, total + (uint16_t)bytes);
+    li_insert(&g_editor.lines, total, p, (uint16_t)bytes);
+    fit_lines();
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * finish_load - Read whatever is left of the file
+ *---------------------------------------------------------------------------*/
+static void finish_load(void)
+{
+    while (load_chunk()) {
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * load_file - Open a file and read the first piece (or all of it)
+ *
+ * Editing needs the whole file.  Viewing needs only the first screen, so
+ * with all FALSE the rest is read by editor_run while no key is waiting.
+ *---------------------------------------------------------------------------*/
+static bool_t load_file(const char *filename, bool_t all)
+{
+    str_copy(g_editor.filename, filename);
+
+    g_load = dos_open(filename, DOS_OPEN_READ);
+    if (g_load < 0) {
+        return FALSE;
+    }
+
+    tb_clear(&g_editor.text);
+    li_build(&g_editor.lines, &g_editor.text);
     g_editor.modified = FALSE;
     g_editor.top_line = 0;
     g_editor.cursor_line = 0;
@@ -162,40 +441,90 @@ static bool_t load_file(const char *filename)
     /* Reset cut buffer state for new file */
     g_last_was_cut = FALSE;
 
-    parse_lines();
+    undo_clear();
+
+    load_chunk();
+    if (all) {
+        finish_load();
+    }
 
     return TRUE;
 }
 
 /*---------------------------------------------------------------------------
- * save_file - Save buffer to file
+ * write_text - Write the buffer to a file; FALSE on a write error or a
+ * lost swap page
  *---------------------------------------------------------------------------*/
-static bool_t save_file(void)
+static bool_t write_text(const char *path)
 {
     dos_handle_t h;
     int16_t bytes;
-    uint32_t written = 0;
+    const char __far *p;
+    uint32_t pos = 0;
+    uint16_t len;
 
-    h = dos_create(g_editor.filename, 0);
+    h = dos_create(path, 0);
     if (h < 0) {
         return FALSE;
     }
 
-    /* Write in chunks */
-    while (written < g_editor.buf_used) {
-        uint16_t to_write = (g_editor.buf_used - written > 4096) ?
-                            4096 : (uint16_t)(g_editor.buf_used - written);
-        bytes = dos_write(h, &g_editor.buffer[written], to_write);
-        if (bytes < 0) {
+    /* Write the text a contiguous chunk at a time */
+    for (;;) {
+        p = tb_chunk(&g_editor.text, pos, &len);
+        if (len == 0) {
+            break;
+        }
+        bytes = dos_write(h, p, len);
+        if (bytes != (int16_t)len) {
             dos_close(h);
             return FALSE;
         }
-        written += bytes;
+        pos += len;
     }
 
     dos_close(h);
-    g_editor.modified = FALSE;
+    return !tb_failed(&g_editor.text);
+}
 
+/*---------------------------------------------------------------------------
+ * save_file - Save buffer to file
+ *
+ * A spilled text is read back from IGC.SWP as it is written, so it goes
+ * to SAVE_TEMP in the same directory first: a page lost half way then
+ * leaves the old file alone.
+ *---------------------------------------------------------------------------*/
+static bool_t save_file(void)
+{
+    char temp[80];
+    char *name;
+
+    if (tb_failed(&g_editor.text)) {
+        return FALSE;
+    }
+
+    if (g_editor.text.swap == (SwapArea *)0) {
+        if (!write_text(g_editor.filename)) {
+            return FALSE;
+        }
+    } else {
+        str_copy(temp, g_editor.filename);
+        name = temp + (path_get_filename(temp) - temp);
+        if (name == temp && temp[0] != '\0' && temp[1] == ':') {
+            name += 2;
+        }
+        str_copy(name, SAVE_TEMP);
+
+        if (!write_text(temp)) {
+            dos_delete(temp);
+            return FALSE;
+        }
+        dos_delete(g_editor.filename);
+        if (dos_rename(temp, g_editor.filename) != 0) {
+            return FALSE;
+        }
+    }
+
+    g_editor.modified = FALSE;
     return TRUE;
 }
 
@@ -204,50 +533,80 @@ static bool_t save_file(void)
  *---------------------------------------------------------------------------*/
 static uint16_t get_line_len(uint16_t line)
 {
-    uint16_t start, end;
+    uint32_t start, end;
 
-    if (line >= g_editor.total_lines) return 0;
+    if (line >= g_editor.lines.count) return 0;
 
-    start = g_editor.line_offs[line];
-    if (line + 1 < g_editor.total_lines) {
-        end = g_editor.line_offs[line + 1];
+    start = g_editor.lines.offs[line];
+    if (line + 1 < g_editor.lines.count) {
+        end = g_editor.lines.offs[line + 1];
     } else {
-        end = (uint16_t)g_editor.buf_used;
+        end = tb_length(&g_editor.text);
     }
 
     /* Exclude newline/CR */
     while (end > start &&
-           (g_editor.buffer[end - 1] == '\n' ||
-            g_editor.buffer[end - 1] == '\r')) {
+           (tb_char_at(&g_editor.text, end - 1) == '\n' ||
+            tb_char_at(&g_editor.text, end - 1) == '\r')) {
         end--;
     }
 
-    return end - start;
+    return (uint16_t)(end - start);
 }
 
 /*---------------------------------------------------------------------------
- * draw_status_bar - Draw status bar at top
+ * draw_status_name - Status bar left: filename and modified indicator
  *---------------------------------------------------------------------------*/
-static void draw_status_bar(void)
+static void draw_status_name(void)
 {
     char buf[80];
-    uint16_t i;
+    char flags[40];
+    const char *name = g_editor.filename;
+    uint16_t room;
+    uint16_t len;
 
-    /* Clear status bar */
-    scr_fill_rect(0, 0, 80, 1, ' ', ATTR_DIM_REV);
+    scr_fill_rect(0, 0, STATUS_POS_COL, 1, ' ', ATTR_DIM_REV);
 
-    /* Left: filename and modified indicator */
-    str_copy(buf, " ");
-    str_copy_n(buf + 1, g_editor.filename, 40);
+    flags[0] = '\0';
     if (g_editor.modified) {
-        str_copy(buf + str_len(buf), " [Modified]");
+        str_copy(flags + str_len(flags), " [Modified]");
     }
-    if (g_editor.readonly) {
-        str_copy(buf + str_len(buf), " [View]");
+    if (g_text_lost) {
+        str_copy(flags + str_len(flags), " [Swap error]");
+    } else if (g_editor.readonly) {
+        str_copy(flags + str_len(flags), " [View]");
+    }
+    if (g_load >= 0) {
+        str_copy(flags + str_len(flags), " Loading");
+    }
+
+    /* The field ends before the position; a long name loses its front
+     * rather than pushing the flags into it */
+    room = STATUS_POS_COL - 2 - str_len(flags);
+    len = str_len(name);
+    str_copy(buf, " ");
+    if (len > room) {
+        str_copy(buf + 1, "...");
+        str_copy(buf + 4, name + len - (room - 3));
+    } else {
+        str_copy(buf + 1, name);
     }
+    str_copy(buf + str_len(buf), flags);
     scr_puts_xy(0, 0, buf, ATTR_DIM_REV);
+    g_shown_modified = g_editor.modified;
+    g_shown_loading = (g_load >= 0) ? TRUE : FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * draw_status_pos - Status bar right: line/col position
+ *---------------------------------------------------------------------------*/
+static void draw_status_pos(void)
+{
+    char buf[20];
+    uint16_t i;
+
+    scr_fill_rect(STATUS_POS_COL, 0, 80 - STATUS_POS_COL, 1, ' ', ATTR_DIM_REV);
 
-    /* Right: line/col position */
     buf[0] = 'L';
     buf[1] = ':';
     num_format(&buf[2], g_editor.cursor_line + 1);
@@ -257,6 +616,32 @@ static void draw_status_bar(void)
     buf[i++] = ':';
     num_format(&buf[i], g_editor.cursor_col + 1);
     scr_puts_xy(80 - str_len(buf) - 1, 0, buf, ATTR_DIM_REV);
+    g_shown_line = g_editor.cursor_line;
+    g_shown_col = g_editor.cursor_col;
+}
+
+/*---------------------------------------------------------------------------
+ * draw_status_bar - Draw status bar at top
+ *---------------------------------------------------------------------------*/
+static void draw_status_bar(void)
+{
+    draw_status_name();
+    draw_status_pos();
+}
+
+/*---------------------------------------------------------------------------
+ * update_status - Redraw only the status fields whose values changed
+ *---------------------------------------------------------------------------*/
+static void update_status(void)
+{
+    if (g_editor.modified != g_shown_modified ||
+        (g_load >= 0) != g_shown_loading) {
+        draw_status_name();
+    }
+    if (g_editor.cursor_line != g_shown_line ||
+        g_editor.cursor_col != g_shown_col) {
+        draw_status_pos();
+    }
 }
 
 /*---------------------------------------------------------------------------
@@ -269,11 +654,15 @@ static void draw_help_bar(void)
     /* Entire label in dim+reverse, matching F-key bar style */
     if (g_editor.readonly) {
         scr_puts_xy(0, 24, "7Exit   ", ATTR_DIM_REV);
+        scr_puts_xy(11, 24, "^F Find ", ATTR_DIM_REV);
     } else {
         scr_puts_xy(0, 24, "2Save   ", ATTR_DIM_REV);
         scr_puts_xy(11, 24, "^K Cut  ", ATTR_DIM_REV);
         scr_puts_xy(22, 24, "^U Paste", ATTR_DIM_REV);
-        scr_puts_xy(33, 24, "7Exit   ", ATTR_DIM_REV);
+        scr_puts_xy(33, 24, "^Z Undo ", ATTR_DIM_REV);
+        scr_puts_xy(44, 24, "^F Find ", ATTR_DIM_REV);
+        scr_puts_xy(55, 24, "^R Repl ", ATTR_DIM_REV);
+        scr_puts_xy(66, 24, "7Exit   ", ATTR_DIM_REV);
     }
 }
 
@@ -283,38 +672,34 @@ static void draw_help_bar(void)
 static void draw_line(uint16_t screen_row, uint16_t line)
 {
     uint8_t row = EDIT_TOP_ROW + screen_row;
-    uint16_t start, end, len;
+    uint16_t len;
     uint16_t i;
+    char text[EDIT_COLS];
     char c;
 
     /* Clear line */
     scr_fill_rect(0, row, 80, 1, ' ', ATTR_DIM);
 
-    if (line >= g_editor.total_lines) {
+    if (line >= g_editor.lines.count) {
         scr_putc_xy(0, row, '~', ATTR_DIM);
         return;
     }
 
-    /* Get line start and end */
-    start = g_editor.line_offs[line];
-    if (line + 1 < g_editor.total_lines) {
-        end = g_editor.line_offs[line + 1];
-    } else {
-        end = (uint16_t)g_editor.buf_used;
+    /* Copy the visible portion out of the gap buffer */
+    len = get_line_len(line);
+    if (len <= g_editor.left_col) {
+        return;
     }
-
-    /* Remove trailing newline for display */
-    while (end > start &&
-           (g_editor.buffer[end - 1] == '\n' ||
-            g_editor.buffer[end - 1] == '\r')) {
-        end--;
+    len -= g_editor.left_col;
+    if (len > EDIT_COLS) {
+        len = EDIT_COLS;
     }
-
-    len = end - start;
+    tb_copy_out(&g_editor.text, g_editor.lines.offs[line] + g_editor.left_col,
+                text, len);
 
     /* Draw visible portion */
-    for (i = 0; i < EDIT_COLS && (g_editor.left_col + i) < len; i++) {
-        c = g_editor.buffer[start + g_editor.left_col + i];
+    for (i = 0; i < len; i++) {
+        c = text[i];
         if (c == '\t') c = ' ';
         if (c < 32) c = '.';
         scr_putc_xy(EDIT_LEFT_COL + i, row, c, ATTR_DIM);
@@ -331,11 +716,43 @@ static void draw_screen(void)
     for (i = 0; i < EDIT_ROWS; i++) {
         draw_line(i, g_editor.top_line + i);
     }
+    g_dirty_from = DIRTY_END;
+    g_dirty_to = 0;
 
     draw_status_bar();
     draw_help_bar();
 }
 
+/*---------------------------------------------------------------------------
+ * mark_lines - Note that lines [from, to) must be repainted
+ *
+ * Edits only mark; refresh() paints once per key, so a key that makes
+ * several edits (Tab, Enter) still draws each row at most once.
+ *---------------------------------------------------------------------------*/
+static void mark_lines(uint16_t from, uint16_t to)
+{
+    if (from < g_dirty_from) g_dirty_from = from;
+    if (to > g_dirty_to) g_dirty_to = to;
+}
+
+/*---------------------------------------------------------------------------
+ * refresh - Repaint the marked lines that are on screen
+ *---------------------------------------------------------------------------*/
+static void refresh(void)
+{
+    uint16_t top = g_editor.top_line;
+    uint16_t line = (g_dirty_from > top) ? g_dirty_from : top;
+    uint16_t end = (g_dirty_to < top + EDIT_ROWS) ? g_dirty_to : top + EDIT_ROWS;
+
+    for (; line < end; line++) {
+        draw_line(line - top, line);
+    }
+    g_dirty_from = DIRTY_END;
+    g_dirty_to = 0;
+
+    update_status();
+}
+
 /*---------------------------------------------------------------------------
  * update_cursor - Update cursor position on screen
  *---------------------------------------------------------------------------*/
@@ -352,16 +769,16 @@ static void update_cursor(void)
  *---------------------------------------------------------------------------*/
 static void scroll_if_needed(void)
 {
+    uint16_t old_top = g_editor.top_line;
+    uint16_t n;
     bool_t need_redraw = FALSE;
 
     /* Vertical scrolling */
     if (g_editor.cursor_line < g_editor.top_line) {
         g_editor.top_line = g_editor.cursor_line;
-        need_redraw = TRUE;
     }
     if (g_editor.cursor_line >= g_editor.top_line + EDIT_ROWS) {
         g_editor.top_line = g_editor.cursor_line - EDIT_ROWS + 1;
-        need_redraw = TRUE;
     }
 
     /* Horizontal scrolling */
@@ -374,8 +791,29 @@ static void scroll_if_needed(void)
         need_redraw = TRUE;
     }
 
+    /*
+     * A short vertical scroll moves the rows still visible in video
+     * memory and paints only the lines uncovered.  Marks are by line,
+     * not row, so lines already marked are still repainted after it.
+     */
     if (need_redraw) {
-        draw_screen();
+        mark_lines(0, DIRTY_END);
+    } else if (g_editor.top_line > old_top) {
+        n = g_editor.top_line - old_top;
+        if (n < EDIT_ROWS) {
+            scr_scroll_rect(0, EDIT_TOP_ROW, 80, EDIT_ROWS, (int8_t)n);
+            mark_lines(old_top + EDIT_ROWS, g_editor.top_line + EDIT_ROWS);
+        } else {
+            mark_lines(0, DIRTY_END);
+        }
+    } else if (g_editor.top_line < old_top) {
+        n = old_top - g_editor.top_line;
+        if (n < EDIT_ROWS) {
+            scr_scroll_rect(0, EDIT_TOP_ROW, 80, EDIT_ROWS, -(int8_t)n);
+            mark_lines(g_editor.top_line, old_top);
+        } else {
+            mark_lines(0, DIRTY_END);
+        }
     }
 }
 
@@ -407,7 +845,7 @@ static void cursor_up(void)
  *---------------------------------------------------------------------------*/
 static void cursor_down(void)
 {
-    if (g_editor.cursor_line < g_editor.total_lines - 1) {
+    if (g_editor.cursor_line < g_editor.lines.count - 1) {
         g_editor.cursor_line++;
         clamp_cursor_col();
         scroll_if_needed();
@@ -439,7 +877,7 @@ static void cursor_right(void)
     if (g_editor.cursor_col < line_len) {
         g_editor.cursor_col++;
         scroll_if_needed();
-    } else if (g_editor.cursor_line < g_editor.total_lines - 1) {
+    } else if (g_editor.cursor_line < g_editor.lines.count - 1) {
         g_editor.cursor_line++;
         g_editor.cursor_col = 0;
         scroll_if_needed();
@@ -484,8 +922,8 @@ static void page_up(void)
 static void page_down(void)
 {
     g_editor.cursor_line += EDIT_ROWS;
-    if (g_editor.cursor_line >= g_editor.total_lines) {
-        g_editor.cursor_line = g_editor.total_lines - 1;
+    if (g_editor.cursor_line >= g_editor.lines.count) {
+        g_editor.cursor_line = g_editor.lines.count - 1;
     }
     clamp_cursor_col();
     scroll_if_needed();
@@ -494,9 +932,9 @@ static void page_down(void)
 /*---------------------------------------------------------------------------
  * get_cursor_offset - Get buffer offset for cursor position
  *---------------------------------------------------------------------------*/
-static uint16_t get_cursor_offset(void)
+static uint32_t get_cursor_offset(void)
 {
-    return g_editor.line_offs[g_editor.cursor_line] + g_editor.cursor_col;
+    return g_editor.lines.offs[g_editor.cursor_line] + g_editor.cursor_col;
 }
 
 /*---------------------------------------------------------------------------
@@ -504,49 +942,45 @@ static uint16_t get_cursor_offset(void)
  *---------------------------------------------------------------------------*/
 static void insert_char(char c)
 {
-    uint16_t offset;
-    uint32_t i;
-
     if (g_editor.readonly) return;
-    if (g_editor.buf_used >= g_editor.buf_size - 1) return;
-
-    offset = get_cursor_offset();
+    if (!make_room(1)) return;
 
-    /* Shift buffer contents right */
-    for (i = g_editor.buf_used; i > offset; i--) {
-        g_editor.buffer[i] = g_editor.buffer[i - 1];
-    }
-    g_editor.buffer[offset] = c;
-    g_editor.buf_used++;
-
-    /* Update line offsets */
-    parse_lines();
+    text_insert(get_cursor_offset(), &c, 1);
 
     g_editor.cursor_col++;
     g_editor.modified = TRUE;
 
-    /* Redraw current line */
-    draw_line(g_editor.cursor_line - g_editor.top_line, g_editor.cursor_line);
-    draw_status_bar();
+    mark_lines(g_editor.cursor_line, g_editor.cursor_line + 1);
+    scroll_if_needed();
 }
 
 /*---------------------------------------------------------------------------
  * insert_newline - Insert newline at cursor
+ *
+ * The CR/LF pair goes in as one edit with typing groups closed on both
+ * sides, so Ctrl-Z takes back the line break on its own.
  *---------------------------------------------------------------------------*/
 static void insert_newline(void)
 {
     if (g_editor.readonly) return;
-    if (g_editor.buf_used >= g_editor.buf_size - 2) return;
-    if (g_editor.total_lines >= g_editor.max_lines - 1) return;
+    if (!make_room(2)) return;
+    if (g_editor.lines.count >= g_editor.lines.max - 1 && !grow_lines()) {
+        return;
+    }
 
-    insert_char('\r');
-    insert_char('\n');
+    undo_break();
+    if (!text_insert(get_cursor_offset(), "\r\n", 2)) {
+        return;
+    }
+    undo_break();
+    g_editor.modified = TRUE;
 
+    /* Lines below the split all move down a row */
+    mark_lines(g_editor.cursor_line, DIRTY_END);
     g_editor.cursor_line++;
     g_editor.cursor_col = 0;
 
     scroll_if_needed();
-    draw_screen();
 }
 
 /*---------------------------------------------------------------------------
@@ -554,34 +988,34 @@ static void insert_newline(void)
  *---------------------------------------------------------------------------*/
 static void delete_char(void)
 {
-    uint16_t offset;
-    uint32_t i;
+    uint32_t offset;
     uint16_t del_count = 1;
+    uint16_t count = g_editor.lines.count;
+    uint32_t used = tb_length(&g_editor.text);
 
     if (g_editor.readonly) return;
 
     offset = get_cursor_offset();
-    if (offset >= g_editor.buf_used) return;
+    if (offset >= used) return;
 
     /* Handle CRLF as a unit - if deleting CR followed by LF, delete both */
-    if (g_editor.buffer[offset] == '\r' &&
-        offset + 1 < g_editor.buf_used &&
-        g_editor.buffer[offset + 1] == '\n') {
+    if (tb_char_at(&g_editor.text, offset) == '\r' &&
+        offset + 1 < used &&
+        tb_char_at(&g_editor.text, offset + 1) == '\n') {
         del_count = 2;
     }
 
-    /* Shift buffer contents left */
-    for (i = offset; i < g_editor.buf_used - del_count; i++) {
-        g_editor.buffer[i] = g_editor.buffer[i + del_count];
-    }
-    g_editor.buf_used -= del_count;
-
-    /* Update line offsets */
-    parse_lines();
+    text_delete(offset, del_count);
 
     g_editor.modified = TRUE;
     clamp_cursor_col();
-    draw_screen();
+
+    /* Within a line only that line changes; a join moves the rest up */
+    if (g_editor.lines.count == count) {
+        mark_lines(g_editor.cursor_line, g_editor.cursor_line + 1);
+    } else {
+        mark_lines(g_editor.cursor_line, DIRTY_END);
+    }
 }
 
 /*---------------------------------------------------------------------------
@@ -602,22 +1036,22 @@ static void backspace(void)
  *---------------------------------------------------------------------------*/
 static void cut_line(void)
 {
-    uint16_t start, end, len;
-    uint32_t i;
+    uint32_t start, end;
+    uint16_t len;
     uint16_t copy_len;
 
     if (g_editor.readonly) return;
-    if (g_editor.total_lines == 0) return;
+    if (g_editor.lines.count == 0) return;
 
     /* Get line boundaries */
-    start = g_editor.line_offs[g_editor.cursor_line];
-    if (g_editor.cursor_line + 1 < g_editor.total_lines) {
-        end = g_editor.line_offs[g_editor.cursor_line + 1];
+    start = g_editor.lines.offs[g_editor.cursor_line];
+    if (g_editor.cursor_line + 1 < g_editor.lines.count) {
+        end = g_editor.lines.offs[g_editor.cursor_line + 1];
     } else {
-        end = (uint16_t)g_editor.buf_used;
+        end = tb_length(&g_editor.text);
     }
 
-    len = end - start;
+    len = (uint16_t)(end - start);
     if (len == 0) return;
 
     /* If last action wasn't a cut, start fresh */
@@ -633,30 +1067,23 @@ static void cut_line(void)
 
     if (copy_len > 0) {
         /* Append line to cut buffer (including newline if present) */
-        for (i = 0; i < copy_len; i++) {
-            g_cut_buffer[g_cut_len + i] = g_editor.buffer[start + i];
-        }
+        tb_copy_out(&g_editor.text, start, &g_cut_buffer[g_cut_len], copy_len);
         g_cut_len += copy_len;
     }
 
     /* Delete line from buffer */
-    for (i = start; i < g_editor.buf_used - len; i++) {
-        g_editor.buffer[i] = g_editor.buffer[i + len];
-    }
-    g_editor.buf_used -= len;
-
-    /* Update line offsets */
-    parse_lines();
+    text_delete(start, len);
 
     /* Adjust cursor if needed */
-    if (g_editor.cursor_line >= g_editor.total_lines && g_editor.total_lines > 0) {
-        g_editor.cursor_line = g_editor.total_lines - 1;
+    if (g_editor.cursor_line >= g_editor.lines.count && g_editor.lines.count > 0) {
+        g_editor.cursor_line = g_editor.lines.count - 1;
     }
     g_editor.cursor_col = 0;
 
     g_editor.modified = TRUE;
     g_last_was_cut = TRUE;  /* Mark that last action was cut */
-    draw_screen();
+    mark_lines(g_editor.cursor_line, DIRTY_END);
+    scroll_if_needed();
 }
 
 /*---------------------------------------------------------------------------
@@ -664,31 +1091,219 @@ static void cut_line(void)
  *---------------------------------------------------------------------------*/
 static void paste_line(void)
 {
-    uint16_t offset;
-    uint32_t i;
-
     if (g_editor.readonly) return;
     if (g_cut_len == 0) return;
-    if (g_editor.buf_used + g_cut_len >= g_editor.buf_size) return;
+    if (!make_room(g_cut_len)) return;
 
     /* Insert at start of current line */
-    offset = g_editor.line_offs[g_editor.cursor_line];
+    text_insert(g_editor.lines.offs[g_editor.cursor_line], g_cut_buffer, g_cut_len);
+
+    g_editor.modified = TRUE;
+    mark_lines(g_editor.cursor_line, DIRTY_END);
+}
+
+/*---------------------------------------------------------------------------
+ * replay - Apply an undo record forwards (redo) or backwards (undo)
+ *
+ * Inverting a record is one block insert or delete at its position; the
+ * cursor goes to where the edit happened.
+ *---------------------------------------------------------------------------*/
+static void replay(const UndoRec *rec, bool_t backwards)
+{
+    bool_t insert = (rec->type == UNDO_INSERT) ? !backwards : backwards;
+    uint32_t cursor = rec->pos;
+
+    g_replaying = TRUE;
+    if (insert) {
+        text_insert(rec->pos, rec->text, rec->text_len);
+        if (rec->len > rec->text_len) {
+            text_insert(rec->pos + rec->text_len, rec->wrap,
+                        rec->len - rec->text_len);
+        }
+        cursor += rec->len;
+    } else {
+        text_delete(rec->pos, rec->len);
+    }
+    g_replaying = FALSE;
+
+    g_editor.cursor_line = li_find(&g_editor.lines, cursor);
+    g_editor.cursor_col = (uint16_t)(cursor - g_editor.lines.offs[g_editor.cursor_line]);
+    g_editor.modified = TRUE;
+    g_last_was_cut = FALSE;
+
+    mark_lines(li_find(&g_editor.lines, rec->pos), DIRTY_END);
+    scroll_if_needed();
+}
+
+/*---------------------------------------------------------------------------
+ * undo_edit - Undo the last edit (Ctrl-Z)
+ *---------------------------------------------------------------------------*/
+static void undo_edit(void)
+{
+    UndoRec rec;
+
+    if (g_editor.readonly) return;
+
+    if (undo_pop(&rec)) {
+        replay(&rec, TRUE);
+    } else {
+        ui_status("Nothing to undo");
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * redo_edit - Redo the last undone edit (Ctrl-Y)
+ *---------------------------------------------------------------------------*/
+static void redo_edit(void)
+{
+    UndoRec rec;
+
+    if (g_editor.readonly) return;
+
+    if (redo_pop(&rec)) {
+        replay(&rec, FALSE);
+    } else {
+        ui_status("Nothing to redo");
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * move_to - Put the cursor on a buffer offset
+ *---------------------------------------------------------------------------*/
+static void move_to(uint32_t pos)
+{
+    g_editor.cursor_line = li_find(&g_editor.lines, pos);
+    g_editor.cursor_col = (uint16_t)(pos - g_editor.lines.offs[g_editor.cursor_line]);
+    scroll_if_needed();
+}
+
+/*---------------------------------------------------------------------------
+ * find_next - Search from the cursor for the last pattern (Ctrl-L)
+ *---------------------------------------------------------------------------*/
+static void find_next(void)
+{
+    SearchPat sp;
+    SearchSrc src;
+    uint32_t cur = get_cursor_offset();
+    uint32_t len;
+    uint32_t hit;
+
+    /* Search the whole file, not just the part read so far */
+    finish_load();
+    len = tb_length(&g_editor.text);
+
+    if (!search_prepare(&sp, g_find, search_ignore_case(g_find), g_find_back)) {
+        return;
+    }
+    src.tb = &g_editor.text;
+    src.handle = -1;
+
+    /* Forward: matches after the cursor; backward: matches before it */
+    if (!g_find_back) {
+        hit = search_range(&sp, &src, cur + 1, len);
+    } else if (cur > 0) {
+        hit = search_range(&sp, &src, 0,
+                           (cur - 1 + sp.len < len) ? cur - 1 + sp.len : len);
+    } else {
+        hit = SEARCH_NOT_FOUND;
+    }
 
-    /* Shift buffer contents right to make room */
-    for (i = g_editor.buf_used; i > offset; i--) {
-        g_editor.buffer[i + g_cut_len - 1] = g_editor.buffer[i - 1];
+    if (hit == SEARCH_NOT_FOUND) {
+        ui_status("Not found");
+        return;
     }
 
-    /* Copy cut buffer into position */
-    for (i = 0; i < g_cut_len; i++) {
-        g_editor.buffer[offset + i] = g_cut_buffer[i];
+    ui_clear_status();
+    move_to(hit);
+}
+
+/*---------------------------------------------------------------------------
+ * find - Ask for a pattern and search (Ctrl-F forward, Ctrl-B backward)
+ *---------------------------------------------------------------------------*/
+static void find(bool_t backward)
+{
+    int result;
+
+    result = dlg_input(backward ? "Find Backward" : "Find", "Text:",
+                       g_find, SEARCH_MAX + 1);
+    draw_screen();
+
+    if (result == DLG_OK && g_find[0] != '\0') {
+        g_find_back = backward;
+        find_next();
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * replace_all - Replace every match in the buffer (Ctrl-R)
+ *
+ * The whole buffer is rebuilt in one pass, which is too big a change for
+ * the undo log, so the log is cleared.
+ *---------------------------------------------------------------------------*/
+static void replace_all(void)
+{
+    SearchPat sp;
+    char repl[SEARCH_MAX + 1];
+    char msg[40];
+    uint32_t count;
+
+    if (g_editor.readonly) return;
+
+    if (dlg_input("Replace All", "Find:", g_find, SEARCH_MAX + 1) != DLG_OK ||
+        !search_prepare(&sp, g_find, search_ignore_case(g_find), FALSE)) {
+        draw_screen();
+        return;
+    }
+    repl[0] = '\0';
+    if (dlg_input("Replace All", "Replace with:", repl, SEARCH_MAX + 1) != DLG_OK) {
+        draw_screen();
+        return;
     }
-    g_editor.buf_used += g_cut_len;
 
-    /* Update line offsets */
-    parse_lines();
+    count = search_replace_all(&g_editor.text, &sp, repl, str_len(repl));
+    if (count == SEARCH_NOT_FOUND) {
+        draw_screen();
+        ui_error("Not enough room");
+        return;
+    }
+    if (count == 0) {
+        draw_screen();
+        ui_status("Not found");
+        return;
+    }
 
+    li_build(&g_editor.lines, &g_editor.text);
+    undo_clear();
     g_editor.modified = TRUE;
+    g_last_was_cut = FALSE;
+
+    if (g_editor.cursor_line >= g_editor.lines.count) {
+        g_editor.cursor_line = g_editor.lines.count - 1;
+    }
+    clamp_cursor_col();
+    scroll_if_needed();
+    draw_screen();
+
+    num_format(msg, count);
+    str_copy(msg + str_len(msg), " replaced");
+    ui_status(msg);
+}
+
+/*---------------------------------------------------------------------------
+ * check_text - Stop editing once IGC.SWP has lost a page of the text
+ *
+ * What is on screen may already be wrong, so the buffer turns read-only
+ * and is never saved over the file.
+ *---------------------------------------------------------------------------*/
+static void check_text(void)
+{
+    if (g_text_lost || !tb_failed(&g_editor.text)) {
+        return;
+    }
+
+    g_text_lost = TRUE;
+    g_editor.readonly = TRUE;
+    dlg_alert("Swap File Error", "Text lost - editing stopped");
     draw_screen();
 }
 
@@ -709,12 +1324,26 @@ static void editor_run(void)
 {
     KeyEvent key;
     bool_t running = TRUE;
+    uint16_t count;
 
     draw_screen();
     scr_cursor_on();
     update_cursor();
 
     while (running) {
+        check_text();
+
+        /* View mode: read on while no key is waiting; the last line
+         * shown may have grown and new ones may now be on screen */
+        while (g_load >= 0 && !kbd_check()) {
+            count = g_editor.lines.count;
+            if (load_chunk()) {
+                mark_lines(count - 1, DIRTY_END);
+            }
+            refresh();
+            update_cursor();
+        }
+
         key = kbd_wait();
 
         if (key.type == KEY_ASCII) {
@@ -747,6 +1376,36 @@ static void editor_run(void)
                     paste_line();
                     break;
 
+                case 26:    /* Ctrl-Z: undo */
+                    undo_edit();
+                    break;
+
+                case 25:    /* Ctrl-Y: redo */
+                    redo_edit();
+                    break;
+
+                case 6:     /* Ctrl-F: find */
+                    g_last_was_cut = FALSE;
+                    undo_break();
+                    find(FALSE);
+                    break;
+
+                case 2:     /* Ctrl-B: find backward */
+                    g_last_was_cut = FALSE;
+                    undo_break();
+                    find(TRUE);
+                    break;
+
+                case 12:    /* Ctrl-L: find again */
+                    g_last_was_cut = FALSE;
+                    undo_break();
+                    find_next();
+                    break;
+
+                case 18:    /* Ctrl-R: replace all */
+                    replace_all();
+                    break;
+
                 default:
                     g_last_was_cut = FALSE;
                     if (key.code >= 32 && key.code < 127) {
@@ -757,6 +1416,7 @@ static void editor_run(void)
         } else if (key.type == KEY_EXTENDED) {
             /* Any navigation or other action breaks cut accumulation */
             g_last_was_cut = FALSE;
+            undo_break();
 
             switch (key.code) {
                 case KEY_UP:
@@ -787,7 +1447,9 @@ static void editor_run(void)
                     delete_char();
                     break;
                 case KEY_F2:
-                    if (!g_editor.readonly) {
+                    if (g_text_lost) {
+                        ui_error("Text damaged - not saved");
+                    } else if (!g_editor.readonly) {
                         if (save_file()) {
                             ui_status("File saved");
                         } else {
@@ -807,6 +1469,7 @@ static void editor_run(void)
             }
         }
 
+        refresh();
         update_cursor();
     }
 
@@ -818,17 +1481,49 @@ static void editor_run(void)
  *---------------------------------------------------------------------------*/
 void editor_view(const char *filename)
 {
+    dos_handle_t h;
+    uint32_t size = 0;
+    bool_t binary = FALSE;
+    bool_t ok;
+
+    /* Take the text buffer back from the copy engine */
+    mem_offer((void __far *)0, 0, MEM_TAG_EDITOR);
+
     /* Save screen */
     scr_save_rect(0, 0, 80, 25, g_screen_save);
     scr_clear();
 
     g_editor.readonly = TRUE;
+    g_text_lost = FALSE;
 
-    if (load_file(filename)) {
-        editor_run();
+    h = dos_open(filename, DOS_OPEN_READ);
+    if (h >= 0) {
+        size = dos_file_size(h);
+        binary = viewer_is_binary(h);
+        dos_close(h);
+    }
+
+    /* Too big for the buffer even grown: page through it instead of
+     * truncating; binary: show it as hex */
+    if (!binary) {
+        grow_text(size);
+    }
+    if (binary || size > g_editor.text.size) {
+        ok = viewer_show(filename, binary);
     } else {
+        ok = load_file(filename, FALSE);
+        if (ok) {
+            editor_run();
+        }
+        if (g_load >= 0) {
+            dos_close(g_load);
+            g_load = -1;
+        }
+    }
+    if (!ok) {
         dlg_alert("Error", "Cannot open file");
     }
+    shrink_buffers();
 
     /* Restore screen */
     scr_restore_rect(0, 0, 80, 25, g_screen_save);
@@ -839,20 +1534,45 @@ void editor_view(const char *filename)
  *---------------------------------------------------------------------------*/
 void editor_edit(const char *filename)
 {
+    dos_handle_t h;
+    bool_t fits = TRUE;
+    bool_t binary = FALSE;
+
+    /* Take the text buffer back from the copy engine */
+    mem_offer((void __far *)0, 0, MEM_TAG_EDITOR);
+
     /* Save screen */
     scr_save_rect(0, 0, 80, 25, g_screen_save);
     scr_clear();
 
     g_editor.readonly = FALSE;
+    g_text_lost = FALSE;
 
-    if (load_file(filename)) {
+    /* Make room for the whole file if it is bigger than the buffer */
+    h = dos_open(filename, DOS_OPEN_READ);
+    if (h >= 0) {
+        fits = grow_text(dos_file_size(h));
+        if (!fits) {
+            binary = viewer_is_binary(h);
+        }
+        dos_close(h);
+    }
+
+    /* Past EDIT_BUF_MAX, or short of memory with no SwapDrive: editing
+     * part of the file would truncate it on F2, so only view it */
+    if (!fits) {
+        dlg_alert("Edit", "File too large to edit - viewing it");
+        if (!viewer_show(filename, binary)) {
+            dlg_alert("Error", "Cannot open file");
+        }
+    } else if (load_file(filename, TRUE)) {
         editor_run();
     } else {
         /* New file */
         str_copy(g_editor.filename, filename);
-        g_editor.buf_used = 0;
-        g_editor.total_lines = 1;
-        g_editor.line_offs[0] = 0;
+        tb_clear(&g_editor.text);
+        li_build(&g_editor.lines, &g_editor.text);
+        undo_clear();
         g_editor.modified = FALSE;
         g_editor.top_line = 0;
         g_editor.cursor_line = 0;
@@ -860,6 +1580,7 @@ void editor_edit(const char *filename)
         g_editor.left_col = 0;
         editor_run();
     }
+    shrink_buffers();
 
     /* Restore screen */
     scr_restore_rect(0, 0, 80, 25, g_screen_save);
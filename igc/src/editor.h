@@ -7,19 +7,27 @@
 #define EDITOR_H
 
 #include "igc.h"
+#include "textbuf.h"
 
 /*---------------------------------------------------------------------------
- * Editor Buffer Sizes (based on memory tier)
+ * Editor Buffer Sizes (starting sizes by memory tier; the text buffer and
+ * line table grow for a large file and shrink back when the editor closes)
  *---------------------------------------------------------------------------*/
 #define EDIT_BUF_TINY     4096      /* Tiny memory: 4KB */
 #define EDIT_BUF_LOW      16384     /* Low memory: 16KB */
 #define EDIT_BUF_MEDIUM   32768     /* Medium memory: 32KB */
-#define EDIT_BUF_HIGH     65535     /* High memory: 64KB (max for 16-bit) */
+#define EDIT_BUF_HIGH     65535     /* High memory: at least 64KB */
+#define EDIT_BUF_MAX      262144L   /* High memory: at most 256KB */
+#define EDIT_RESERVE      65536L    /* Left free for copies and dialogs */
+#define EDIT_GROW_RESERVE 16384L    /* Left free when growing the buffer */
 
 #define EDIT_LINES_TINY   128       /* Tiny memory: 128 lines max */
 #define EDIT_LINES_LOW    512       /* Low memory: 512 lines max */
 #define EDIT_LINES_MEDIUM 1024      /* Medium memory: 1024 lines */
-#define EDIT_LINES_HIGH   2048      /* High memory: 2048 lines */
+#define EDIT_LINES_HIGH   2048      /* High memory: 2048 lines or more */
+#define EDIT_LINES_MAX    16000     /* Line table stays within a segment */
+#define EDIT_LINE_AVG     32        /* Bytes per line when sizing above 64KB */
+#define EDIT_LOAD_CHUNK   4096      /* Bytes read per load step */
 
 /*---------------------------------------------------------------------------
  * Editor Display Constants
@@ -33,12 +41,8 @@
  * Editor Structure
  *---------------------------------------------------------------------------*/
 typedef struct {
-    char __far *buffer;             /* Text buffer (far heap) */
-    uint16_t __far *line_offs;      /* Line offset table (far heap) */
-    uint32_t buf_size;              /* Buffer capacity */
-    uint32_t buf_used;              /* Bytes used in buffer */
-    uint16_t max_lines;             /* Maximum lines capacity */
-    uint16_t total_lines;           /* Actual line count */
+    TextBuf  text;                  /* Gap buffer holding the file */
+    LineIndex lines;                /* Line start offsets */
     uint16_t top_line;              /* First visible line (0-based) */
     uint16_t cursor_line;           /* Cursor line (0-based) */
     uint16_t cursor_col;            /* Cursor column (0-based) */
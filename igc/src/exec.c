@@ -0,0 +1,149 @@
+/*
+ * exec.c - IGC Program Launcher Implementation
+ *
+ * A program runs in its own directory with the screen handed back to
+ * DOS.  With swapping on, every DOS block IGC holds - panel lists, the
+ * editor and copy buffers, pools - is first written to IGC.IMG and
+ * freed (mem_swap_out), leaving the child all memory above IGC's own
+ * code and data.  Afterwards the blocks are rebuilt at the same segments
+ * and read back, so the panels come back exactly as they were without
+ * reading any directory again.
+ */
+
+#include "exec.h"
+#include "mem.h"
+#include "screen.h"
+#include "keyboard.h"
+#include "dosapi.h"
+#include "swap.h"
+#include "util.h"
+
+/*---------------------------------------------------------------------------
+ * Static variables
+ *---------------------------------------------------------------------------*/
+static const char *IMAGE_FILE = "IGC.IMG";
+
+static bool_t g_exec_swap = TRUE;
+
+/*---------------------------------------------------------------------------
+ * exec_is_program - TRUE for .EXE, .COM and .BAT files
+ *---------------------------------------------------------------------------*/
+bool_t exec_is_program(const char *name)
+{
+    const char *ext = str_find_last(name, '.');
+
+    if (ext == (const char *)0) {
+        return FALSE;
+    }
+    return (str_cmp_i(ext, ".EXE") == 0 || str_cmp_i(ext, ".COM") == 0 ||
+            str_cmp_i(ext, ".BAT") == 0) ? TRUE : FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * exec_set_swap / exec_get_swap - Swap the far heap out while running
+ *---------------------------------------------------------------------------*/
+void exec_set_swap(bool_t on)
+{
+    g_exec_swap = on;
+}
+
+bool_t exec_get_swap(void)
+{
+    return g_exec_swap;
+}
+
+/*---------------------------------------------------------------------------
+ * say - Write a line to standard output while DOS owns the screen
+ *---------------------------------------------------------------------------*/
+static void say(const char *text)
+{
+    dos_write(1, "\r\n", 2);
+    dos_write(1, text, str_len(text));
+}
+
+/*---------------------------------------------------------------------------
+ * exec_run - Run a program and wait for a key afterwards
+ *
+ * A batch file is run through COMSPEC /C.  The image goes to the root of
+ * the swap drive if one is set, else of the current drive; if the heap
+ * cannot be written the program still runs, with less memory.  The
+ * current drive and directory are put back afterwards.
+ *---------------------------------------------------------------------------*/
+int16_t exec_run(uint8_t drive, const char *dir, const char *name)
+{
+    char prog[MAX_PATH_LEN + MAX_FILENAME];
+    char args[MAX_PATH_LEN + MAX_FILENAME + 3];
+    char cwd[MAX_PATH_LEN + 3];
+    char saved[MAX_PATH_LEN + 3];
+    char image[16];
+    uint8_t old_drive = dos_get_drive();
+    uint8_t image_drive;
+    uint16_t len;
+    bool_t swapped = FALSE;
+    int16_t rc;
+
+    path_build(prog, drive, dir, name);
+    args[0] = '\0';
+
+    if (str_cmp_i(str_find_last(name, '.'), ".BAT") == 0) {
+        str_copy(args, "/C ");
+        str_copy(args + 3, prog);
+        if (!dos_get_env("COMSPEC", prog, sizeof(prog))) {
+            str_copy(prog, "\\COMMAND.COM");
+        }
+    }
+
+    /* The program starts in its own directory */
+    path_build(cwd, drive, dir, "");
+    len = str_len(cwd);
+    if (len > 3) {
+        cwd[len - 1] = '\0';
+    }
+    saved[0] = cwd[0];
+    saved[1] = ':';
+    saved[2] = '\\';
+    if (dos_get_curdir(drive + 1, &saved[3]) != 0) {
+        saved[3] = '\0';
+    }
+
+    image_drive = swap_get_drive();
+    image[0] = 'A' + ((image_drive != 0) ? image_drive - 1 : old_drive);
+    image[1] = ':';
+    image[2] = '\\';
+    str_copy(&image[3], IMAGE_FILE);
+
+    /* Hand the screen to DOS */
+    scr_clear();
+    scr_cursor_on();
+    scr_exit();
+
+    dos_set_drive(drive);
+    dos_chdir(cwd);
+
+    if (g_exec_swap) {
+        swapped = mem_swap_out(image);
+    }
+
+    rc = dos_exec(prog, args);
+
+    /* Without its heap IGC cannot draw anything: stop here */
+    if (swapped && !mem_swap_in()) {
+        say("IGC: memory taken by a resident program, cannot continue");
+        say("");
+        dos_exit(1);
+    }
+
+    if (rc >= 0) {
+        say("Press any key to return to IGC");
+        kbd_flush();
+        kbd_wait();
+    }
+
+    dos_chdir(saved);
+    dos_set_drive(old_drive);
+
+    scr_init();
+    scr_clear();
+    scr_cursor_off();
+    return rc;
+}
@@ -0,0 +1,29 @@
+/*
+ * exec.h - IGC Program Launcher
+ * Runs .EXE, .COM and .BAT files from the panels (Enter)
+ */
+
+#ifndef EXEC_H
+#define EXEC_H
+
+#include "igc.h"
+
+/*---------------------------------------------------------------------------
+ * Launcher
+ *---------------------------------------------------------------------------*/
+
+/* TRUE if name ends in .EXE, .COM or .BAT */
+bool_t exec_is_program(const char *name);
+
+/* Swap IGC's far heap out to IGC.IMG while a program runs (on/off) */
+void exec_set_swap(bool_t on);
+
+/* Whether the far heap is swapped out while a program runs */
+bool_t exec_get_swap(void);
+
+/* Run a program in its own directory and wait for a key afterwards.
+ * Returns its exit code, or -1 if it could not be started; the caller
+ * redraws the screen. */
+int16_t exec_run(uint8_t drive, const char *dir, const char *name);
+
+#endif /* EXEC_H */
@@ -10,16 +10,30 @@
 #include "util.h"
 #include "screen.h"
 #include "keyboard.h"
+#include "jobs.h"
+#include "journal.h"
 
 /*---------------------------------------------------------------------------
  * Static variables
  *---------------------------------------------------------------------------*/
 static uint8_t __far *g_copy_buf = (uint8_t __far *)0;
 static uint16_t g_copy_buf_size = 0;
+static uint8_t __far *g_own_buf = (uint8_t __far *)0;  /* g_copy_buf when */
+static uint16_t g_own_buf_size = 0;                    /* nothing is lent */
 static int g_overwrite_all = 0;     /* 1 = overwrite all without asking */
 static uint16_t g_file_count = 0;   /* For progress display */
 static uint16_t g_file_current = 0;
 
+/* Verify-after-copy state */
+static bool_t g_verify = FALSE;     /* Re-read and CRC-check each copy */
+static uint16_t g_verify_ok = 0;    /* Files that verified */
+static uint16_t g_verify_fail = 0;  /* Files whose CRC did not match */
+static char g_verify_bad[13];       /* First file that failed */
+
+/* Resume state (set from IGC.JRN by fops_resume) */
+static uint16_t g_resume_skip = 0;  /* Files finished before interruption */
+static uint32_t g_resume_offset = 0; /* Bytes already in the partial file */
+
 /*---------------------------------------------------------------------------
  * fops_init - Initialize file operations module
  *---------------------------------------------------------------------------*/
@@ -44,13 +58,16 @@ bool_t fops_init(void)
             break;
     }
 
-    g_copy_buf = (uint8_t __far *)mem_alloc(g_copy_buf_size);
+    g_copy_buf = (uint8_t __far *)mem_alloc(g_copy_buf_size, MEM_TAG_COPY);
     if (g_copy_buf == (uint8_t __far *)0) {
         /* Try smallest buffer */
         g_copy_buf_size = COPY_BUF_TINY;
-        g_copy_buf = (uint8_t __far *)mem_alloc(g_copy_buf_size);
+        g_copy_buf = (uint8_t __far *)mem_alloc(g_copy_buf_size, MEM_TAG_COPY);
     }
 
+    g_own_buf = g_copy_buf;
+    g_own_buf_size = g_copy_buf_size;
+
     return (g_copy_buf != (uint8_t __far *)0) ? TRUE : FALSE;
 }
 
@@ -59,12 +76,148 @@ bool_t fops_init(void)
  *---------------------------------------------------------------------------*/
 void fops_shutdown(void)
 {
-    if (g_copy_buf != (uint8_t __far *)0) {
-        mem_free(g_copy_buf);
+    if (g_own_buf != (uint8_t __far *)0) {
+        mem_free(g_own_buf);
+        g_own_buf = (uint8_t __far *)0;
         g_copy_buf = (uint8_t __far *)0;
     }
 }
 
+/*---------------------------------------------------------------------------
+ * fops_get_buffer - Shared copy buffer (used by background jobs)
+ * Jobs always get the engine's own buffer, which keeps their slices short.
+ *---------------------------------------------------------------------------*/
+uint8_t __far *fops_get_buffer(uint16_t *size)
+{
+    *size = g_own_buf_size;
+    return g_own_buf;
+}
+
+/*---------------------------------------------------------------------------
+ * borrow_buffer - Copy through the editor's idle text buffer if it is
+ * bigger than our own (the editor is closed whenever a copy runs)
+ *---------------------------------------------------------------------------*/
+static void borrow_buffer(void)
+{
+    uint32_t size;
+    uint8_t __far *buf = (uint8_t __far *)mem_borrow(&size, MEM_TAG_COPY);
+
+    if (buf == (uint8_t __far *)0) {
+        return;
+    }
+    if (size > COPY_BUF_LOAN_MAX) {
+        size = COPY_BUF_LOAN_MAX;
+    }
+    if (size <= g_own_buf_size) {
+        mem_give_back();
+        return;
+    }
+
+    g_copy_buf = buf;
+    g_copy_buf_size = (uint16_t)size;
+}
+
+/*---------------------------------------------------------------------------
+ * return_buffer - Go back to our own buffer
+ *---------------------------------------------------------------------------*/
+static void return_buffer(void)
+{
+    if (g_copy_buf != g_own_buf) {
+        mem_give_back();
+        g_copy_buf = g_own_buf;
+        g_copy_buf_size = g_own_buf_size;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * fops_set_verify / fops_get_verify - Verify-after-copy mode
+ *---------------------------------------------------------------------------*/
+void fops_set_verify(bool_t on)
+{
+    g_verify = on ? TRUE : FALSE;
+}
+
+bool_t fops_get_verify(void)
+{
+    return g_verify;
+}
+
+/*---------------------------------------------------------------------------
+ * verify_reset - Clear verify counters before an operation
+ *---------------------------------------------------------------------------*/
+static void verify_reset(void)
+{
+    g_verify_ok = 0;
+    g_verify_fail = 0;
+    g_verify_bad[0] = '\0';
+}
+
+/*---------------------------------------------------------------------------
+ * verify_summary - Report verify results after an operation
+ *---------------------------------------------------------------------------*/
+static void verify_summary(void)
+{
+    char msg[60];
+
+    if (!g_verify || (g_verify_ok == 0 && g_verify_fail == 0)) {
+        return;
+    }
+
+    num_format(msg, g_verify_ok);
+    str_copy(msg + str_len(msg), " OK, ");
+    num_format(msg + str_len(msg), g_verify_fail);
+    str_copy(msg + str_len(msg), " failed");
+    if (g_verify_fail > 0) {
+        str_copy(msg + str_len(msg), " (");
+        str_copy(msg + str_len(msg), g_verify_bad);
+        str_copy(msg + str_len(msg), ")");
+    }
+
+    dlg_alert("Verify", msg);
+}
+
+/*---------------------------------------------------------------------------
+ * verify_file - Re-read destination and compare against source CRC
+ *
+ * DOS buffers are flushed first so the data comes back from the media
+ * rather than from the sectors DOS still holds from the write.
+ *---------------------------------------------------------------------------*/
+static int verify_file(const char *dst, uint32_t src_crc)
+{
+    dos_handle_t h;
+    int16_t bytes_read;
+    uint32_t crc = CRC32_INIT;
+
+    dos_disk_reset();
+
+    h = dos_open(dst, DOS_OPEN_READ);
+    if (h >= 0) {
+        while ((bytes_read = dos_read(h, g_copy_buf, g_copy_buf_size)) > 0) {
+            crc = crc32_update(crc, g_copy_buf, (uint16_t)bytes_read);
+        }
+        dos_close(h);
+        if (bytes_read == 0 && crc == src_crc) {
+            g_verify_ok++;
+            return FOPS_OK;
+        }
+    }
+
+    if (g_verify_fail == 0) {
+        str_copy_n(g_verify_bad, path_basename(dst), 13);
+    }
+    g_verify_fail++;
+
+    return FOPS_ERROR;
+}
+
+/*---------------------------------------------------------------------------
+ * fops_verify_file - Verify step for copies made outside copy_file_data
+ *---------------------------------------------------------------------------*/
+bool_t fops_verify_file(const char *dst, uint32_t crc)
+{
+    return (verify_file(dst, crc) == FOPS_OK) ? TRUE : FALSE;
+}
+
 /*---------------------------------------------------------------------------
  * build_src_path - Build source path for current file
  *---------------------------------------------------------------------------*/
@@ -102,16 +255,67 @@ static void build_dst_path(Panel *p, const char *filename, char *buf)
 }
 
 /*---------------------------------------------------------------------------
- * fops_copy_file - Copy a single file
+ * resume_source - Position source at the resume offset
+ *
+ * With verify on, the part already copied is read through the CRC so the
+ * check still covers the whole file; otherwise a seek is enough.
  *---------------------------------------------------------------------------*/
-int fops_copy_file(const char *src, const char *dst)
+static int resume_source(dos_handle_t src_h, uint32_t pos, uint32_t *crc)
+{
+    uint32_t left = pos;
+    uint16_t n;
+
+    if (!g_verify) {
+        return (dos_seek(src_h, (int32_t)pos, DOS_SEEK_SET) < 0) ? FOPS_ERROR : FOPS_OK;
+    }
+
+    while (left > 0) {
+        n = (left < g_copy_buf_size) ? (uint16_t)left : g_copy_buf_size;
+        if (dos_read(src_h, g_copy_buf, n) != (int16_t)n) {
+            return FOPS_ERROR;
+        }
+        *crc = crc32_update(*crc, g_copy_buf, n);
+        left -= n;
+    }
+
+    return FOPS_OK;
+}
+
+/*---------------------------------------------------------------------------
+ * copy_file_data - Copy one file (fops_copy_file does the journal count)
+ *
+ * While a journal is open the position is marked every JRN_CHECKPOINT
+ * bytes.  An interrupted file (ESC or a read/write error) is then kept
+ * and reported as FOPS_CANCEL, so the whole copy stops at a point the
+ * resume command can continue from.
+ *---------------------------------------------------------------------------*/
+static int copy_file_data(const char *src, const char *dst)
 {
-    dos_handle_t src_h, dst_h;
+    dos_handle_t src_h;
+    dos_handle_t dst_h = -1;
     int16_t bytes_read, bytes_written;
+    uint32_t crc = CRC32_INIT;
+    uint32_t pos = 0;
+    uint32_t mark = 0;
     int result = FOPS_OK;
 
+    /* Pick up a partial file where the journal left it */
+    if (g_resume_offset > 0) {
+        pos = g_resume_offset;
+        g_resume_offset = 0;
+        dst_h = dos_open(dst, DOS_OPEN_WRITE);
+        if (dst_h >= 0 && dos_seek(dst_h, (int32_t)pos, DOS_SEEK_SET) < 0) {
+            dos_close(dst_h);
+            dst_h = -1;
+        }
+        if (dst_h < 0) {
+            pos = 0;
+        }
+        mark = pos;
+    }
+
     /* Check if destination exists */
-    if (dos_exists(dst)) {
+    if (dst_h < 0 && dos_exists(dst)) {
         if (!g_overwrite_all) {
             int ow = dlg_overwrite(path_basename(dst));
             if (ow == DLG_NO) {
@@ -128,14 +332,18 @@ int fops_copy_file(const char *src, const char *dst)
 
     /* Open source file */
     src_h = dos_open(src, DOS_OPEN_READ);
-    if (src_h < 0) {
+    if (src_h < 0 || (pos > 0 && resume_source(src_h, pos, &crc) != FOPS_OK)) {
+        if (src_h >= 0) dos_close(src_h);
+        if (dst_h >= 0) dos_close(dst_h);
         ui_error("Cannot open source file");
         kbd_wait();
         return FOPS_ERROR;
     }
 
     /* Create destination file */
-    dst_h = dos_create(dst, 0);
+    if (dst_h < 0) {
+        dst_h = dos_create(dst, 0);
+    }
     if (dst_h < 0) {
         dos_close(src_h);
         ui_error("Cannot create destination file");
@@ -154,11 +362,23 @@ int fops_copy_file(const char *src, const char *dst)
             break;  /* EOF */
         }
 
+        /* CRC the source data while it is in the buffer */
+        if (g_verify) {
+            crc = crc32_update(crc, g_copy_buf, (uint16_t)bytes_read);
+        }
+
         bytes_written = dos_write(dst_h, g_copy_buf, (uint16_t)bytes_read);
         if (bytes_written != bytes_read) {
             result = FOPS_ERROR;
             break;
         }
+        pos += (uint16_t)bytes_written;
+
+        /* Checkpoint long files so a power cut loses little */
+        if (jrn_active() && pos - mark >= JRN_CHECKPOINT) {
+            jrn_mark(dst_h, pos);
+            mark = pos;
+        }
 
         /* Check for user cancel (ESC) */
         if (kbd_check()) {
@@ -174,7 +394,43 @@ int fops_copy_file(const char *src, const char *dst)
     dos_close(dst_h);
 
     if (result != FOPS_OK) {
+        if (jrn_active() && pos > 0) {
+            /* Keep the partial file; resume appends to it */
+            jrn_mark(-1, pos);
+            return FOPS_CANCEL;
+        }
         dos_delete(dst);  /* Clean up partial file */
+        return result;
+    }
+
+    /* Verify failure keeps the copy but reports it (and stops a move) */
+    if (g_verify) {
+        result = verify_file(dst, crc);
+    }
+
+    return result;
+}
+
+/*---------------------------------------------------------------------------
+ * fops_copy_file - Copy a single file
+ *---------------------------------------------------------------------------*/
+int fops_copy_file(const char *src, const char *dst)
+{
+    int result;
+
+    /* Resuming: files before the checkpoint were finished last time */
+    if (g_resume_skip > 0) {
+        g_resume_skip--;
+        return FOPS_SKIP;
+    }
+
+    borrow_buffer();
+    result = copy_file_data(src, dst);
+    return_buffer();
+
+    /* Everything but an interruption moves the journal on */
+    if (result != FOPS_CANCEL) {
+        jrn_file_done();
     }
 
     return result;
@@ -187,9 +443,10 @@ int fops_copy_dir(const char *src, const char *dst)
 {
     char src_path[80];
     char dst_path[80];
-    DTA dta;
-    DTA __far *old_dta;
+    DirEnum dir;
+    DTA *dta;
     int result = FOPS_OK;
+    bool_t failed = FALSE;
 
     /* Create destination directory */
     if (dos_mkdir(dst) != 0) {
@@ -204,52 +461,43 @@ int fops_copy_dir(const char *src, const char *dst)
     str_copy(src_path, src);
     path_append(src_path, "*.*");
 
-    /* Save and set DTA */
-    old_dta = dos_get_dta();
-    dos_set_dta(&dta);
-
-    /* Find first file */
-    if (dos_find_first(src_path, 0x37) == 0) {
-        do {
-            /* Skip . and .. */
-            if (dta.name[0] == '.') {
-                if (dta.name[1] == '\0' ||
-                    (dta.name[1] == '.' && dta.name[2] == '\0')) {
-                    continue;
-                }
-            }
-
-            /* Build full paths */
-            str_copy(src_path, src);
-            path_append(src_path, dta.name);
-            str_copy(dst_path, dst);
-            path_append(dst_path, dta.name);
+    dir_open(&dir, src_path, 0x37);
+    while ((dta = dir_next(&dir)) != (DTA *)0) {
+        /* Build full paths */
+        str_copy(src_path, src);
+        path_append(src_path, dta->name);
+        str_copy(dst_path, dst);
+        path_append(dst_path, dta->name);
 
-            /* Update progress */
-            g_file_current++;
-            ui_show_progress("Copying", dta.name, g_file_current, g_file_count);
+        /* Update progress */
+        g_file_current++;
+        ui_show_progress("Copying", dta->name, g_file_current, g_file_count);
 
-            if (dta.attr & DOS_ATTR_DIRECTORY) {
-                /* Recurse into subdirectory */
-                result = fops_copy_dir(src_path, dst_path);
-            } else {
-                /* Copy file */
-                result = fops_copy_file(src_path, dst_path);
-            }
-
-            if (result == FOPS_CANCEL) {
-                break;
-            }
-            /* Continue on SKIP or ERROR for single files */
-            if (result == FOPS_SKIP) {
-                result = FOPS_OK;
-            }
+        if (dta->attr & DOS_ATTR_DIRECTORY) {
+            /* Recurse into subdirectory */
+            result = fops_copy_dir(src_path, dst_path);
+        } else {
+            /* Copy file */
+            result = fops_copy_file(src_path, dst_path);
+        }
 
-        } while (dos_find_next() == 0 && result != FOPS_CANCEL);
+        if (result == FOPS_CANCEL) {
+            break;
+        }
+        /* Continue on SKIP or ERROR for single files, but remember
+         * errors so a move does not delete an incomplete source */
+        if (result == FOPS_ERROR) {
+            failed = TRUE;
+        }
+        if (result == FOPS_SKIP || result == FOPS_ERROR) {
+            result = FOPS_OK;
+        }
     }
+    dir_close(&dir);
 
-    /* Restore DTA */
-    dos_set_dta(old_dta);
+    if (result == FOPS_OK && failed) {
+        result = FOPS_ERROR;
+    }
 
     return result;
 }
@@ -274,69 +522,106 @@ int fops_delete_file(const char *path)
     return FOPS_OK;
 }
 
+/*---------------------------------------------------------------------------
+ * fops_delete_plain - Fast path: delete all plain files in a directory
+ *
+ * Makes the directory current on its drive and issues one FCB delete for
+ * "*.*", which removes every normal file in a single DOS call.  Read-only,
+ * hidden and system files are not matched and are left for the slow pass.
+ * The drive's previous current directory is restored afterwards.
+ *---------------------------------------------------------------------------*/
+void fops_delete_plain(const char *path)
+{
+    char saved[MAX_PATH_LEN + 3];
+    char pattern[6];
+    uint8_t drive = (uint8_t)(char_upper(path[0]) - 'A');
+
+    /* Save current directory of the target drive ("D:\dir") */
+    saved[0] = path[0];
+    saved[1] = ':';
+    saved[2] = '\\';
+    if (dos_get_curdir(drive + 1, &saved[3]) != 0) {
+        return;
+    }
+
+    if (dos_chdir(path) != 0) {
+        return;
+    }
+
+    pattern[0] = path[0];
+    pattern[1] = ':';
+    pattern[2] = '*';
+    pattern[3] = '.';
+    pattern[4] = '*';
+    pattern[5] = '\0';
+    dos_fcb_delete(pattern);
+
+    dos_chdir(saved);
+}
+
 /*---------------------------------------------------------------------------
  * fops_delete_dir - Delete directory recursively
+ *
+ * Plain files are removed first with one FCB wildcard delete.  The search
+ * pass that follows only sees what is left: subdirectories and read-only,
+ * hidden or system files, whose attributes are cleared from the DTA copy
+ * before deleting (no extra get-attribute call).
  *---------------------------------------------------------------------------*/
 int fops_delete_dir(const char *path)
 {
     char full_path[80];
-    DTA dta;
-    DTA __far *old_dta;
+    DirEnum dir;
+    DTA *dta;
     int result = FOPS_OK;
 
+    /* Fast path: all plain files in one DOS call */
+    ui_show_progress("Deleting", path_basename(path), g_file_current, g_file_count);
+    fops_delete_plain(path);
+
     /* Build search pattern */
     str_copy(full_path, path);
     path_append(full_path, "*.*");
 
-    /* Save and set DTA */
-    old_dta = dos_get_dta();
-    dos_set_dta(&dta);
-
-    /* Find first file */
-    if (dos_find_first(full_path, 0x37) == 0) {
-        do {
-            /* Skip . and .. */
-            if (dta.name[0] == '.') {
-                if (dta.name[1] == '\0' ||
-                    (dta.name[1] == '.' && dta.name[2] == '\0')) {
-                    continue;
-                }
-            }
-
-            /* Build full path */
-            str_copy(full_path, path);
-            path_append(full_path, dta.name);
+    /* Walk the remaining entries */
+    dir_open(&dir, full_path, 0x37);
+    while ((dta = dir_next(&dir)) != (DTA *)0) {
+        /* Build full path */
+        str_copy(full_path, path);
+        path_append(full_path, dta->name);
 
-            /* Update progress */
-            g_file_current++;
-            ui_show_progress("Deleting", dta.name, g_file_current, g_file_count);
+        /* Update progress */
+        g_file_current++;
+        ui_show_progress("Deleting", dta->name, g_file_current, g_file_count);
 
-            if (dta.attr & DOS_ATTR_DIRECTORY) {
-                /* Recurse into subdirectory */
-                result = fops_delete_dir(full_path);
-            } else {
-                /* Delete file */
-                result = fops_delete_file(full_path);
+        if (dta->attr & DOS_ATTR_DIRECTORY) {
+            /* Recurse into subdirectory */
+            result = fops_delete_dir(full_path);
+        } else {
+            /* Special file - clear attributes, then delete */
+            if (dta->attr & (DOS_ATTR_READONLY | DOS_ATTR_HIDDEN | DOS_ATTR_SYSTEM)) {
+                dos_set_attr(full_path, 0);
             }
-
-            if (result == FOPS_CANCEL) {
-                break;
+            if (dos_delete(full_path) != 0) {
+                ui_error("Cannot delete file");
+                kbd_wait();
+                result = FOPS_ERROR;
             }
+        }
 
-            /* Check for user cancel (ESC) */
-            if (kbd_check()) {
-                KeyEvent key = kbd_get();
-                if (key.code == KEY_ESC) {
-                    result = FOPS_CANCEL;
-                    break;
-                }
-            }
+        if (result == FOPS_CANCEL) {
+            break;
+        }
 
-        } while (dos_find_next() == 0 && result != FOPS_CANCEL);
+        /* Check for user cancel (ESC) */
+        if (kbd_check()) {
+            KeyEvent key = kbd_get();
+            if (key.code == KEY_ESC) {
+                result = FOPS_CANCEL;
+                break;
+            }
+        }
     }
-
-    /* Restore DTA */
-    dos_set_dta(old_dta);
+    dir_close(&dir);
 
     /* Remove the now-empty directory */
     if (result == FOPS_OK) {
@@ -368,6 +653,171 @@ static uint16_t count_selected_files(Panel *p)
     return count;
 }
 
+/*---------------------------------------------------------------------------
+ * journal_begin - Record a copy's entries in IGC.JRN
+ *
+ * Failure to create the journal is not an error; the copy just cannot be
+ * resumed.
+ *---------------------------------------------------------------------------*/
+static void journal_begin(Panel *src_panel, Panel *dst_panel, FileEntry __far *single)
+{
+    FileEntry __far *f;
+    char src_dir[80];
+    char dst_dir[80];
+    uint16_t i;
+
+    build_dst_path(src_panel, "", src_dir);
+    build_dst_path(dst_panel, "", dst_dir);
+
+    if (!jrn_begin(src_dir, dst_dir)) {
+        return;
+    }
+
+    if (single != (FileEntry __far *)0) {
+        jrn_add_item(single->name);
+    } else {
+        for (i = 0; i < src_panel->files.count; i++) {
+            f = panel_get_file(src_panel, i);
+            if (f != (FileEntry __far *)0 && f->selected) {
+                jrn_add_item(f->name);
+            }
+        }
+    }
+
+    jrn_ready();
+}
+
+/*---------------------------------------------------------------------------
+ * journal_end - Drop the journal, or keep it if the copy was interrupted
+ *---------------------------------------------------------------------------*/
+static void journal_end(int result)
+{
+    if (!jrn_active()) {
+        return;
+    }
+
+    if (result == FOPS_CANCEL) {
+        jrn_end(FALSE);
+        ui_status("Copy interrupted - press R to resume");
+    } else {
+        jrn_end(TRUE);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * copy_selected - Copy all selected entries of src panel into dst panel
+ *---------------------------------------------------------------------------*/
+static int copy_selected(Panel *src_panel, Panel *dst_panel, uint16_t selected)
+{
+    FileEntry __far *f;
+    char src_path[80];
+    char dst_path[80];
+    uint16_t i;
+    int result = FOPS_OK;
+
+    g_file_count = selected;
+    journal_begin(src_panel, dst_panel, (FileEntry __far *)0);
+
+    for (i = 0; i < src_panel->files.count && result != FOPS_CANCEL; i++) {
+        f = panel_get_file(src_panel, i);
+        if (f == (FileEntry __far *)0 || !f->selected) continue;
+
+        build_src_path(src_panel, f, src_path);
+        build_dst_path(dst_panel, f->name, dst_path);
+
+        g_file_current++;
+        ui_show_progress("Copying", f->name, g_file_current, g_file_count);
+
+        if (file_is_dir(f)) {
+            result = fops_copy_dir(src_path, dst_path);
+        } else {
+            result = fops_copy_file(src_path, dst_path);
+        }
+
+        if (result == FOPS_SKIP) {
+            result = FOPS_OK;
+        }
+    }
+
+    return result;
+}
+
+/*---------------------------------------------------------------------------
+ * queue_items - Hand the selection (or one entry) to the background queue
+ *
+ * Jobs cannot ask questions, so the overwrite prompt of copy_file_data
+ * is put here, once per top-level entry that is already at the
+ * destination, and the answer goes into the job.
+ *---------------------------------------------------------------------------*/
+static int queue_items(uint8_t type, Panel *src_panel, Panel *dst_panel,
+                       FileEntry __far *single)
+{
+    FileEntry __far *f;
+    char src_path[80];
+    char dst_path[80];
+    char msg[40];
+    uint16_t i;
+    uint16_t queued = 0;
+    bool_t overwrite;
+    int ow;
+
+    for (i = 0; i < src_panel->files.count; i++) {
+        f = panel_get_file(src_panel, i);
+        if (single != (FileEntry __far *)0) {
+            f = single;
+        } else if (f == (FileEntry __far *)0 || !f->selected) {
+            continue;
+        }
+
+        build_src_path(src_panel, f, src_path);
+        dst_path[0] = '\0';
+        overwrite = (g_overwrite_all != 0) ? TRUE : FALSE;
+        if (dst_panel != (Panel *)0) {
+            build_dst_path(dst_panel, f->name, dst_path);
+
+            /* Creating the target would truncate the source first */
+            if (str_cmp_i(src_path, dst_path) == 0) {
+                dlg_alert("Background", "Source and target are the same");
+                break;
+            }
+
+            if (!overwrite && dos_exists(dst_path)) {
+                ow = dlg_overwrite(f->name);
+                if (ow == DLG_NO) {
+                    if (single != (FileEntry __far *)0) break;
+                    continue;
+                } else if (ow == 'A') {
+                    g_overwrite_all = 1;
+                } else if (ow != DLG_YES) {
+                    break;
+                }
+                overwrite = TRUE;
+            }
+        }
+
+        if (!jobs_add(type, src_path, dst_path, file_is_dir(f), overwrite)) {
+            ui_error("Job queue is full");
+            break;
+        }
+        queued++;
+
+        if (single != (FileEntry __far *)0) break;
+    }
+
+    if (single == (FileEntry __far *)0) {
+        panel_clear_selection(src_panel);
+    }
+
+    if (queued == 0) {
+        return FOPS_ERROR;
+    }
+
+    num_format(msg, queued);
+    str_copy(msg + str_len(msg), " job(s) queued - J to view");
+    ui_status(msg);
+    return FOPS_OK;
+}
+
 /*---------------------------------------------------------------------------
  * fops_copy - Copy selected files to other panel
  *---------------------------------------------------------------------------*/
@@ -378,13 +828,13 @@ int fops_copy(void)
     FileEntry __far *f;
     char src_path[80];
     char dst_path[80];
-    uint16_t i;
     uint16_t selected;
     int result = FOPS_OK;
 
     /* Reset state */
     g_overwrite_all = 0;
     g_file_current = 0;
+    verify_reset();
 
     /* Count selected files */
     selected = count_selected_files(src_panel);
@@ -404,11 +854,16 @@ int fops_copy(void)
             return FOPS_CANCEL;
         }
 
+        if (jobs_get_background()) {
+            return queue_items(JOB_COPY, src_panel, dst_panel, f);
+        }
+
         build_src_path(src_panel, f, src_path);
         build_dst_path(dst_panel, f->name, dst_path);
 
         g_file_count = 1;
         ui_show_progress("Copying", f->name, 0, 1);
+        journal_begin(src_panel, dst_panel, f);
 
         if (file_is_dir(f)) {
             result = fops_copy_dir(src_path, dst_path);
@@ -426,38 +881,250 @@ int fops_copy(void)
             return FOPS_CANCEL;
         }
 
-        g_file_count = selected;
+        if (jobs_get_background()) {
+            return queue_items(JOB_COPY, src_panel, dst_panel, (FileEntry __far *)0);
+        }
 
-        for (i = 0; i < src_panel->files.count && result != FOPS_CANCEL; i++) {
-            f = panel_get_file(src_panel, i);
-            if (f == (FileEntry __far *)0 || !f->selected) continue;
+        result = copy_selected(src_panel, dst_panel, selected);
+    }
 
-            build_src_path(src_panel, f, src_path);
-            build_dst_path(dst_panel, f->name, dst_path);
+    ui_hide_progress();
+    journal_end(result);
+    verify_summary();
 
-            g_file_current++;
-            ui_show_progress("Copying", f->name, g_file_current, g_file_count);
+    /* Refresh destination panel */
+    panel_read_dir(dst_panel);
 
-            if (file_is_dir(f)) {
-                result = fops_copy_dir(src_path, dst_path);
-            } else {
-                result = fops_copy_file(src_path, dst_path);
-            }
+    return result;
+}
 
-            if (result == FOPS_SKIP) {
-                result = FOPS_OK;
+/*---------------------------------------------------------------------------
+ * file_stamp - Combined DOS date/time for newer/older comparison
+ *---------------------------------------------------------------------------*/
+static uint32_t file_stamp(FileEntry __far *f)
+{
+    return ((uint32_t)f->date << 16) | f->time;
+}
+
+/*---------------------------------------------------------------------------
+ * next_plain_file - Advance index to the next non-directory entry
+ *---------------------------------------------------------------------------*/
+static uint16_t next_plain_file(Panel *p, uint16_t i)
+{
+    FileEntry __far *f;
+
+    while ((f = panel_get_file(p, i)) != (FileEntry __far *)0 &&
+           file_is_dir(f)) {
+        i++;
+    }
+    return i;
+}
+
+/*---------------------------------------------------------------------------
+ * fops_sync - Copy only new and changed files to other panel
+ *
+ * Both panels are sorted the same way (directories first, then names
+ * case-insensitively), so their file runs are matched with one merge pass
+ * over the listings - no per-file DOS calls.  A source file is
+ * selected when it is missing from the target, newer than the target, or
+ * has the same date/time but a different size.  Selected files are then
+ * copied with a single confirmation and no overwrite prompts.
+ *---------------------------------------------------------------------------*/
+int fops_sync(void)
+{
+    Panel *src_panel = panel_get_active();
+    Panel *dst_panel = panel_get_other();
+    FileEntry __far *f;
+    FileEntry __far *g;
+    uint16_t i, j;
+    uint16_t n_new = 0;
+    uint16_t n_newer = 0;
+    uint16_t n_changed = 0;
+    uint16_t selected;
+    int cmp;
+    int result;
+    char name[MAX_FILENAME];
+    char msg[60];
+
+    if (src_panel->drive == dst_panel->drive &&
+        str_cmp_i(src_panel->path, dst_panel->path) == 0) {
+        dlg_alert("Synchronize", "Both panels show the same directory");
+        return FOPS_CANCEL;
+    }
+
+    /* Compare against fresh listings */
+    panel_refresh(src_panel);
+    panel_refresh(dst_panel);
+
+    if (src_panel->files.truncated) {
+        dlg_alert("Synchronize", "Source directory too large to compare");
+        return FOPS_CANCEL;
+    }
+    if (dst_panel->files.truncated) {
+        dlg_alert("Synchronize", "Target directory too large to compare");
+        return FOPS_CANCEL;
+    }
+
+    panel_clear_selection(src_panel);
+
+    i = next_plain_file(src_panel, 0);
+    j = next_plain_file(dst_panel, 0);
+
+    while ((f = panel_get_file(src_panel, i)) != (FileEntry __far *)0) {
+        /* Advance target past names that sort before this one.  The
+         * walk may page spilled entries in and out, so f is fetched
+         * again afterwards. */
+        str_copy(name, f->name);
+        cmp = -1;
+        while ((g = panel_get_file(dst_panel, j)) != (FileEntry __far *)0) {
+            cmp = str_cmp_i(name, g->name);
+            if (cmp <= 0) break;
+            j++;
+        }
+        f = panel_get_file(src_panel, i);
+        if (f == (FileEntry __far *)0) {
+            break;
+        }
+
+        if (cmp != 0) {
+            panel_select_file(src_panel, i);
+            n_new++;
+        } else {
+            if (file_stamp(f) > file_stamp(g)) {
+                panel_select_file(src_panel, i);
+                n_newer++;
+            } else if (file_stamp(f) == file_stamp(g) && f->size != g->size) {
+                panel_select_file(src_panel, i);
+                n_changed++;
             }
+            j++;
         }
+
+        i++;
     }
 
+    selected = n_new + n_newer + n_changed;
+
+    if (selected == 0) {
+        dlg_alert("Synchronize", "No new or changed files");
+        return FOPS_OK;
+    }
+
+    /* "Copy 5 files: 3 new, 2 changed?" */
+    str_copy(msg, "Copy ");
+    num_format(msg + str_len(msg), selected);
+    str_copy(msg + str_len(msg), " files: ");
+    num_format(msg + str_len(msg), n_new);
+    str_copy(msg + str_len(msg), " new, ");
+    num_format(msg + str_len(msg), n_newer + n_changed);
+    str_copy(msg + str_len(msg), " changed?");
+
+    if (dlg_confirm("Synchronize", msg) != DLG_YES) {
+        /* Leave the selection so the user can inspect it */
+        return FOPS_CANCEL;
+    }
+
+    g_overwrite_all = 1;
+    g_file_current = 0;
+    verify_reset();
+
+    result = copy_selected(src_panel, dst_panel, selected);
+
     ui_hide_progress();
+    journal_end(result);
+    verify_summary();
 
-    /* Refresh destination panel */
+    panel_clear_selection(src_panel);
     panel_read_dir(dst_panel);
 
     return result;
 }
 
+/*---------------------------------------------------------------------------
+ * fops_resume - Continue a copy interrupted earlier (from IGC.JRN)
+ *
+ * The journal's entries are walked again in the same order; the first
+ * files_done files are skipped and the partial one is appended to.
+ *---------------------------------------------------------------------------*/
+int fops_resume(void)
+{
+    JournalHeader hdr;
+    char name[JRN_NAME_LEN];
+    char src_path[80];
+    char dst_path[80];
+    char msg[60];
+    int16_t attr;
+    uint16_t i;
+    int result = FOPS_OK;
+
+    if (!jrn_open(&hdr)) {
+        dlg_alert("Resume", "No interrupted copy to resume");
+        return FOPS_CANCEL;
+    }
+
+    /* "Resume copy to A:\DATA\ (12 done)?" */
+    str_copy(msg, "Resume copy to ");
+    str_copy_n(msg + str_len(msg), hdr.dst_dir, 24);
+    str_copy(msg + str_len(msg), " (");
+    num_format(msg + str_len(msg), hdr.files_done);
+    str_copy(msg + str_len(msg), " done)?");
+
+    if (dlg_confirm("Resume Copy", msg) != DLG_YES) {
+        jrn_end(FALSE);
+        return FOPS_CANCEL;
+    }
+
+    g_overwrite_all = 0;
+    g_file_current = 0;
+    g_file_count = hdr.item_count;
+    g_resume_skip = hdr.files_done;
+    g_resume_offset = hdr.offset;
+    verify_reset();
+
+    for (i = 0; i < hdr.item_count && result != FOPS_CANCEL; i++) {
+        if (!jrn_get_item(i, name)) {
+            result = FOPS_ERROR;
+            break;
+        }
+
+        str_copy(src_path, hdr.src_dir);
+        path_append(src_path, name);
+        str_copy(dst_path, hdr.dst_dir);
+        path_append(dst_path, name);
+
+        g_file_current++;
+        ui_show_progress("Resuming", name, g_file_current, g_file_count);
+
+        /* An entry that has gone away since is passed over */
+        attr = dos_get_attr(src_path);
+        if (attr < 0) {
+            continue;
+        }
+
+        if (attr & DOS_ATTR_DIRECTORY) {
+            result = fops_copy_dir(src_path, dst_path);
+        } else {
+            result = fops_copy_file(src_path, dst_path);
+        }
+
+        if (result == FOPS_SKIP) {
+            result = FOPS_OK;
+        }
+    }
+
+    g_resume_skip = 0;
+    g_resume_offset = 0;
+
+    ui_hide_progress();
+    journal_end(result);
+    verify_summary();
+
+    panel_read_dir(panel_get_active());
+    panel_read_dir(panel_get_other());
+
+    return result;
+}
+
 /*---------------------------------------------------------------------------
  * fops_move - Move selected files to other panel
  *---------------------------------------------------------------------------*/
@@ -475,6 +1142,7 @@ int fops_move(void)
     /* Reset state */
     g_overwrite_all = 0;
     g_file_current = 0;
+    verify_reset();
 
     /* Count selected files */
     selected = count_selected_files(src_panel);
@@ -494,6 +1162,10 @@ int fops_move(void)
             return FOPS_CANCEL;
         }
 
+        if (jobs_get_background()) {
+            return queue_items(JOB_MOVE, src_panel, dst_panel, f);
+        }
+
         build_src_path(src_panel, f, src_path);
         build_dst_path(dst_panel, f->name, dst_path);
 
@@ -545,6 +1217,10 @@ int fops_move(void)
             return FOPS_CANCEL;
         }
 
+        if (jobs_get_background()) {
+            return queue_items(JOB_MOVE, src_panel, dst_panel, (FileEntry __far *)0);
+        }
+
         g_file_count = selected;
 
         for (i = 0; i < src_panel->files.count && result != FOPS_CANCEL; i++) {
@@ -583,6 +1259,7 @@ int fops_move(void)
     }
 
     ui_hide_progress();
+    verify_summary();
 
     /* Refresh both panels */
     panel_read_dir(src_panel);
@@ -624,6 +1301,10 @@ int fops_delete(void)
             return FOPS_CANCEL;
         }
 
+        if (jobs_get_background()) {
+            return queue_items(JOB_DELETE, panel, (Panel *)0, f);
+        }
+
         build_src_path(panel, f, path);
 
         g_file_count = 1;
@@ -645,6 +1326,10 @@ int fops_delete(void)
             return FOPS_CANCEL;
         }
 
+        if (jobs_get_background()) {
+            return queue_items(JOB_DELETE, panel, (Panel *)0, (FileEntry __far *)0);
+        }
+
         g_file_count = selected;
 
         for (i = 0; i < panel->files.count && result != FOPS_CANCEL; i++) {
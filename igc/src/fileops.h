@@ -42,6 +42,14 @@ int fops_copy(void);
 /* Returns FOPS_OK, FOPS_CANCEL, or FOPS_ERROR */
 int fops_move(void);
 
+/* Copy only files that are new or changed relative to other panel */
+/* Returns FOPS_OK, FOPS_CANCEL, or FOPS_ERROR */
+int fops_sync(void);
+
+/* Resume a copy interrupted earlier (journal in IGC.JRN) */
+/* Returns FOPS_OK, FOPS_CANCEL, or FOPS_ERROR */
+int fops_resume(void);
+
 /* F7: Delete selected files */
 /* Returns FOPS_OK, FOPS_CANCEL, or FOPS_ERROR */
 int fops_delete(void);
@@ -54,6 +62,20 @@ int fops_mkdir(void);
 /* Returns FOPS_OK, FOPS_CANCEL, or FOPS_ERROR */
 int fops_rename(void);
 
+/*---------------------------------------------------------------------------
+ * Verify After Copy
+ *---------------------------------------------------------------------------*/
+
+/* Enable/disable CRC-32 verify of every copied file */
+void fops_set_verify(bool_t on);
+
+/* Get verify mode */
+bool_t fops_get_verify(void);
+
+/* Re-read a copied file and compare it with the source's CRC-32 (used
+ * by background jobs). Returns FALSE on a mismatch or read error */
+bool_t fops_verify_file(const char *dst, uint32_t crc);
+
 /*---------------------------------------------------------------------------
  * Internal Helpers (exposed for progress display)
  *---------------------------------------------------------------------------*/
@@ -70,4 +92,10 @@ int fops_delete_file(const char *path);
 /* Delete a directory recursively */
 int fops_delete_dir(const char *path);
 
+/* Delete all plain (non-RO/H/S) files in a directory with one DOS call */
+void fops_delete_plain(const char *path);
+
+/* Shared copy buffer and its size (background jobs reuse it) */
+uint8_t __far *fops_get_buffer(uint16_t *size);
+
 #endif /* FILEOPS_H */
@@ -194,6 +194,7 @@ typedef uint8_t bool_t;
 #define FILES_PER_PANEL_LOW     256
 #define FILES_PER_PANEL_MEDIUM  512
 #define FILES_PER_PANEL_HIGH    1024
+#define FILES_PER_PANEL_MAX     2048    /* Grown on demand; 48KB of entries */
 
 /* Editor buffer (bytes) */
 #define EDITOR_BUF_TINY         4096L       /* 4KB */
@@ -206,6 +207,13 @@ typedef uint8_t bool_t;
 #define COPY_BUF_LOW            512
 #define COPY_BUF_MEDIUM         2048
 #define COPY_BUF_HIGH           8192
+#define COPY_BUF_LOAN_MAX       32256   /* Borrowed: one int16 DOS read */
+
+/* Small-allocation pool (bytes per DOS block, see mem.c) */
+#define MEM_POOL_TINY           8192
+#define MEM_POOL_LOW            8192
+#define MEM_POOL_MEDIUM         16384
+#define MEM_POOL_HIGH           32768
 
 /* Editor max lines */
 #define EDITOR_LINES_TINY       128
@@ -0,0 +1,101 @@
+/*
+ * int21.h - IGC Inline DOS Calls
+ * INT 21h sequences expanded in place by Watcom (#pragma aux) for the
+ * calls made once per directory entry, copy block or keyboard poll.
+ *
+ * int86() copies two REGS structures and runs the library's INT thunk
+ * around every call; these put the arguments straight into the
+ * registers DOS wants and hand back AX.  Callers go through dosapi.h -
+ * only dosapi.c, keyboard.c, panel.c and bench.c include this file.
+ */
+
+#ifndef INT21_H
+#define INT21_H
+
+#include "igc.h"
+
+/* AH bit set by LAHF when ZF was set (06h: no character ready) */
+#define INT21_ZF        0x4000
+
+/*---------------------------------------------------------------------------
+ * Directory search
+ *---------------------------------------------------------------------------*/
+
+/* AH=4Fh find next entry into the current DTA; 0, or -1 at the end */
+int16_t int21_find_next(void);
+#pragma aux int21_find_next = \
+    "mov ah, 4Fh"   \
+    "int 21h"       \
+    "sbb ax, ax"    \
+    value [ax]      \
+    modify [ax];
+
+/*---------------------------------------------------------------------------
+ * Handle I/O
+ * The buffer segment arrives in ES and is swapped into DS only around the
+ * INT, so DGROUP is never lost.  On carry DX becomes FFFFh and the OR
+ * turns the result into -1; otherwise AX is the byte count.
+ *---------------------------------------------------------------------------*/
+
+/* AH=3Fh read from a handle; bytes read or -1 */
+int16_t int21_read(int16_t handle, void __far *buf, uint16_t count);
+#pragma aux int21_read = \
+    "push ds"       \
+    "push es"       \
+    "pop ds"        \
+    "mov ah, 3Fh"   \
+    "int 21h"       \
+    "pop ds"        \
+    "sbb dx, dx"    \
+    "or ax, dx"     \
+    parm [bx] [es dx] [cx] \
+    value [ax]      \
+    modify [ax dx];
+
+/* AH=40h write to a handle; bytes written or -1 */
+int16_t int21_write(int16_t handle, const void __far *buf, uint16_t count);
+#pragma aux int21_write = \
+    "push ds"       \
+    "push es"       \
+    "pop ds"        \
+    "mov ah, 40h"   \
+    "int 21h"       \
+    "pop ds"        \
+    "sbb dx, dx"    \
+    "or ax, dx"     \
+    parm [bx] [es dx] [cx] \
+    value [ax]      \
+    modify [ax dx];
+
+/*---------------------------------------------------------------------------
+ * Console
+ *---------------------------------------------------------------------------*/
+
+/* AH=0Bh standard input status; FFh if a character is waiting */
+uint8_t int21_con_status(void);
+#pragma aux int21_con_status = \
+    "mov ah, 0Bh"   \
+    "int 21h"       \
+    value [al]      \
+    modify [ax];
+
+/* AH=06h direct console input without waiting.  AL is the character;
+ * INT21_ZF is set in the result when none was ready. */
+uint16_t int21_con_input(void);
+#pragma aux int21_con_input = \
+    "mov ah, 06h"   \
+    "mov dl, 0FFh"  \
+    "int 21h"       \
+    "lahf"          \
+    value [ax]      \
+    modify [ax dx];
+
+/* AH=07h direct console input, waiting for a character */
+uint8_t int21_con_wait(void);
+#pragma aux int21_con_wait = \
+    "mov ah, 07h"   \
+    "int 21h"       \
+    value [al]      \
+    modify [ax];
+
+#endif /* INT21_H */
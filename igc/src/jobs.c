@@ -0,0 +1,701 @@
+/*
+ * jobs.c - IGC Background File Operation Queue Implementation
+ *
+ * Each call to jobs_run_slice() does one bounded unit of work for the
+ * oldest runnable job: copy one buffer chunk, or handle one directory
+ * entry.  The main loop calls it whenever no key is waiting, so a long
+ * floppy transfer proceeds while the user keeps browsing.
+ */
+
+#include "jobs.h"
+#include "fileops.h"
+#include "dialog.h"
+#include "screen.h"
+#include "keyboard.h"
+#include "mem.h"
+#include "ui.h"
+#include "util.h"
+
+/*---------------------------------------------------------------------------
+ * Static variables
+ *---------------------------------------------------------------------------*/
+static Job __far *g_jobs = (Job __far *)0;  /* JOB_MAX slots, oldest first */
+static bool_t g_background = FALSE;         /* F5/F6 queue instead of run */
+static bool_t g_finished = FALSE;           /* A job ended since last poll */
+static uint16_t g_version = 0;              /* Bumped on visible changes */
+
+/* Last progress shown on the status line (avoid redundant redraws) */
+static Job __far *g_status_job = (Job __far *)0;
+static uint16_t g_status_files = 0;
+static uint8_t g_status_pct = 0xFF;
+
+static const char *job_type_names[] = { "Copy", "Move", "Del" };
+static const char *job_state_names[] = {
+    "", "Queued", "Running", "Paused", "Done", "Failed", "Cancel"
+};
+
+#define SPECIAL_ATTRS (DOS_ATTR_READONLY | DOS_ATTR_HIDDEN | DOS_ATTR_SYSTEM)
+
+/*---------------------------------------------------------------------------
+ * job_is_active - Job still has work to do (or is paused)
+ *---------------------------------------------------------------------------*/
+static bool_t job_is_active(Job __far *j)
+{
+    return (j->state == JOB_PENDING || j->state == JOB_RUNNING ||
+            j->state == JOB_PAUSED) ? TRUE : FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * job_close_files - Close any open handles of a job
+ *---------------------------------------------------------------------------*/
+static void job_close_files(Job __far *j)
+{
+    if (j->src_h >= 0) {
+        dos_close(j->src_h);
+        j->src_h = -1;
+    }
+    if (j->dst_h >= 0) {
+        dos_close(j->dst_h);
+        j->dst_h = -1;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * job_finish - End a job, removing a partial copy unless it succeeded
+ *---------------------------------------------------------------------------*/
+static void job_finish(Job __far *j, uint8_t state)
+{
+    job_close_files(j);
+
+    if (state != JOB_DONE && j->in_file) {
+        dos_delete(j->dst);
+    }
+
+    j->in_file = FALSE;
+    j->state = state;
+    g_finished = TRUE;
+    g_version++;
+}
+
+/*---------------------------------------------------------------------------
+ * remove_file - Delete a file, clearing protective attributes first
+ *---------------------------------------------------------------------------*/
+static int remove_file(const char *path)
+{
+    int16_t attr = dos_get_attr(path);
+
+    if (attr > 0 && (attr & SPECIAL_ATTRS)) {
+        dos_set_attr(path, 0);
+    }
+    return dos_delete(path);
+}
+
+/*---------------------------------------------------------------------------
+ * job_file_done - Current file completed: step back out to its directory
+ *---------------------------------------------------------------------------*/
+static void job_file_done(Job __far *j)
+{
+    j->files_done++;
+    j->file_pos = 0;
+
+    if (j->depth == 0) {
+        job_finish(j, JOB_DONE);
+        return;
+    }
+
+    path_get_parent(j->src);
+    if (j->type != JOB_DELETE) {
+        path_get_parent(j->dst);
+    }
+    g_version++;
+}
+
+/*---------------------------------------------------------------------------
+ * job_open_file - Open source/destination for the file in src/dst
+ *
+ * A fresh copy creates the destination; one that is already there is
+ * replaced only if the user allowed it when the job was queued, and is
+ * otherwise skipped.  A job resumed after a pause has file_pos > 0 and
+ * reopens both files at that offset.
+ *---------------------------------------------------------------------------*/
+static void job_open_file(Job __far *j)
+{
+    if (!j->in_file && dos_exists(j->dst)) {
+        if (!j->overwrite) {
+            job_file_done(j);
+            return;
+        }
+        remove_file(j->dst);
+    }
+
+    j->src_h = dos_open(j->src, DOS_OPEN_READ);
+    if (j->src_h < 0) {
+        job_finish(j, JOB_FAILED);
+        return;
+    }
+
+    if (j->file_pos == 0) {
+        j->file_size = dos_file_size(j->src_h);
+        j->crc = CRC32_INIT;
+        j->dst_h = dos_create(j->dst, 0);
+    } else {
+        j->dst_h = dos_open(j->dst, DOS_OPEN_WRITE);
+        if (j->dst_h >= 0 &&
+            (dos_seek(j->src_h, (int32_t)j->file_pos, DOS_SEEK_SET) < 0 ||
+             dos_seek(j->dst_h, (int32_t)j->file_pos, DOS_SEEK_SET) < 0)) {
+            dos_close(j->dst_h);
+            j->dst_h = -1;
+        }
+    }
+
+    if (j->dst_h < 0) {
+        job_finish(j, JOB_FAILED);
+        return;
+    }
+
+    j->in_file = TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * job_copy_chunk - Copy one buffer of the current file
+ *
+ * With verify on, the source is CRC'd chunk by chunk as it goes through
+ * the buffer and the finished file is checked like a foreground copy.
+ *---------------------------------------------------------------------------*/
+static void job_copy_chunk(Job __far *j)
+{
+    uint8_t __far *buf;
+    uint16_t buf_size;
+    int16_t n;
+
+    /* Reopen after a pause */
+    if (j->src_h < 0) {
+        job_open_file(j);
+        return;
+    }
+
+    buf = fops_get_buffer(&buf_size);
+
+    n = dos_read(j->src_h, buf, buf_size);
+    if (n < 0) {
+        job_finish(j, JOB_FAILED);
+        return;
+    }
+
+    if (n > 0) {
+        if (j->verify) {
+            j->crc = crc32_update(j->crc, buf, (uint16_t)n);
+        }
+        if (dos_write(j->dst_h, buf, (uint16_t)n) != n) {
+            job_finish(j, JOB_FAILED);
+            return;
+        }
+        j->file_pos += (uint16_t)n;
+
+        /* A full buffer means there may be more */
+        if ((uint16_t)n == buf_size) {
+            return;
+        }
+    }
+
+    /* End of file; a copy that fails verify is kept but stops the job */
+    job_close_files(j);
+    j->in_file = FALSE;
+
+    if (j->verify && !fops_verify_file(j->dst, j->crc)) {
+        job_finish(j, JOB_FAILED);
+        return;
+    }
+
+    if (j->type == JOB_MOVE && remove_file(j->src) != 0) {
+        job_finish(j, JOB_FAILED);
+        return;
+    }
+
+    job_file_done(j);
+}
+
+/*---------------------------------------------------------------------------
+ * job_push - Descend into the directory named by src/dst
+ *---------------------------------------------------------------------------*/
+static void job_push(Job __far *j)
+{
+    char pattern[80];
+
+    if (j->depth >= JOB_DEPTH) {
+        job_finish(j, JOB_FAILED);
+        return;
+    }
+
+    if (j->type == JOB_DELETE) {
+        /* All plain files go in one FCB call; the walk sees the rest */
+        fops_delete_plain(j->src);
+    } else if (dos_mkdir(j->dst) != 0 && !dos_exists(j->dst)) {
+        job_finish(j, JOB_FAILED);
+        return;
+    }
+
+    str_copy(pattern, j->src);
+    path_append(pattern, "*.*");
+
+    dir_open(&j->dir[j->depth], pattern, 0x37);
+    j->depth++;
+}
+
+/*---------------------------------------------------------------------------
+ * job_pop - Leave the innermost directory (removing it for move/delete)
+ *---------------------------------------------------------------------------*/
+static void job_pop(Job __far *j)
+{
+    j->depth--;
+    dir_close(&j->dir[j->depth]);
+
+    if (j->type != JOB_COPY && dos_rmdir(j->src) != 0) {
+        job_finish(j, JOB_FAILED);
+        return;
+    }
+
+    if (j->depth == 0) {
+        job_finish(j, JOB_DONE);
+        return;
+    }
+
+    path_get_parent(j->src);
+    if (j->type != JOB_DELETE) {
+        path_get_parent(j->dst);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * job_walk - Handle the next entry of the innermost directory
+ *---------------------------------------------------------------------------*/
+static void job_walk(Job __far *j)
+{
+    DTA __far *dta = dir_next(&j->dir[j->depth - 1]);
+
+    /* Each level owns its DTA, so other DOS searches between slices do
+     * not disturb it */
+    if (dta == (DTA __far *)0) {
+        job_pop(j);
+        return;
+    }
+
+    path_append(j->src, dta->name);
+    if (j->type != JOB_DELETE) {
+        path_append(j->dst, dta->name);
+    }
+
+    if (dta->attr & DOS_ATTR_DIRECTORY) {
+        job_push(j);
+    } else if (j->type == JOB_DELETE) {
+        if (dta->attr & SPECIAL_ATTRS) {
+            dos_set_attr(j->src, 0);
+        }
+        if (dos_delete(j->src) != 0) {
+            job_finish(j, JOB_FAILED);
+            return;
+        }
+        job_file_done(j);
+    } else {
+        j->file_pos = 0;
+        job_open_file(j);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * job_start - First slice of a job: handle the top-level item
+ *---------------------------------------------------------------------------*/
+static void job_start(Job __far *j)
+{
+    j->started = TRUE;
+    j->state = JOB_RUNNING;
+    g_version++;
+
+    /* A move on the same drive is just a rename */
+    if (j->type == JOB_MOVE && char_upper(j->src[0]) == char_upper(j->dst[0]) &&
+        dos_rename(j->src, j->dst) == 0) {
+        j->files_done++;
+        job_finish(j, JOB_DONE);
+        return;
+    }
+
+    if (j->is_dir) {
+        job_push(j);
+        return;
+    }
+
+    if (j->type == JOB_DELETE) {
+        if (remove_file(j->src) != 0) {
+            job_finish(j, JOB_FAILED);
+        } else {
+            job_file_done(j);
+        }
+        return;
+    }
+
+    j->file_pos = 0;
+    job_open_file(j);
+}
+
+/*---------------------------------------------------------------------------
+ * job_percent - Progress through the current file (0-100)
+ *---------------------------------------------------------------------------*/
+static uint8_t job_percent(Job __far *j)
+{
+    if (!j->in_file || j->file_size == 0) {
+        return 0;
+    }
+    return (uint8_t)((j->file_pos >> 8) * 100L / ((j->file_size >> 8) + 1));
+}
+
+/*---------------------------------------------------------------------------
+ * job_show_status - Show running job on the status line when it changes
+ *---------------------------------------------------------------------------*/
+static void job_show_status(Job __far *j)
+{
+    uint8_t pct = job_percent(j);
+
+    if (j == g_status_job && j->files_done == g_status_files && pct == g_status_pct) {
+        return;
+    }
+
+    if (pct != g_status_pct) {
+        g_version++;
+    }
+
+    g_status_job = j;
+    g_status_files = j->files_done;
+    g_status_pct = pct;
+
+    ui_show_progress(job_type_names[j->type], path_basename(j->src), pct, 100);
+}
+
+/*---------------------------------------------------------------------------
+ * next_runnable - Oldest job that is pending or running
+ *---------------------------------------------------------------------------*/
+static Job __far *next_runnable(void)
+{
+    uint8_t i;
+
+    if (g_jobs == (Job __far *)0) {
+        return (Job __far *)0;
+    }
+
+    for (i = 0; i < JOB_MAX; i++) {
+        if (g_jobs[i].state == JOB_PENDING || g_jobs[i].state == JOB_RUNNING) {
+            return &g_jobs[i];
+        }
+    }
+    return (Job __far *)0;
+}
+
+/*---------------------------------------------------------------------------
+ * jobs_run_slice - Do one unit of work for the oldest runnable job
+ *---------------------------------------------------------------------------*/
+bool_t jobs_run_slice(void)
+{
+    Job __far *j = next_runnable();
+
+    if (j == (Job __far *)0) {
+        /* Queue went idle - clear our progress line once */
+        if (g_status_job != (Job __far *)0) {
+            ui_clear_status();
+            g_status_job = (Job __far *)0;
+            g_status_pct = 0xFF;
+        }
+        return FALSE;
+    }
+
+    if (!j->started) {
+        job_start(j);
+    } else if (j->in_file) {
+        job_copy_chunk(j);
+    } else {
+        job_walk(j);
+    }
+
+    if (job_is_active(j)) {
+        job_show_status(j);
+    }
+
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * jobs_add - Queue a job
+ *---------------------------------------------------------------------------*/
+bool_t jobs_add(uint8_t type, const char *src, const char *dst, bool_t is_dir,
+                bool_t overwrite)
+{
+    Job __far *j;
+    uint8_t i, n;
+
+    if (g_jobs == (Job __far *)0) {
+        g_jobs = (Job __far *)mem_alloc((uint32_t)JOB_MAX * sizeof(Job),
+                                        MEM_TAG_JOBS);
+        if (g_jobs == (Job __far *)0) {
+            return FALSE;
+        }
+        mem_set_far(g_jobs, 0, JOB_MAX * sizeof(Job));
+    }
+
+    /* Drop finished entries so slot order stays oldest-first */
+    n = 0;
+    for (i = 0; i < JOB_MAX; i++) {
+        if (job_is_active(&g_jobs[i])) {
+            if (n != i) {
+                mem_copy_far(&g_jobs[n], &g_jobs[i], sizeof(Job));
+            }
+            n++;
+        }
+    }
+    for (i = n; i < JOB_MAX; i++) {
+        g_jobs[i].state = JOB_EMPTY;
+    }
+
+    if (n >= JOB_MAX) {
+        return FALSE;
+    }
+
+    j = &g_jobs[n];
+    mem_set_far(j, 0, sizeof(Job));
+    j->type = type;
+    j->state = JOB_PENDING;
+    j->is_dir = is_dir;
+    j->overwrite = overwrite;
+    j->verify = fops_get_verify();
+    j->src_h = -1;
+    j->dst_h = -1;
+    str_copy_n(j->src, src, sizeof(j->src));
+    if (type != JOB_DELETE) {
+        str_copy_n(j->dst, dst, sizeof(j->dst));
+    }
+    str_copy_n(j->name, path_basename(src), sizeof(j->name));
+
+    g_status_job = (Job __far *)0;
+    g_version++;
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * jobs_shutdown - Cancel all jobs and release the queue
+ *---------------------------------------------------------------------------*/
+void jobs_shutdown(void)
+{
+    uint8_t i;
+
+    if (g_jobs == (Job __far *)0) {
+        return;
+    }
+
+    for (i = 0; i < JOB_MAX; i++) {
+        if (job_is_active(&g_jobs[i])) {
+            job_finish(&g_jobs[i], JOB_CANCELLED);
+        }
+    }
+
+    mem_free(g_jobs);
+    g_jobs = (Job __far *)0;
+}
+
+/*---------------------------------------------------------------------------
+ * jobs_finished - TRUE once after any job ended
+ *---------------------------------------------------------------------------*/
+bool_t jobs_finished(void)
+{
+    bool_t r = g_finished;
+    g_finished = FALSE;
+    return r;
+}
+
+/*---------------------------------------------------------------------------
+ * jobs_active_count - Jobs pending, running or paused
+ *---------------------------------------------------------------------------*/
+uint8_t jobs_active_count(void)
+{
+    uint8_t i;
+    uint8_t n = 0;
+
+    if (g_jobs == (Job __far *)0) {
+        return 0;
+    }
+
+    for (i = 0; i < JOB_MAX; i++) {
+        if (job_is_active(&g_jobs[i])) {
+            n++;
+        }
+    }
+    return n;
+}
+
+/*---------------------------------------------------------------------------
+ * jobs_get - Get job by slot
+ *---------------------------------------------------------------------------*/
+Job __far *jobs_get(uint8_t slot)
+{
+    if (g_jobs == (Job __far *)0 || slot >= JOB_MAX ||
+        g_jobs[slot].state == JOB_EMPTY) {
+        return (Job __far *)0;
+    }
+    return &g_jobs[slot];
+}
+
+/*---------------------------------------------------------------------------
+ * jobs_toggle_pause - Pause or resume a job
+ *
+ * A paused job closes its files so held jobs do not use up DOS handles;
+ * the copy reopens and seeks back to file_pos when resumed.
+ *---------------------------------------------------------------------------*/
+void jobs_toggle_pause(uint8_t slot)
+{
+    Job __far *j = jobs_get(slot);
+
+    if (j == (Job __far *)0) {
+        return;
+    }
+
+    if (j->state == JOB_PAUSED) {
+        j->state = j->started ? JOB_RUNNING : JOB_PENDING;
+    } else if (j->state == JOB_PENDING || j->state == JOB_RUNNING) {
+        job_close_files(j);
+        j->state = JOB_PAUSED;
+    }
+    g_version++;
+}
+
+/*---------------------------------------------------------------------------
+ * jobs_cancel - Cancel a job
+ *---------------------------------------------------------------------------*/
+void jobs_cancel(uint8_t slot)
+{
+    Job __far *j = jobs_get(slot);
+
+    if (j != (Job __far *)0 && job_is_active(j)) {
+        job_finish(j, JOB_CANCELLED);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * jobs_version - Change counter for redraws
+ *---------------------------------------------------------------------------*/
+uint16_t jobs_version(void)
+{
+    return g_version;
+}
+
+/*---------------------------------------------------------------------------
+ * Background mode
+ *---------------------------------------------------------------------------*/
+void jobs_set_background(bool_t on)
+{
+    g_background = on ? TRUE : FALSE;
+}
+
+bool_t jobs_get_background(void)
+{
+    return g_background;
+}
+
+/*---------------------------------------------------------------------------
+ * view_draw_row - Draw one queue row
+ *---------------------------------------------------------------------------*/
+static void view_draw_row(DialogWindow *win, uint8_t slot, bool_t selected)
+{
+    Job __far *j = jobs_get(slot);
+    uint8_t x = win->x + 2;
+    uint8_t y = win->y + 1 + slot;
+    uint8_t attr = selected ? ATTR_DIM_REV : ATTR_DIM;
+    char buf[16];
+
+    scr_fill_rect(x, y, win->w - 4, 1, ' ', attr);
+
+    if (j == (Job __far *)0) {
+        return;
+    }
+
+    scr_puts_xy(x, y, job_type_names[j->type], attr);
+    scr_puts_n_xy(x + 5, y, j->name, 12, attr);
+    scr_puts_xy(x + 18, y, job_state_names[j->state], attr);
+
+    num_format(buf, j->files_done);
+    str_copy(buf + str_len(buf), " files");
+    scr_puts_xy(x + 27, y, buf, attr);
+
+    if (j->in_file) {
+        num_format_simple(buf, job_percent(j));
+        str_copy(buf + str_len(buf), "%");
+        scr_puts_xy(x + 40, y, buf, attr);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * jobs_view - Queue dialog; jobs keep running while it is open
+ *---------------------------------------------------------------------------*/
+void jobs_view(void)
+{
+    DialogWindow win;
+    KeyEvent key;
+    uint8_t sel = 0;
+    uint8_t i;
+    uint16_t drawn;
+    bool_t redraw = TRUE;
+
+    if (!dlg_open(&win, 10, 5, 60, JOB_MAX + 5, "Job Queue")) {
+        return;
+    }
+
+    dlg_print(&win, 1, JOB_MAX + 1, "P=Pause/Resume  C=Cancel  ESC=Close");
+
+    kbd_flush();
+    drawn = g_version;
+
+    while (1) {
+        if (redraw || drawn != g_version) {
+            for (i = 0; i < JOB_MAX; i++) {
+                view_draw_row(&win, i, (i == sel));
+            }
+            drawn = g_version;
+            redraw = FALSE;
+        }
+
+        /* Keep jobs moving until a key arrives */
+        if (!kbd_check() && jobs_run_slice()) {
+            continue;
+        }
+
+        key = kbd_wait();
+        redraw = TRUE;
+
+        if (key.type == KEY_ASCII) {
+            switch (key.code) {
+                case 'p':
+                case 'P':
+                    jobs_toggle_pause(sel);
+                    break;
+                case 'c':
+                case 'C':
+                    jobs_cancel(sel);
+                    break;
+                case KEY_ESC:
+                    dlg_close(&win);
+                    return;
+            }
+        } else if (key.type == KEY_EXTENDED) {
+            switch (key.code) {
+                case KEY_UP:
+                    if (sel > 0) sel--;
+                    break;
+                case KEY_DOWN:
+                    if (sel < JOB_MAX - 1) sel++;
+                    break;
+                case KEY_DELETE:
+                    jobs_cancel(sel);
+                    break;
+                case KEY_F7:
+                case KEY_F10:
+                    dlg_close(&win);
+                    return;
+            }
+        }
+    }
+}
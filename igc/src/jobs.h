@@ -0,0 +1,113 @@
+/*
+ * jobs.h - IGC Background File Operation Queue
+ * Copy/move/delete jobs run in small slices while the UI is idle
+ */
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "igc.h"
+#include "dosapi.h"
+
+/*---------------------------------------------------------------------------
+ * Job Types
+ *---------------------------------------------------------------------------*/
+#define JOB_COPY        0
+#define JOB_MOVE        1
+#define JOB_DELETE      2
+
+/*---------------------------------------------------------------------------
+ * Job States
+ *---------------------------------------------------------------------------*/
+#define JOB_EMPTY       0       /* Free slot */
+#define JOB_PENDING     1       /* Queued, not started */
+#define JOB_RUNNING     2       /* Started, gets time slices */
+#define JOB_PAUSED      3       /* Held by user, no open handles */
+#define JOB_DONE        4       /* Finished successfully */
+#define JOB_FAILED      5       /* Stopped on a DOS error */
+#define JOB_CANCELLED   6       /* Stopped by user */
+
+/*---------------------------------------------------------------------------
+ * Limits
+ *---------------------------------------------------------------------------*/
+#define JOB_MAX         8       /* Queue slots */
+#define JOB_DEPTH       8       /* Directory levels a job can descend */
+
+/*---------------------------------------------------------------------------
+ * Job Structure
+ * src/dst hold the path of the item being worked on; names are appended
+ * when descending and stripped again on the way back up.
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    uint8_t  type;              /* JOB_COPY, JOB_MOVE, JOB_DELETE */
+    uint8_t  state;             /* JOB_PENDING ... JOB_CANCELLED */
+    uint8_t  depth;             /* Open directory levels (0 = top item) */
+    bool_t   is_dir;            /* Top item is a directory */
+    bool_t   started;           /* Top item has been processed */
+    bool_t   in_file;           /* A file copy is in progress */
+    bool_t   overwrite;         /* Replace files already at the destination */
+    bool_t   verify;            /* CRC-check each file once copied */
+    char     name[13];          /* Top item name (for display) */
+    char     src[80];           /* Current source path */
+    char     dst[80];           /* Current destination path */
+    dos_handle_t src_h;         /* Open source handle or -1 */
+    dos_handle_t dst_h;         /* Open destination handle or -1 */
+    uint32_t file_pos;          /* Bytes copied of current file */
+    uint32_t file_size;         /* Size of current file */
+    uint32_t crc;               /* CRC-32 of the bytes copied so far */
+    uint16_t files_done;        /* Files completed */
+    DirEnum  dir[JOB_DEPTH];    /* Enumeration per directory level */
+} Job;
+
+/*---------------------------------------------------------------------------
+ * Queue Control
+ *---------------------------------------------------------------------------*/
+
+/* Cancel all jobs and release the queue */
+void jobs_shutdown(void);
+
+/* Queue a job; dst is ignored for JOB_DELETE.  Without overwrite, files
+ * already at the destination are skipped.  Returns FALSE if full */
+bool_t jobs_add(uint8_t type, const char *src, const char *dst, bool_t is_dir,
+                bool_t overwrite);
+
+/* Run one slice (one buffer chunk or one directory entry) */
+/* Returns TRUE if there was work to do */
+bool_t jobs_run_slice(void);
+
+/* TRUE once after any job has finished (panels should be re-read) */
+bool_t jobs_finished(void);
+
+/* Number of jobs still pending, running or paused */
+uint8_t jobs_active_count(void);
+
+/* Pause or resume a job by slot */
+void jobs_toggle_pause(uint8_t slot);
+
+/* Cancel a job by slot */
+void jobs_cancel(uint8_t slot);
+
+/* Get job by slot (NULL if slot is empty) */
+Job __far *jobs_get(uint8_t slot);
+
+/* Changes whenever job state or progress changes (for redraw) */
+uint16_t jobs_version(void);
+
+/*---------------------------------------------------------------------------
+ * Background Mode
+ *---------------------------------------------------------------------------*/
+
+/* When on, copy/move/delete queue their work instead of running it */
+void jobs_set_background(bool_t on);
+
+/* Get background mode */
+bool_t jobs_get_background(void);
+
+/*---------------------------------------------------------------------------
+ * Queue View
+ *---------------------------------------------------------------------------*/
+
+/* Show queue dialog (P=pause/resume, C/Del=cancel, ESC=close) */
+void jobs_view(void);
+
+#endif /* JOBS_H */
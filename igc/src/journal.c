@@ -0,0 +1,287 @@
+/*
+ * journal.c - IGC Copy Journal Implementation
+ *
+ * The journal lives at a fixed place away from the disks being copied:
+ * the root of the SwapDrive if one is set, else IGC's own directory.  A
+ * place on the source or destination drive is skipped when that drive is
+ * removable, since the disk may be gone by the time the copy resumes.
+ *
+ * No handle is held during the copy.  Each checkpoint opens the file,
+ * rewrites the header in place and closes it again, and the close makes
+ * DOS flush it, so after a power cut the file on disk still describes a
+ * consistent point of the copy.
+ */
+
+#include "journal.h"
+#include "swap.h"
+#include "util.h"
+
+/*---------------------------------------------------------------------------
+ * Static variables
+ *---------------------------------------------------------------------------*/
+static const char *JRN_FILE = "IGC.JRN";
+static const char JRN_MAGIC[4] = { 'I', 'G', 'C', 'J' };
+
+static char g_jrn_path[80];
+static bool_t g_active = FALSE;
+static dos_handle_t g_jrn_h = -1;   /* Open only from jrn_begin to jrn_ready */
+static JournalHeader g_hdr;
+
+/*---------------------------------------------------------------------------
+ * jrn_place - Put the journal's path at a place (see swap_home_path) in
+ * g_jrn_path; FALSE if that place is not known
+ *---------------------------------------------------------------------------*/
+static bool_t jrn_place(uint8_t place)
+{
+    return swap_home_path(place, JRN_FILE, g_jrn_path, sizeof(g_jrn_path));
+}
+
+/*---------------------------------------------------------------------------
+ * on_copy_disk - TRUE if path is on the removable drive of dir
+ *---------------------------------------------------------------------------*/
+static bool_t on_copy_disk(const char *path, const char *dir)
+{
+    uint8_t drive = (uint8_t)(char_upper(path[0]) - 'A');
+    uint8_t type;
+
+    if (char_upper(dir[0]) != char_upper(path[0])) {
+        return FALSE;
+    }
+    type = dos_drive_type(drive);
+    return (type != DRIVE_FIXED && type != DRIVE_REMOTE) ? TRUE : FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * write_header - Rewrite the header through an open handle
+ *---------------------------------------------------------------------------*/
+static bool_t write_header(dos_handle_t h)
+{
+    if (dos_seek(h, 0L, DOS_SEEK_SET) < 0) {
+        return FALSE;
+    }
+    return (dos_write(h, &g_hdr, sizeof(g_hdr)) == (int16_t)sizeof(g_hdr)) ?
+           TRUE : FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * checkpoint - Open the journal, rewrite the header and close it
+ *---------------------------------------------------------------------------*/
+static bool_t checkpoint(void)
+{
+    dos_handle_t h;
+    bool_t ok;
+
+    h = dos_open(g_jrn_path, DOS_OPEN_RW);
+    if (h < 0) {
+        return FALSE;
+    }
+    ok = write_header(h);
+    dos_close(h);
+    return ok;
+}
+
+/*---------------------------------------------------------------------------
+ * jrn_begin - Start a new journal
+ *---------------------------------------------------------------------------*/
+bool_t jrn_begin(const char *src_dir, const char *dst_dir)
+{
+    uint8_t place;
+
+    jrn_end(FALSE);
+
+    for (place = 0; place < SWAP_HOME_PLACES; place++) {
+        if (jrn_place(place) &&
+            !on_copy_disk(g_jrn_path, src_dir) &&
+            !on_copy_disk(g_jrn_path, dst_dir)) {
+            break;
+        }
+    }
+    if (place == SWAP_HOME_PLACES) {
+        return FALSE;
+    }
+
+    g_jrn_h = dos_create(g_jrn_path, 0);
+    if (g_jrn_h < 0) {
+        return FALSE;
+    }
+    g_active = TRUE;
+
+    mem_set_far(&g_hdr, 0, sizeof(g_hdr));
+    mem_copy_far(g_hdr.magic, JRN_MAGIC, sizeof(JRN_MAGIC));
+    str_copy_n(g_hdr.src_dir, src_dir, sizeof(g_hdr.src_dir));
+    str_copy_n(g_hdr.dst_dir, dst_dir, sizeof(g_hdr.dst_dir));
+
+    if (!write_header(g_jrn_h)) {
+        jrn_end(TRUE);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * jrn_add_item - Append a top-level entry name
+ *---------------------------------------------------------------------------*/
+void jrn_add_item(const char *name)
+{
+    char entry[JRN_NAME_LEN];
+
+    if (g_jrn_h < 0) {
+        return;
+    }
+
+    mem_set_far(entry, 0, sizeof(entry));
+    str_copy_n(entry, name, sizeof(entry));
+
+    dos_seek(g_jrn_h, (int32_t)sizeof(g_hdr) +
+             (int32_t)g_hdr.item_count * JRN_NAME_LEN, DOS_SEEK_SET);
+    if (dos_write(g_jrn_h, entry, JRN_NAME_LEN) == JRN_NAME_LEN) {
+        g_hdr.item_count++;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * jrn_ready - Commit the header with the final item count and close the
+ * journal until the first checkpoint
+ *---------------------------------------------------------------------------*/
+void jrn_ready(void)
+{
+    if (g_jrn_h < 0) {
+        return;
+    }
+
+    write_header(g_jrn_h);
+    dos_close(g_jrn_h);
+    g_jrn_h = -1;
+}
+
+/*---------------------------------------------------------------------------
+ * jrn_active - Journal in use?
+ *---------------------------------------------------------------------------*/
+bool_t jrn_active(void)
+{
+    return g_active;
+}
+
+/*---------------------------------------------------------------------------
+ * jrn_file_done - Count a finished file
+ *---------------------------------------------------------------------------*/
+void jrn_file_done(void)
+{
+    if (!g_active) {
+        return;
+    }
+
+    g_hdr.files_done++;
+    g_hdr.offset = 0;
+    checkpoint();
+}
+
+/*---------------------------------------------------------------------------
+ * jrn_mark - Record progress within the current file
+ *---------------------------------------------------------------------------*/
+void jrn_mark(dos_handle_t data_h, uint32_t offset)
+{
+    if (!g_active) {
+        return;
+    }
+
+    if (data_h >= 0) {
+        dos_commit(data_h);
+    }
+
+    g_hdr.offset = offset;
+    checkpoint();
+}
+
+/*---------------------------------------------------------------------------
+ * jrn_end - Stop journaling
+ *---------------------------------------------------------------------------*/
+void jrn_end(bool_t completed)
+{
+    if (g_jrn_h >= 0) {
+        dos_close(g_jrn_h);
+        g_jrn_h = -1;
+    }
+    if (!g_active) {
+        return;
+    }
+    g_active = FALSE;
+
+    if (completed) {
+        dos_delete(g_jrn_path);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * jrn_open - Find an existing journal for resume
+ *
+ * The places are tried in the order jrn_begin uses; the first with a
+ * valid header is taken.
+ *---------------------------------------------------------------------------*/
+bool_t jrn_open(JournalHeader *hdr)
+{
+    dos_handle_t h;
+    int16_t got;
+    uint8_t place;
+    uint8_t i;
+
+    jrn_end(FALSE);
+
+    for (place = 0; place < SWAP_HOME_PLACES; place++) {
+        if (!jrn_place(place)) {
+            continue;
+        }
+        h = dos_open(g_jrn_path, DOS_OPEN_READ);
+        if (h < 0) {
+            continue;
+        }
+        got = dos_read(h, &g_hdr, sizeof(g_hdr));
+        dos_close(h);
+        if (got != (int16_t)sizeof(g_hdr)) {
+            continue;
+        }
+
+        for (i = 0; i < sizeof(JRN_MAGIC); i++) {
+            if (g_hdr.magic[i] != JRN_MAGIC[i]) {
+                break;
+            }
+        }
+        if (i == sizeof(JRN_MAGIC)) {
+            g_active = TRUE;
+            mem_copy_far(hdr, &g_hdr, sizeof(g_hdr));
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * jrn_get_item - Read entry name by index
+ *---------------------------------------------------------------------------*/
+bool_t jrn_get_item(uint16_t index, char *name)
+{
+    dos_handle_t h;
+    bool_t ok = FALSE;
+
+    if (!g_active || index >= g_hdr.item_count) {
+        return FALSE;
+    }
+
+    h = dos_open(g_jrn_path, DOS_OPEN_READ);
+    if (h < 0) {
+        return FALSE;
+    }
+    if (dos_seek(h, (int32_t)sizeof(g_hdr) +
+                 (int32_t)index * JRN_NAME_LEN, DOS_SEEK_SET) >= 0 &&
+        dos_read(h, name, JRN_NAME_LEN) == JRN_NAME_LEN) {
+        ok = TRUE;
+    }
+    dos_close(h);
+
+    if (ok) {
+        name[JRN_NAME_LEN - 1] = '\0';
+    }
+    return ok;
+}
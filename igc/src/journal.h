@@ -0,0 +1,69 @@
+/*
+ * journal.h - IGC Copy Journal
+ * Records copy progress in IGC.JRN so an interrupted copy can resume.
+ * The file goes in the SwapDrive root, else in IGC's own directory.
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "igc.h"
+#include "dosapi.h"
+
+/*---------------------------------------------------------------------------
+ * Journal Layout
+ * IGC.JRN holds the header followed by item_count 13-byte entry names.
+ * files_done counts files in walk order (copied, skipped or failed); the
+ * next file has offset bytes safely on disk.
+ *---------------------------------------------------------------------------*/
+#define JRN_NAME_LEN        13
+#define JRN_CHECKPOINT      32768UL     /* Bytes between mid-file marks */
+
+typedef struct {
+    char     magic[4];          /* "IGCJ" */
+    uint16_t item_count;        /* Top-level entries being copied */
+    uint16_t files_done;        /* Files finished, in walk order */
+    uint32_t offset;            /* Bytes written of the next file */
+    char     src_dir[80];       /* Source directory ("D:\PATH\") */
+    char     dst_dir[80];       /* Destination directory */
+} JournalHeader;
+
+/*---------------------------------------------------------------------------
+ * Recording
+ *---------------------------------------------------------------------------*/
+
+/* Start a new journal (replaces any old one). Returns FALSE on error, or
+ * if the only places left are on a removable source or target drive */
+bool_t jrn_begin(const char *src_dir, const char *dst_dir);
+
+/* Append a top-level entry name */
+void jrn_add_item(const char *name);
+
+/* Write the header once all items are added; the file is closed until
+ * the next checkpoint */
+void jrn_ready(void);
+
+/* TRUE while a copy is being journaled */
+bool_t jrn_active(void);
+
+/* A file finished (copied, skipped or failed) */
+void jrn_file_done(void);
+
+/* Record offset within the current file; data_h (if >= 0) is */
+/* flushed first so the journal never runs ahead of the data */
+void jrn_mark(dos_handle_t data_h, uint32_t offset);
+
+/* Close the journal; delete it if the copy completed */
+void jrn_end(bool_t completed);
+
+/*---------------------------------------------------------------------------
+ * Resume
+ *---------------------------------------------------------------------------*/
+
+/* Open an existing journal for resume. Returns FALSE if none */
+bool_t jrn_open(JournalHeader *hdr);
+
+/* Read entry name by index (name must hold JRN_NAME_LEN bytes) */
+bool_t jrn_get_item(uint16_t index, char *name);
+
+#endif /* JOURNAL_H */
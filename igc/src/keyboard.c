@@ -5,6 +5,7 @@
 
 #include <dos.h>
 #include "keyboard.h"
+#include "int21.h"
 
 /*---------------------------------------------------------------------------
  * kbd_init - Initialize keyboard system
@@ -20,46 +21,30 @@ void kbd_init(void)
  *---------------------------------------------------------------------------*/
 bool_t kbd_check(void)
 {
-    union REGS regs;
-
     /* DOS function 0Bh: Check STDIN status */
-    regs.h.ah = 0x0B;
-    int86(0x21, &regs, &regs);
-
-    return (regs.h.al == 0xFF) ? TRUE : FALSE;
+    return (int21_con_status() == 0xFF) ? TRUE : FALSE;
 }
 
 /*---------------------------------------------------------------------------
  * get_raw_char - Get raw character from DOS (non-blocking)
- * Returns character or -1 if none available
+ * Returns character or -1 if none available.  A 00h from DOS is a real
+ * character (the IBM extended key prefix); only ZF means none.
  *---------------------------------------------------------------------------*/
 static int get_raw_char(void)
 {
-    union REGS regs;
+    uint16_t r;
 
-    /* DOS function 06h: Direct console I/O */
-    regs.h.ah = 0x06;
-    regs.h.dl = 0xFF;   /* Input mode */
-    int86(0x21, &regs, &regs);
+    /* DOS function 06h: Direct console I/O, DL=FFh input */
+    r = int21_con_input();
 
-    /* ZF set means no character available */
-    /* Check if AL is 0 (which could mean no key or null char) */
-    /* We need to check the zero flag via flags register */
-    if (regs.x.cflag == 0 && regs.h.al != 0) {
-        return (int)(unsigned char)regs.h.al;
+    /* Nothing yet: give a late ESC-sequence byte one more chance */
+    if ((r & INT21_ZF) && kbd_check()) {
+        r = int21_con_input();
     }
-
-    /* Try checking if anything was read */
-    if (kbd_check()) {
-        regs.h.ah = 0x06;
-        regs.h.dl = 0xFF;
-        int86(0x21, &regs, &regs);
-        if (regs.h.al != 0) {
-            return (int)(unsigned char)regs.h.al;
-        }
+    if (r & INT21_ZF) {
+        return -1;
     }
-
-    return -1;
+    return (int)(r & 0xFF);
 }
 
 /*---------------------------------------------------------------------------
@@ -67,13 +52,8 @@ static int get_raw_char(void)
  *---------------------------------------------------------------------------*/
 static int get_raw_char_wait(void)
 {
-    union REGS regs;
-
     /* DOS function 07h: Direct char input without echo */
-    regs.h.ah = 0x07;
-    int86(0x21, &regs, &regs);
-
-    return (int)(unsigned char)regs.h.al;
+    return (int)int21_con_wait();
 }
 
 /*---------------------------------------------------------------------------
@@ -17,6 +17,10 @@
 #include "fileops.h"
 #include "editor.h"
 #include "config.h"
+#include "jobs.h"
+#include "diff.h"
+#include "swap.h"
+#include "exec.h"
 
 /*---------------------------------------------------------------------------
  * Forward declarations
@@ -24,6 +28,8 @@
 static void handle_key(KeyEvent *key);
 static void handle_navigation(uint8_t code);
 static void handle_enter(void);
+static void confirm_quit(void);
+static void compare_files(void);
 
 /*---------------------------------------------------------------------------
  * Global state
@@ -32,12 +38,32 @@ static bool_t g_running = TRUE;
 static bool_t g_need_redraw = TRUE;
 
 /*---------------------------------------------------------------------------
- * handle_enter - Handle Enter key (enter directory or action)
+ * confirm_quit - Ask before exiting (and before dropping queued jobs)
+ *---------------------------------------------------------------------------*/
+static void confirm_quit(void)
+{
+    if (dlg_exit_confirm() != DLG_YES) {
+        return;
+    }
+
+    if (jobs_active_count() > 0 &&
+        dlg_confirm("Exit", "Cancel unfinished jobs?") != DLG_YES) {
+        return;
+    }
+
+    g_running = FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * handle_enter - Handle Enter key (enter directory or run program)
+ * The panels are not reread after a program: whatever it changed on disk
+ * shows up on the next rescan.
  *---------------------------------------------------------------------------*/
 static void handle_enter(void)
 {
     Panel *p = panel_get_active();
     FileEntry __far *f = panel_get_cursor_file(p);
+    char name[MAX_FILENAME];
 
     if (f == (FileEntry __far *)0) return;
 
@@ -48,8 +74,45 @@ static void handle_enter(void)
             panel_change_dir(p, f->name);
         }
         g_need_redraw = TRUE;
+    } else if (exec_is_program(f->name)) {
+        str_copy(name, f->name);
+        if (exec_run(p->drive, p->path, name) < 0) {
+            dlg_alert("Run", "Cannot run program");
+        }
+        g_need_redraw = TRUE;
+        ui_draw_frame();
+        ui_draw_headers();
+        ui_draw_fkey_bar();
     }
-    /* TODO: For files, could launch viewer/editor */
+}
+
+/*---------------------------------------------------------------------------
+ * compare_files - Compare the cursor files of the two panels (C)
+ * If one panel's cursor is not on a file, the file of the same name in
+ * that panel's directory is used.
+ *---------------------------------------------------------------------------*/
+static void compare_files(void)
+{
+    Panel *ap = panel_get_active();
+    FileEntry __far *af = panel_get_cursor_file(ap);
+    FileEntry __far *lf = panel_get_cursor_file(&g_left_panel);
+    FileEntry __far *rf = panel_get_cursor_file(&g_right_panel);
+    char lpath[80];
+    char rpath[80];
+
+    if (af == (FileEntry __far *)0 || file_is_dir(af)) return;
+
+    if (lf == (FileEntry __far *)0 || file_is_dir(lf)) lf = af;
+    if (rf == (FileEntry __far *)0 || file_is_dir(rf)) rf = af;
+
+    path_build(lpath, g_left_panel.drive, g_left_panel.path, lf->name);
+    path_build(rpath, g_right_panel.drive, g_right_panel.path, rf->name);
+    diff_files(lpath, rpath);
+
+    g_need_redraw = TRUE;
+    ui_draw_frame();
+    ui_draw_headers();
+    ui_draw_fkey_bar();
 }
 
 /*---------------------------------------------------------------------------
@@ -200,9 +263,7 @@ static void handle_fkey(uint8_t fkey_num)
 
         case 7:     /* F7: Quit */
         case 10:    /* F10: Quit (not shown on bar) */
-            if (dlg_exit_confirm() == DLG_YES) {
-                g_running = FALSE;
-            }
+            confirm_quit();
             ui_draw_fkey_bar();
             break;
     }
@@ -259,12 +320,54 @@ static void handle_key(KeyEvent *key)
                 }
                 break;
 
+            case 's':
+            case 'S':
+                fops_sync();
+                g_need_redraw = TRUE;
+                ui_draw_fkey_bar();
+                break;
+
+            case 'r':
+            case 'R':
+                fops_resume();
+                g_need_redraw = TRUE;
+                ui_draw_fkey_bar();
+                break;
+
+            case 'v':
+            case 'V':
+                fops_set_verify(!fops_get_verify());
+                ui_status(fops_get_verify() ? "Verify after copy: ON" :
+                                              "Verify after copy: OFF");
+                break;
+
+            case 'b':
+            case 'B':
+                jobs_set_background(!jobs_get_background());
+                ui_status(jobs_get_background() ? "Background mode: ON" :
+                                                  "Background mode: OFF");
+                break;
+
+            case 'j':
+            case 'J':
+                jobs_view();
+                ui_draw_fkey_bar();
+                break;
+
+            case 'c':
+            case 'C':
+                compare_files();
+                break;
+
+            case 'm':
+            case 'M':
+                ui_show_memory();
+                break;
+
             case KEY_ESC:
             case 'q':
             case 'Q':
-                if (dlg_exit_confirm() == DLG_YES) {
-                    g_running = FALSE;
-                }
+                confirm_quit();
                 ui_draw_fkey_bar();
                 break;
 
@@ -282,6 +385,13 @@ static void main_loop(void)
     KeyEvent key;
 
     while (g_running) {
+        /* Re-read directories once a background job has changed them */
+        if (jobs_finished()) {
+            panel_refresh(&g_left_panel);
+            panel_refresh(&g_right_panel);
+            g_need_redraw = TRUE;
+        }
+
         /* Redraw if needed */
         if (g_need_redraw) {
             ui_draw_panels();
@@ -289,12 +399,43 @@ static void main_loop(void)
             g_need_redraw = FALSE;
         }
 
+        /* Give idle time to queued jobs, one slice per pass */
+        if (!kbd_check() && jobs_run_slice()) {
+            continue;
+        }
+
         /* Wait for and handle key */
         key = kbd_wait();
         handle_key(&key);
     }
 }
 
+/*---------------------------------------------------------------------------
+ * write_log - Write the memory log where the journal goes
+ *
+ * Never in the current directory, which may be a full or write-protected
+ * floppy; the critical error handler turns a disk error into a failed
+ * write instead of an Abort, Retry, Fail prompt on the way out.
+ *---------------------------------------------------------------------------*/
+static void write_log(void)
+{
+    char path[80];
+    uint8_t place;
+
+    for (place = 0; place < SWAP_HOME_PLACES; place++) {
+        if (swap_home_path(place, MEM_LOG_FILE, path, sizeof(path))) {
+            break;
+        }
+    }
+    if (place == SWAP_HOME_PLACES) {
+        return;
+    }
+
+    dos_install_crit_handler();
+    mem_write_log(path);
+    dos_restore_crit_handler();
+}
+
 /*---------------------------------------------------------------------------
  * Main entry point
  *---------------------------------------------------------------------------*/
@@ -311,6 +452,9 @@ int main(void)
     /* Initialize keyboard */
     kbd_init();
 
+    /* Find the drives once; F1 uses the map, F2 there rebuilds it */
+    dos_drives_scan(FALSE);
+
     /* Initialize panels */
     if (!panels_init()) {
         scr_cursor_on();
@@ -366,12 +510,15 @@ int main(void)
     }
 
     /* Cleanup */
+    jobs_shutdown();
     editor_shutdown();
     fops_shutdown();
     panels_free();
+    swap_shutdown();
     scr_clear();
     scr_cursor_on();
     scr_exit();
+    write_log();
     mem_shutdown();
     dos_exit(0);
 
@@ -6,6 +6,8 @@
 #include <dos.h>
 #include <i86.h>
 #include "mem.h"
+#include "dosapi.h"
+#include "util.h"
 
 /*---------------------------------------------------------------------------
  * Global Memory State
@@ -20,6 +22,73 @@ static const char *tier_names[] = {
     "HIGH (512KB+)"
 };
 
+/* Owner tag names for display */
+static const char *tag_names[MEM_TAG_COUNT] = {
+    "Panels",
+    "Editor",
+    "Copy",
+    "Dialogs",
+    "Viewer",
+    "Search",
+    "Compare",
+    "Jobs",
+    "Swap"
+};
+
+/*---------------------------------------------------------------------------
+ * Sub-Allocator State
+ *
+ * Every block handed out from a pool or the dialog stack starts with a
+ * MemHdr and the caller's pointer is just past it, so its offset is never
+ * 0.  A block straight from DOS gets one extra paragraph in front holding
+ * a MemBig, and the caller's pointer is the next paragraph at offset 0;
+ * that is how mem_free tells the two apart.  A free pool block holds the
+ * free list link in its first four bytes.
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    uint16_t size;              /* Bytes requested */
+    uint16_t link;              /* Stack: offset of the block below */
+    uint8_t  cls;               /* Size class, or MEM_CLASS_LIFO */
+    uint8_t  tag;               /* Owner */
+    uint8_t  magic;             /* MEM_MAGIC while allocated */
+    uint8_t  spare;             /* Keeps blocks word aligned */
+} MemHdr;
+
+typedef struct {
+    uint32_t size;              /* Bytes requested */
+    uint8_t  tag;               /* Owner */
+    uint8_t  magic;             /* MEM_MAGIC while allocated */
+} MemBig;
+
+#define MEM_CLASS_LIFO  0xFF        /* Block lives on the dialog stack */
+#define MEM_MAGIC       0xA5        /* Allocated block */
+#define MEM_FREED       0x5A        /* Freed block */
+#define MEM_LIFO_EMPTY  0xFFFF      /* No block on the stack */
+
+#define HDR(p)  ((MemHdr __far *)((char __far *)(p) - sizeof(MemHdr)))
+#define BIG(p)  ((MemBig __far *)MK_FP(FP_SEG(p) - 1, 0))
+
+static uint16_t g_pool_seg[MEM_POOL_MAX];   /* Pool segments */
+static uint16_t g_pool_used[MEM_POOL_MAX];  /* Bytes carved from each */
+static uint8_t  g_pool_count;
+
+static char __far *g_free[MEM_CLASS_COUNT]; /* Free list per size class */
+
+static uint16_t g_lifo_seg;                 /* Dialog stack segment */
+static uint16_t g_lifo_top;                 /* Offset of first free byte */
+static uint16_t g_lifo_last;                /* Offset of the top block */
+
+static MemStats g_stats;
+
+static void __far *g_loan;                  /* Buffer offered for lending */
+static uint32_t g_loan_size;
+static uint8_t  g_loan_owner;               /* Tag of its owner */
+static uint8_t  g_loan_borrower;            /* Tag of the borrower */
+static bool_t   g_loan_out;                 /* Currently borrowed */
+static uint32_t g_dos_bytes;                /* Bytes held from DOS */
+static uint32_t g_pool_carved;              /* Pool bytes handed out */
+static uint32_t g_pool_data;                /* Bytes requested from pools */
+
 /*---------------------------------------------------------------------------
  * mem_get_available_kb - Query DOS for available conventional memory
  *
@@ -47,6 +116,225 @@ uint32_t mem_get_available_kb(void)
     return bytes / 1024L;
 }
 
+/*---------------------------------------------------------------------------
+ * dos_block_bytes - Size of a DOS block, from its memory control block
+ *---------------------------------------------------------------------------*/
+static uint32_t dos_block_bytes(uint16_t segment)
+{
+    /* The MCB is the paragraph before the block; size is at offset 3 */
+    return (uint32_t)*(uint16_t __far *)MK_FP(segment - 1, 3) * 16L;
+}
+
+/*---------------------------------------------------------------------------
+ * dos_held - Count a DOS block taken (TRUE) or given back (FALSE)
+ *---------------------------------------------------------------------------*/
+static void dos_held(uint16_t segment, bool_t taken)
+{
+    if (taken) {
+        g_dos_bytes += dos_block_bytes(segment);
+    } else {
+        g_dos_bytes -= dos_block_bytes(segment);
+    }
+    g_mem.free_kb = g_mem.total_kb - (g_dos_bytes + 1023L) / 1024L;
+}
+
+/*---------------------------------------------------------------------------
+ * count_bytes - Charge a change in live bytes to an owner
+ *---------------------------------------------------------------------------*/
+static void count_bytes(uint8_t tag, uint32_t old_bytes, uint32_t new_bytes)
+{
+    g_stats.bytes_in_use = g_stats.bytes_in_use - old_bytes + new_bytes;
+    g_stats.tag_bytes[tag] = g_stats.tag_bytes[tag] - old_bytes + new_bytes;
+
+    if (g_stats.bytes_in_use > g_stats.peak_bytes) {
+        g_stats.peak_bytes = g_stats.bytes_in_use;
+    }
+    if (g_stats.tag_bytes[tag] > g_stats.tag_peak[tag]) {
+        g_stats.tag_peak[tag] = g_stats.tag_bytes[tag];
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * count_alloc / count_free - Count a block handed out or returned
+ *---------------------------------------------------------------------------*/
+static void count_alloc(uint8_t tag, uint32_t bytes)
+{
+    g_stats.allocs++;
+    g_stats.live++;
+    count_bytes(tag, 0, bytes);
+}
+
+static void count_free(uint8_t tag, uint32_t bytes)
+{
+    g_stats.live--;
+    count_bytes(tag, bytes, 0);
+}
+
+/*---------------------------------------------------------------------------
+ * dos_alloc - Allocate a DOS memory block (INT 21h AH=48h)
+ *
+ * Returns the block's segment, or 0 on failure.
+ *---------------------------------------------------------------------------*/
+static uint16_t dos_alloc(uint32_t bytes)
+{
+    union REGS regs;
+
+    /* Calculate paragraphs needed (round up) */
+    regs.h.ah = 0x48;
+    regs.x.bx = (uint16_t)((bytes + 15L) / 16L);
+    int86(0x21, &regs, &regs);
+
+    /* Check for error (carry flag set) */
+    if (regs.x.cflag) {
+        return 0;
+    }
+
+    dos_held(regs.x.ax, TRUE);
+    return regs.x.ax;
+}
+
+/*---------------------------------------------------------------------------
+ * dos_release - Give a DOS memory block back (INT 21h AH=49h)
+ *---------------------------------------------------------------------------*/
+static void dos_release(uint16_t segment)
+{
+    union REGS regs;
+    struct SREGS sregs;
+
+    segread(&sregs);
+    sregs.es = segment;
+
+    regs.h.ah = 0x49;
+    int86x(0x21, &regs, &regs, &sregs);
+}
+
+/*---------------------------------------------------------------------------
+ * dos_free - Free a DOS memory block and stop counting it
+ *---------------------------------------------------------------------------*/
+static void dos_free(uint16_t segment)
+{
+    dos_held(segment, FALSE);
+    dos_release(segment);
+}
+
+/*---------------------------------------------------------------------------
+ * size_class - Smallest size class holding a request
+ *---------------------------------------------------------------------------*/
+static uint8_t size_class(uint16_t bytes)
+{
+    uint8_t cls = 0;
+
+    while ((uint16_t)(MEM_CLASS_MIN << cls) < bytes) {
+        cls++;
+    }
+    return cls;
+}
+
+/*---------------------------------------------------------------------------
+ * pool_add - Take one more pool from DOS
+ *---------------------------------------------------------------------------*/
+static bool_t pool_add(void)
+{
+    uint16_t segment;
+
+    if (g_pool_count >= MEM_POOL_MAX) {
+        return FALSE;
+    }
+
+    segment = dos_alloc(g_mem.pool_size);
+    if (segment == 0) {
+        return FALSE;
+    }
+
+    g_pool_seg[g_pool_count] = segment;
+    g_pool_used[g_pool_count] = 0;
+    g_pool_count++;
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * pool_alloc - Serve a small request from a free list or a pool
+ *
+ * Returns NULL if no pool has room and no more pools can be taken.
+ *---------------------------------------------------------------------------*/
+static void __far *pool_alloc(uint16_t bytes, uint8_t tag)
+{
+    uint8_t cls;
+    uint16_t span;
+    uint8_t i;
+    char __far *p;
+    MemHdr __far *hdr;
+
+    cls = size_class(bytes);
+    span = sizeof(MemHdr) + (MEM_CLASS_MIN << cls);
+
+    p = g_free[cls];
+    if (p != (char __far *)0) {
+        /* Reuse a freed block of this class */
+        g_free[cls] = *(char __far * __far *)p;
+        g_stats.pool_free -= span;
+        hdr = HDR(p);
+    } else {
+        /* Carve a new block from the first pool with room */
+        for (i = 0; i < g_pool_count; i++) {
+            if (g_mem.pool_size - g_pool_used[i] >= span) {
+                break;
+            }
+        }
+        if (i == g_pool_count && !pool_add()) {
+            return (void __far *)0;
+        }
+
+        hdr = (MemHdr __far *)MK_FP(g_pool_seg[i], g_pool_used[i]);
+        g_pool_used[i] += span;
+        g_pool_carved += span;
+    }
+
+    hdr->size = bytes;
+    hdr->link = 0;
+    hdr->cls = cls;
+    hdr->tag = tag;
+    hdr->magic = MEM_MAGIC;
+    g_pool_data += bytes;
+
+    return (char __far *)hdr + sizeof(MemHdr);
+}
+
+/*---------------------------------------------------------------------------
+ * pool_free - Put a pool block on its class free list
+ *---------------------------------------------------------------------------*/
+static void pool_free(MemHdr __far *hdr)
+{
+    char __far *p = (char __far *)hdr + sizeof(MemHdr);
+
+    *(char __far * __far *)p = g_free[hdr->cls];
+    g_free[hdr->cls] = p;
+    g_stats.pool_free += sizeof(MemHdr) + (MEM_CLASS_MIN << hdr->cls);
+    g_pool_data -= hdr->size;
+}
+
+/*---------------------------------------------------------------------------
+ * lifo_free - Release a dialog stack block
+ *
+ * A block freed out of order is only marked; the stack shrinks past it
+ * once everything above it has been freed too.
+ *---------------------------------------------------------------------------*/
+static void lifo_free(MemHdr __far *hdr)
+{
+    MemHdr __far *top;
+
+    hdr->magic = MEM_FREED;
+
+    while (g_lifo_last != MEM_LIFO_EMPTY) {
+        top = (MemHdr __far *)MK_FP(g_lifo_seg, g_lifo_last);
+        if (top->magic != MEM_FREED) {
+            break;
+        }
+        g_lifo_top = g_lifo_last;
+        g_lifo_last = top->link;
+    }
+}
+
 /*---------------------------------------------------------------------------
  * mem_init - Initialize memory system
  *---------------------------------------------------------------------------*/
@@ -62,31 +350,58 @@ void mem_init(void)
         g_mem.files_per_panel = FILES_PER_PANEL_HIGH;
         g_mem.editor_buf_size = EDITOR_BUF_HIGH;
         g_mem.copy_buf_size = COPY_BUF_HIGH;
+        g_mem.pool_size = MEM_POOL_HIGH;
     } else if (g_mem.total_kb >= MEM_MEDIUM_THRESHOLD) {
         g_mem.tier = MEM_MEDIUM;
         g_mem.files_per_panel = FILES_PER_PANEL_MEDIUM;
         g_mem.editor_buf_size = EDITOR_BUF_MEDIUM;
         g_mem.copy_buf_size = COPY_BUF_MEDIUM;
+        g_mem.pool_size = MEM_POOL_MEDIUM;
     } else if (g_mem.total_kb >= MEM_LOW_THRESHOLD) {
         g_mem.tier = MEM_LOW;
         g_mem.files_per_panel = FILES_PER_PANEL_LOW;
         g_mem.editor_buf_size = EDITOR_BUF_LOW;
         g_mem.copy_buf_size = COPY_BUF_LOW;
+        g_mem.pool_size = MEM_POOL_LOW;
     } else {
         g_mem.tier = MEM_TINY;
         g_mem.files_per_panel = FILES_PER_PANEL_TINY;
         g_mem.editor_buf_size = EDITOR_BUF_TINY;
         g_mem.copy_buf_size = COPY_BUF_TINY;
+        g_mem.pool_size = MEM_POOL_TINY;
     }
+
+    /* Take the dialog stack and the first pool before anything else, so
+     * they sit low in memory and never split the large blocks; more pools
+     * are taken as needed */
+    g_lifo_seg = dos_alloc(MEM_LIFO_SIZE);
+    g_lifo_top = 0;
+    g_lifo_last = MEM_LIFO_EMPTY;
+    pool_add();
 }
 
 /*---------------------------------------------------------------------------
  * mem_shutdown - Cleanup memory system
+ *
+ * Releases the pools and dialog stack; blocks taken straight from DOS
+ * are freed by their owners.
  *---------------------------------------------------------------------------*/
 void mem_shutdown(void)
 {
-    /* Nothing to do - individual allocations should be freed by callers */
-    /* This is a placeholder for any global cleanup needed */
+    uint8_t i;
+
+    for (i = 0; i < g_pool_count; i++) {
+        dos_free(g_pool_seg[i]);
+    }
+    g_pool_count = 0;
+    for (i = 0; i < MEM_CLASS_COUNT; i++) {
+        g_free[i] = (char __far *)0;
+    }
+
+    if (g_lifo_seg != 0) {
+        dos_free(g_lifo_seg);
+        g_lifo_seg = 0;
+    }
 }
 
 /*---------------------------------------------------------------------------
@@ -108,39 +423,84 @@ const char *mem_get_tier_name(void)
     return "UNKNOWN";
 }
 
+/*---------------------------------------------------------------------------
+ * mem_get_tag_name - Get owner tag name for display
+ *---------------------------------------------------------------------------*/
+const char *mem_get_tag_name(uint8_t tag)
+{
+    if (tag < MEM_TAG_COUNT) {
+        return tag_names[tag];
+    }
+    return "Other";
+}
+
 /*---------------------------------------------------------------------------
  * mem_alloc - Allocate far memory block
  *
- * Uses DOS INT 21h AH=48h to allocate memory.
+ * Small requests come from the pools; larger ones, or any request when
+ * the pools are exhausted, use DOS INT 21h AH=48h.
  * Returns far pointer or NULL on failure.
  *---------------------------------------------------------------------------*/
-void __far *mem_alloc(uint32_t bytes)
+void __far *mem_alloc(uint32_t bytes, uint8_t tag)
 {
-    union REGS regs;
-    uint16_t paragraphs;
+    void __far *ptr;
     uint16_t segment;
+    MemBig __far *big;
 
-    /* Calculate paragraphs needed (round up) */
-    paragraphs = (uint16_t)((bytes + 15L) / 16L);
-
-    /* DOS allocate memory */
-    regs.h.ah = 0x48;
-    regs.x.bx = paragraphs;
-    int86(0x21, &regs, &regs);
+    if (bytes <= MEM_SMALL_MAX) {
+        ptr = pool_alloc((uint16_t)bytes, tag);
+        if (ptr != (void __far *)0) {
+            count_alloc(tag, bytes);
+            return ptr;
+        }
+    }
 
-    /* Check for error (carry flag set) */
-    if (regs.x.cflag) {
+    /* One paragraph more for the header */
+    segment = dos_alloc(bytes + 16L);
+    if (segment == 0) {
         return (void __far *)0;
     }
 
-    /* AX contains segment of allocated block */
-    segment = regs.x.ax;
+    big = (MemBig __far *)MK_FP(segment, 0);
+    big->size = bytes;
+    big->tag = tag;
+    big->magic = MEM_MAGIC;
 
-    /* Update free memory estimate */
-    g_mem.free_kb -= (bytes + 1023L) / 1024L;
+    g_stats.dos_blocks++;
+    count_alloc(tag, bytes);
 
     /* Return far pointer (segment:0000) */
-    return MK_FP(segment, 0);
+    return MK_FP(segment + 1, 0);
+}
+
+/*---------------------------------------------------------------------------
+ * mem_alloc_lifo - Allocate a block from the dialog stack
+ *
+ * Falls back to mem_alloc when the stack is full.
+ *---------------------------------------------------------------------------*/
+void __far *mem_alloc_lifo(uint16_t bytes)
+{
+    uint16_t span;
+    MemHdr __far *hdr;
+
+    if (g_lifo_seg != 0 && bytes <= MEM_LIFO_SIZE - sizeof(MemHdr)) {
+        span = sizeof(MemHdr) + ((bytes + 1) & ~1);
+        if (MEM_LIFO_SIZE - g_lifo_top >= span) {
+            hdr = (MemHdr __far *)MK_FP(g_lifo_seg, g_lifo_top);
+            hdr->size = bytes;
+            hdr->link = g_lifo_last;
+            hdr->cls = MEM_CLASS_LIFO;
+            hdr->tag = MEM_TAG_DIALOG;
+            hdr->magic = MEM_MAGIC;
+            g_lifo_last = g_lifo_top;
+            g_lifo_top += span;
+
+            count_alloc(MEM_TAG_DIALOG, bytes);
+            return (char __far *)hdr + sizeof(MemHdr);
+        }
+    }
+
+    return mem_alloc(bytes, MEM_TAG_DIALOG);
 }
 
 /*---------------------------------------------------------------------------
@@ -148,27 +508,47 @@ void __far *mem_alloc(uint32_t bytes)
  *---------------------------------------------------------------------------*/
 void mem_free(void __far *ptr)
 {
-    union REGS regs;
-    struct SREGS sregs;
+    MemHdr __far *hdr;
+    MemBig __far *big;
 
     if (ptr == (void __far *)0) {
         return;
     }
 
-    /* Get segment from far pointer */
-    segread(&sregs);
-    sregs.es = FP_SEG(ptr);
+    /* Straight from DOS (a block freed twice is ignored) */
+    if (FP_OFF(ptr) == 0) {
+        big = BIG(ptr);
+        if (big->magic != MEM_MAGIC) {
+            return;
+        }
+        big->magic = MEM_FREED;
+        g_stats.dos_blocks--;
+        count_free(big->tag, big->size);
+        dos_free(FP_SEG(ptr) - 1);
+        return;
+    }
 
-    /* DOS free memory */
-    regs.h.ah = 0x49;
-    int86x(0x21, &regs, &regs, &sregs);
+    hdr = HDR(ptr);
+    if (hdr->magic != MEM_MAGIC) {
+        return;
+    }
+
+    count_free(hdr->tag, hdr->size);
+
+    if (hdr->cls == MEM_CLASS_LIFO) {
+        lifo_free(hdr);
+    } else {
+        hdr->magic = MEM_FREED;
+        pool_free(hdr);
+    }
 }
 
 /*---------------------------------------------------------------------------
  * mem_realloc - Reallocate far memory block
  *
  * DOS doesn't have a true realloc, so we:
- * 1. Try to resize in place (INT 21h AH=4Ah)
+ * 1. Try to resize in place (INT 21h AH=4Ah, or within the size class
+ *    for a pool block)
  * 2. If that fails, allocate new, copy, free old
  *---------------------------------------------------------------------------*/
 void __far *mem_realloc(void __far *ptr, uint32_t old_size, uint32_t new_size)
@@ -176,14 +556,17 @@ void __far *mem_realloc(void __far *ptr, uint32_t old_size, uint32_t new_size)
     union REGS regs;
     struct SREGS sregs;
     uint16_t new_paragraphs;
+    MemHdr __far *hdr;
+    MemBig __far *big;
+    uint8_t tag;
     void __far *new_ptr;
     uint32_t copy_size;
-    uint16_t i;
+    uint16_t n;
     char __far *src;
     char __far *dst;
 
     if (ptr == (void __far *)0) {
-        return mem_alloc(new_size);
+        return (void __far *)0;
     }
 
     if (new_size == 0) {
@@ -191,33 +574,58 @@ void __far *mem_realloc(void __far *ptr, uint32_t old_size, uint32_t new_size)
         return (void __far *)0;
     }
 
-    /* Calculate new size in paragraphs */
-    new_paragraphs = (uint16_t)((new_size + 15L) / 16L);
+    if (FP_OFF(ptr) != 0) {
+        /* Pool block: keep it while the new size fits its class */
+        hdr = HDR(ptr);
+        tag = hdr->tag;
+        if (hdr->cls != MEM_CLASS_LIFO &&
+            new_size <= (uint16_t)(MEM_CLASS_MIN << hdr->cls)) {
+            count_bytes(tag, hdr->size, new_size);
+            g_pool_data += new_size - hdr->size;
+            hdr->size = (uint16_t)new_size;
+            return ptr;
+        }
+    } else {
+        big = BIG(ptr);
+        tag = big->tag;
 
-    /* Try to resize in place */
-    segread(&sregs);
-    sregs.es = FP_SEG(ptr);
-    regs.h.ah = 0x4A;
-    regs.x.bx = new_paragraphs;
-    int86x(0x21, &regs, &regs, &sregs);
+        /* Calculate new size in paragraphs, plus the header */
+        new_paragraphs = (uint16_t)((new_size + 15L) / 16L) + 1;
+
+        /* Try to resize in place */
+        dos_held(FP_SEG(big), FALSE);
+        segread(&sregs);
+        sregs.es = FP_SEG(big);
+        regs.h.ah = 0x4A;
+        regs.x.bx = new_paragraphs;
+        int86x(0x21, &regs, &regs, &sregs);
+        dos_held(FP_SEG(big), TRUE);
 
-    /* If resize succeeded, we're done */
-    if (!regs.x.cflag) {
-        return ptr;
+        /* If resize succeeded, we're done */
+        if (!regs.x.cflag) {
+            count_bytes(tag, big->size, new_size);
+            big->size = new_size;
+            return ptr;
+        }
     }
 
     /* Resize failed - allocate new block and copy */
-    new_ptr = mem_alloc(new_size);
+    new_ptr = mem_alloc(new_size, tag);
     if (new_ptr == (void __far *)0) {
         return (void __far *)0;
     }
 
-    /* Copy data (minimum of old and new sizes) */
+    /* Copy data (minimum of old and new sizes), 32KB at a time so the
+     * offsets never wrap on blocks past 64KB */
     copy_size = (old_size < new_size) ? old_size : new_size;
     src = (char __far *)ptr;
     dst = (char __far *)new_ptr;
-    for (i = 0; i < copy_size; i++) {
-        dst[i] = src[i];
+    while (copy_size > 0) {
+        n = (copy_size > 0x8000L) ? 0x8000 : (uint16_t)copy_size;
+        mem_copy_far(dst, src, n);
+        copy_size -= n;
+        src = (char __far *)MK_FP(FP_SEG(src) + (n >> 4), FP_OFF(src));
+        dst = (char __far *)MK_FP(FP_SEG(dst) + (n >> 4), FP_OFF(dst));
     }
 
     /* Free old block */
@@ -226,6 +634,406 @@ void __far *mem_realloc(void __far *ptr, uint32_t old_size, uint32_t new_size)
     return new_ptr;
 }
 
+/*---------------------------------------------------------------------------
+ * mem_get_stats - Fill in allocator statistics
+ *
+ * frag_pct is the share of pool bytes handed out that do not hold caller
+ * data: blocks waiting on free lists, headers and size-class rounding.
+ *---------------------------------------------------------------------------*/
+void mem_get_stats(MemStats *stats)
+{
+    uint8_t i;
+
+    *stats = g_stats;
+
+    stats->pools = g_pool_count;
+    stats->pool_bytes = (uint32_t)g_pool_count * g_mem.pool_size;
+    stats->pool_unused = 0;
+    for (i = 0; i < g_pool_count; i++) {
+        stats->pool_unused += g_mem.pool_size - g_pool_used[i];
+    }
+    stats->lifo_used = g_lifo_top;
+    stats->dos_bytes = g_dos_bytes;
+    stats->largest_free = mem_get_available_kb() * 1024L;
+
+    stats->frag_pct = 0;
+    if (g_pool_carved != 0) {
+        stats->frag_pct = (uint8_t)((g_pool_carved - g_pool_data) * 100L /
+                                    g_pool_carved);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * mem_offer - Offer an idle buffer for lending (NULL withdraws)
+ *---------------------------------------------------------------------------*/
+void mem_offer(void __far *ptr, uint32_t size, uint8_t tag)
+{
+    if (g_loan_out) {
+        mem_give_back();
+    }
+    g_loan = ptr;
+    g_loan_size = (ptr != (void __far *)0) ? size : 0;
+    g_loan_owner = tag;
+}
+
+/*---------------------------------------------------------------------------
+ * mem_borrow - Borrow the offered buffer
+ *---------------------------------------------------------------------------*/
+void __far *mem_borrow(uint32_t *size, uint8_t tag)
+{
+    if (g_loan == (void __far *)0 || g_loan_out) {
+        *size = 0;
+        return (void __far *)0;
+    }
+
+    g_loan_out = TRUE;
+    g_loan_borrower = tag;
+    count_bytes(g_loan_owner, g_loan_size, 0);
+    count_bytes(tag, 0, g_loan_size);
+
+    *size = g_loan_size;
+    return g_loan;
+}
+
+/*---------------------------------------------------------------------------
+ * mem_give_back - Return the borrowed buffer
+ *---------------------------------------------------------------------------*/
+void mem_give_back(void)
+{
+    if (!g_loan_out) {
+        return;
+    }
+
+    g_loan_out = FALSE;
+    count_bytes(g_loan_borrower, g_loan_size, 0);
+    count_bytes(g_loan_owner, 0, g_loan_size);
+}
+
+/*---------------------------------------------------------------------------
+ * mem_format_row - Format "label  in-use  peak" as a 32-column row
+ *---------------------------------------------------------------------------*/
+void mem_format_row(char *buf, const char *label, uint32_t bytes, uint32_t peak)
+{
+    char num[16];
+    uint16_t len;
+    uint16_t i;
+
+    for (i = 0; i < 32; i++) {
+        buf[i] = ' ';
+    }
+    buf[32] = '\0';
+
+    len = str_len(label);
+    for (i = 0; i < len && i < 10; i++) {
+        buf[i] = label[i];
+    }
+
+    /* Numbers right-aligned in two 11-column fields */
+    num_format(num, bytes);
+    len = str_len(num);
+    for (i = 0; i < len; i++) {
+        buf[21 - len + i] = num[i];
+    }
+
+    num_format(num, peak);
+    len = str_len(num);
+    for (i = 0; i < len; i++) {
+        buf[32 - len + i] = num[i];
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * log_line - Write one line to the log
+ *---------------------------------------------------------------------------*/
+static void log_line(dos_handle_t h, const char *text)
+{
+    dos_write(h, text, str_len(text));
+    dos_write(h, "\r\n", 2);
+}
+
+/*---------------------------------------------------------------------------
+ * mem_write_log - Append usage by owner and the high-water marks to a log
+ *
+ * Called on exit, after the subsystems have freed their buffers, so the
+ * in-use column shows anything left over.  A log past MEM_LOG_MAX is
+ * started afresh, so it holds the last few runs rather than all of them.
+ *---------------------------------------------------------------------------*/
+bool_t mem_write_log(const char *path)
+{
+    dos_handle_t h;
+    MemStats st;
+    char buf[80];
+    char num[16];
+    uint8_t i;
+    int32_t at;
+
+    h = dos_open(path, DOS_OPEN_WRITE);
+    if (h >= 0) {
+        at = dos_seek(h, 0, DOS_SEEK_END);
+        if (at < 0 || at >= MEM_LOG_MAX) {
+            dos_close(h);
+            h = -1;
+        }
+    }
+    if (h < 0) {
+        h = dos_create(path, 0);
+        if (h < 0) {
+            return FALSE;
+        }
+    }
+
+    mem_get_stats(&st);
+
+    str_copy(buf, "Memory: ");
+    str_copy(buf + str_len(buf), mem_get_tier_name());
+    str_copy(buf + str_len(buf), ", ");
+    num_format(num, g_mem.total_kb);
+    str_copy(buf + str_len(buf), num);
+    str_copy(buf + str_len(buf), "KB free at start");
+    log_line(h, buf);
+
+    log_line(h, "Owner          In use       Peak");
+    for (i = 0; i < MEM_TAG_COUNT; i++) {
+        mem_format_row(buf, tag_names[i], st.tag_bytes[i], st.tag_peak[i]);
+        log_line(h, buf);
+    }
+    mem_format_row(buf, "Total", st.bytes_in_use, st.peak_bytes);
+    log_line(h, buf);
+
+    str_copy(buf, "Allocations ");
+    num_format(num, st.allocs);
+    str_copy(buf + str_len(buf), num);
+    str_copy(buf + str_len(buf), ", pools ");
+    num_format(num, st.pools);
+    str_copy(buf + str_len(buf), num);
+    str_copy(buf + str_len(buf), ", fragmentation ");
+    num_format(num, st.frag_pct);
+    str_copy(buf + str_len(buf), num);
+    str_copy(buf + str_len(buf), "%");
+    log_line(h, buf);
+
+    str_copy(buf, "Largest free DOS block ");
+    num_format(num, st.largest_free / 1024L);
+    str_copy(buf + str_len(buf), num);
+    str_copy(buf + str_len(buf), "KB");
+    log_line(h, buf);
+    log_line(h, "");
+
+    dos_close(h);
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * Heap Image
+ *
+ * The blocks are found by walking the DOS memory chain for blocks owned
+ * by our PSP (other than the program and its environment), so pools,
+ * the dialog stack and big blocks are all covered without a list of
+ * their own.  The image is just their contents, lowest segment first.
+ *---------------------------------------------------------------------------*/
+#define MEM_IMAGE_STEP  0x7FF       /* Paragraphs per read/write (< 32KB) */
+
+typedef struct {
+    uint16_t seg;               /* Block segment */
+    uint16_t paras;             /* Size in paragraphs */
+} MemImageBlock;
+
+static MemImageBlock g_image[MEM_IMAGE_MAX];
+static uint8_t g_image_count;
+static char g_image_path[MAX_PATH_LEN];
+
+/*---------------------------------------------------------------------------
+ * image_blocks - List the DOS blocks we own, lowest first
+ *
+ * The first memory control block is the word before the List of Lists
+ * (INT 21h AH=52h).  Each MCB is 'M', or 'Z' for the last, then the
+ * owner's PSP and the size in paragraphs.
+ *---------------------------------------------------------------------------*/
+static bool_t image_blocks(void)
+{
+    union REGS regs;
+    struct SREGS sregs;
+    uint16_t psp = dos_get_psp();
+    uint16_t env = *(uint16_t __far *)MK_FP(psp, 0x2C);
+    uint16_t mcb;
+    uint16_t paras;
+    char __far *m;
+
+    segread(&sregs);
+    regs.h.ah = 0x52;
+    int86x(0x21, &regs, &regs, &sregs);
+    mcb = *(uint16_t __far *)MK_FP(sregs.es, regs.x.bx - 2);
+
+    g_image_count = 0;
+    for (;;) {
+        m = (char __far *)MK_FP(mcb, 0);
+        if (m[0] != 'M' && m[0] != 'Z') {
+            return FALSE;
+        }
+        paras = *(uint16_t __far *)(m + 3);
+
+        if (*(uint16_t __far *)(m + 1) == psp &&
+            mcb + 1 != psp && mcb + 1 != env) {
+            if (g_image_count == MEM_IMAGE_MAX) {
+                return FALSE;
+            }
+            g_image[g_image_count].seg = mcb + 1;
+            g_image[g_image_count].paras = paras;
+            g_image_count++;
+        }
+
+        if (m[0] == 'Z') {
+            break;
+        }
+        mcb += paras + 1;
+    }
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * image_io - Write the listed blocks to h, or read them back
+ *---------------------------------------------------------------------------*/
+static bool_t image_io(dos_handle_t h, bool_t write)
+{
+    uint8_t i;
+    uint16_t done;
+    uint16_t n;
+    void __far *p;
+
+    for (i = 0; i < g_image_count; i++) {
+        for (done = 0; done < g_image[i].paras; done += n) {
+            n = g_image[i].paras - done;
+            if (n > MEM_IMAGE_STEP) {
+                n = MEM_IMAGE_STEP;
+            }
+            p = MK_FP(g_image[i].seg + done, 0);
+            if ((write ? dos_write(h, p, n * 16) : dos_read(h, p, n * 16)) !=
+                (int16_t)(n * 16)) {
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * take_largest - Allocate the largest free DOS block; 0 if there is none
+ *---------------------------------------------------------------------------*/
+static uint16_t take_largest(uint16_t *paras)
+{
+    union REGS regs;
+
+    regs.h.ah = 0x48;
+    regs.x.bx = 0xFFFF;
+    int86(0x21, &regs, &regs);
+    *paras = regs.x.bx;
+
+    regs.h.ah = 0x48;
+    int86(0x21, &regs, &regs);
+    return regs.x.cflag ? 0 : regs.x.ax;
+}
+
+/*---------------------------------------------------------------------------
+ * dos_resize - Resize a DOS block in place (INT 21h AH=4Ah)
+ *---------------------------------------------------------------------------*/
+static bool_t dos_resize(uint16_t segment, uint16_t paras)
+{
+    union REGS regs;
+    struct SREGS sregs;
+
+    segread(&sregs);
+    sregs.es = segment;
+    regs.h.ah = 0x4A;
+    regs.x.bx = paras;
+    int86x(0x21, &regs, &regs, &sregs);
+    return regs.x.cflag ? FALSE : TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * mem_swap_out - Write the far heap to an image file and free it
+ *---------------------------------------------------------------------------*/
+bool_t mem_swap_out(const char *path)
+{
+    dos_handle_t h;
+    bool_t ok;
+    uint8_t i;
+
+    if (!image_blocks() || g_image_count == 0) {
+        return FALSE;
+    }
+
+    h = dos_create(path, 0);
+    if (h < 0) {
+        return FALSE;
+    }
+    ok = image_io(h, TRUE);
+    dos_close(h);
+    if (!ok) {
+        dos_delete(path);
+        return FALSE;
+    }
+
+    str_copy(g_image_path, path);
+    for (i = 0; i < g_image_count; i++) {
+        dos_release(g_image[i].seg);
+    }
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * mem_swap_in - Take the blocks back at their old segments and reload them
+ *
+ * With the child gone the memory above IGC is normally one free run.  The
+ * blocks are rebuilt lowest first: the largest free block is taken, cut
+ * down to end just below the next segment wanted (a filler standing in
+ * for what was a hole), and the largest block is then taken again, which
+ * now starts exactly there.  The fillers are freed once all are placed.
+ *---------------------------------------------------------------------------*/
+bool_t mem_swap_in(void)
+{
+    uint16_t fillers[MEM_IMAGE_MAX];
+    uint8_t n_fillers = 0;
+    uint16_t seg;
+    uint16_t avail;
+    uint16_t want;
+    dos_handle_t h;
+    bool_t ok = TRUE;
+    uint8_t i;
+
+    for (i = 0; i < g_image_count && ok; i++) {
+        want = g_image[i].seg;
+        seg = take_largest(&avail);
+        if (seg != 0 && seg < want) {
+            if ((uint32_t)seg + avail < (uint32_t)want + g_image[i].paras ||
+                !dos_resize(seg, want - seg - 1)) {
+                dos_release(seg);
+                ok = FALSE;
+                break;
+            }
+            fillers[n_fillers++] = seg;
+            seg = take_largest(&avail);
+        }
+        ok = (seg == want && avail >= g_image[i].paras &&
+              dos_resize(seg, g_image[i].paras));
+    }
+
+    while (n_fillers > 0) {
+        dos_release(fillers[--n_fillers]);
+    }
+    if (!ok) {
+        return FALSE;
+    }
+
+    h = dos_open(g_image_path, DOS_OPEN_READ);
+    if (h < 0) {
+        return FALSE;
+    }
+    ok = image_io(h, FALSE);
+    dos_close(h);
+    dos_delete(g_image_path);
+    return ok;
+}
+
 /*---------------------------------------------------------------------------
  * Tier-Based Limit Accessors
  *---------------------------------------------------------------------------*/
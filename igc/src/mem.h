@@ -18,10 +18,60 @@ typedef struct {
     uint16_t files_per_panel;   /* Max files based on tier */
     uint32_t editor_buf_size;   /* Editor buffer size based on tier */
     uint16_t copy_buf_size;     /* Copy buffer size based on tier */
+    uint16_t pool_size;         /* Small-allocation pool size based on tier */
 } MemState;
 
 extern MemState g_mem;
 
+/*---------------------------------------------------------------------------
+ * Sub-Allocator
+ * Requests up to MEM_SMALL_MAX bytes are carved from a few large DOS blocks
+ * (pools) and recycled through one free list per size class; larger ones
+ * go to DOS.  Dialog save buffers come from a separate stack block.
+ *---------------------------------------------------------------------------*/
+#define MEM_POOL_MAX      4         /* Pools taken from DOS at most */
+#define MEM_CLASS_MIN     16        /* Smallest size class (bytes) */
+#define MEM_CLASS_COUNT   9         /* Classes 16, 32, ... 4096 bytes */
+#define MEM_SMALL_MAX     4096      /* Largest request served from a pool */
+#define MEM_LIFO_SIZE     4096      /* Dialog save stack (bytes) */
+
+/*---------------------------------------------------------------------------
+ * Owner Tags (who an allocation is charged to)
+ *---------------------------------------------------------------------------*/
+#define MEM_TAG_PANEL     0         /* Panel file lists */
+#define MEM_TAG_EDITOR    1         /* Editor text, lines, undo, screen */
+#define MEM_TAG_COPY      2         /* Copy buffer */
+#define MEM_TAG_DIALOG    3         /* Dialog save buffers */
+#define MEM_TAG_VIEWER    4         /* Paged viewer */
+#define MEM_TAG_SEARCH    5         /* File search buffers */
+#define MEM_TAG_DIFF      6         /* File compare */
+#define MEM_TAG_JOBS      7         /* Background job queue */
+#define MEM_TAG_SWAP      8         /* Swap file resident pages */
+#define MEM_TAG_COUNT     9
+
+/*---------------------------------------------------------------------------
+ * Allocator Statistics
+ * Byte counts are what callers asked for; dos_bytes is what is held from
+ * DOS, including pools, the dialog stack and block headers.
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    uint32_t allocs;            /* Allocations since startup */
+    uint16_t live;              /* Blocks currently allocated */
+    uint32_t bytes_in_use;      /* Bytes held by live blocks */
+    uint32_t peak_bytes;        /* High-water mark of bytes_in_use */
+    uint32_t tag_bytes[MEM_TAG_COUNT];  /* bytes_in_use by owner */
+    uint32_t tag_peak[MEM_TAG_COUNT];   /* High-water mark by owner */
+    uint32_t dos_bytes;         /* Bytes held from DOS */
+    uint32_t largest_free;      /* Largest free DOS block (bytes) */
+    uint16_t dos_blocks;        /* Live blocks taken straight from DOS */
+    uint8_t  pools;             /* Pools taken from DOS */
+    uint32_t pool_bytes;        /* Bytes in pools */
+    uint32_t pool_free;         /* Pool bytes on the free lists */
+    uint32_t pool_unused;       /* Pool bytes never handed out */
+    uint16_t lifo_used;         /* Bytes in use on the dialog stack */
+    uint8_t  frag_pct;          /* Handed-out pool bytes not holding data */
+} MemStats;
+
 /*---------------------------------------------------------------------------
  * Initialization
  *---------------------------------------------------------------------------*/
@@ -29,7 +79,7 @@ extern MemState g_mem;
 /* Initialize memory system, detect available RAM, set tier */
 void mem_init(void);
 
-/* Shutdown - free all tracked allocations */
+/* Shutdown - release the pools and dialog stack */
 void mem_shutdown(void);
 
 /*---------------------------------------------------------------------------
@@ -45,20 +95,72 @@ uint8_t mem_get_tier(void);
 /* Get tier name for display */
 const char *mem_get_tier_name(void);
 
+/* Get owner tag name for display */
+const char *mem_get_tag_name(uint8_t tag);
+
+/* Fill in allocator statistics */
+void mem_get_stats(MemStats *stats);
+
+/*---------------------------------------------------------------------------
+ * Lending
+ * An owner whose buffer sits idle between uses (the editor's text buffer
+ * while the editor is closed) offers it; another subsystem borrows it for
+ * one operation and gives it back before the owner runs again.  While lent
+ * the bytes are charged to the borrower.
+ *---------------------------------------------------------------------------*/
+
+/* Offer an idle buffer for lending (ptr NULL withdraws the offer) */
+void mem_offer(void __far *ptr, uint32_t size, uint8_t tag);
+
+/* Borrow the offered buffer; NULL if none is offered or it is out */
+void __far *mem_borrow(uint32_t *size, uint8_t tag);
+
+/* Return the borrowed buffer */
+void mem_give_back(void);
+
+/* Format "label  in-use  peak" as a 32-column row */
+void mem_format_row(char *buf, const char *label, uint32_t bytes, uint32_t peak);
+
+/* Append usage by owner and the high-water marks to a log (MEM_LOG_FILE,
+ * restarted once it reaches MEM_LOG_MAX bytes) */
+#define MEM_LOG_FILE      "IGC.LOG"
+#define MEM_LOG_MAX       8192L
+bool_t mem_write_log(const char *path);
+
+/*---------------------------------------------------------------------------
+ * Heap Image
+ * Before another program runs, every DOS block IGC holds is written to a
+ * file and freed.  Afterwards the blocks are taken back at the same
+ * segments and read in, so every far pointer is valid again.
+ *---------------------------------------------------------------------------*/
+#define MEM_IMAGE_MAX     32        /* DOS blocks in an image */
+
+/* Write the far heap to an image file and free it; FALSE (and nothing
+ * freed) if it cannot be written */
+bool_t mem_swap_out(const char *path);
+
+/* Take the blocks back and reload them, deleting the image; FALSE if
+ * another program now holds that memory - IGC cannot go on then */
+bool_t mem_swap_in(void);
+
 /*---------------------------------------------------------------------------
  * Allocation Functions
  * These wrap DOS memory allocation for far heap
  *---------------------------------------------------------------------------*/
 
-/* Allocate far memory block */
-void __far *mem_alloc(uint32_t bytes);
+/* Allocate far memory block, charged to an owner (MEM_TAG_xxx) */
+void __far *mem_alloc(uint32_t bytes, uint8_t tag);
 
 /* Free far memory block */
 void mem_free(void __far *ptr);
 
-/* Reallocate far memory block (may move) */
+/* Reallocate far memory block from mem_alloc (may move, keeps its owner) */
 void __far *mem_realloc(void __far *ptr, uint32_t old_size, uint32_t new_size);
 
+/* Allocate a short-lived block that is normally freed (with mem_free)
+ * before any block allocated after it, such as a dialog save buffer */
+void __far *mem_alloc_lifo(uint16_t bytes);
+
 /*---------------------------------------------------------------------------
  * Tier-Based Limits
  *---------------------------------------------------------------------------*/
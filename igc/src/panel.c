@@ -3,8 +3,6 @@
  * File list management with dynamic allocation
  */
 
-#include <dos.h>
-#include <i86.h>
 #include "panel.h"
 #include "mem.h"
 #include "util.h"
@@ -18,100 +16,291 @@ Panel g_left_panel;
 Panel g_right_panel;
 uint8_t g_active_panel = 0;
 
-/* Static DTA for find operations */
-static DTA g_dta;
-
 /*---------------------------------------------------------------------------
- * Set DTA address for find operations
+ * Compare file entries for sorting (directories first, then alphabetical)
  *---------------------------------------------------------------------------*/
-static void set_dta(DTA *dta)
+static int file_compare(FileEntry __far *a, FileEntry __far *b)
 {
-    union REGS regs;
-    struct SREGS sregs;
+    int a_dir = (a->attr & DOS_ATTR_DIRECTORY) ? 1 : 0;
+    int b_dir = (b->attr & DOS_ATTR_DIRECTORY) ? 1 : 0;
+
+    /* ".." always comes first */
+    if (a->name[0] == '.' && a->name[1] == '.' && a->name[2] == '\0') return -1;
+    if (b->name[0] == '.' && b->name[1] == '.' && b->name[2] == '\0') return 1;
+
+    /* Directories before files */
+    if (a_dir != b_dir) {
+        return b_dir - a_dir;
+    }
 
-    segread(&sregs);
-    regs.h.ah = 0x1A;
-    regs.x.dx = FP_OFF(dta);
-    sregs.ds = FP_SEG(dta);
-    int86x(0x21, &regs, &regs, &sregs);
+    /* Alphabetical (case-insensitive) */
+    return str_cmp_i(a->name, b->name);
 }
 
 /*---------------------------------------------------------------------------
- * Find first file matching pattern
+ * list_entry - Entry i of a file list, in memory or in a swap page
+ *
+ * Set dirty only to change the entry: a spilled page read clean is
+ * dropped on eviction instead of being written back.
  *---------------------------------------------------------------------------*/
-static int find_first(const char *pattern, uint8_t attr)
+static FileEntry __far *list_entry(FileList *fl, uint16_t i, bool_t dirty)
 {
-    union REGS regs;
-    struct SREGS sregs;
+    char __far *page;
 
-    segread(&sregs);
-    regs.h.ah = 0x4E;
-    regs.x.cx = attr;
-    regs.x.dx = FP_OFF(pattern);
-    sregs.ds = FP_SEG(pattern);
-    int86x(0x21, &regs, &regs, &sregs);
+    if (i < fl->capacity) {
+        return &fl->entries[i];
+    }
 
-    return regs.x.cflag ? -1 : 0;
+    i -= fl->capacity;
+    page = swap_page(&fl->spill, i / FILES_PER_SWAP_PAGE, dirty);
+    if (page == (char __far *)0) {
+        return (FileEntry __far *)0;
+    }
+    return (FileEntry __far *)(page + (i % FILES_PER_SWAP_PAGE) *
+                                      sizeof(FileEntry));
 }
 
 /*---------------------------------------------------------------------------
- * Find next file
+ * spill_pages - Swap pages holding entries past capacity
+ * The spill area is twice this plus the sort pages: sort_spilled merges
+ * the whole list into the pages that follow.
  *---------------------------------------------------------------------------*/
-static int find_next(void)
+static uint16_t spill_pages(FileList *fl)
 {
-    union REGS regs;
+    return (FILES_PER_PANEL_MAX - fl->capacity + FILES_PER_SWAP_PAGE - 1) /
+           FILES_PER_SWAP_PAGE;
+}
 
-    regs.h.ah = 0x4F;
-    int86(0x21, &regs, &regs);
+#define SORT_PAGES  ((FILES_PER_PANEL_MAX + FILES_PER_SWAP_PAGE - 1) / \
+                     FILES_PER_SWAP_PAGE)
+
+/*---------------------------------------------------------------------------
+ * sort_run - Sort n entries held in one block of memory (Shell sort)
+ *---------------------------------------------------------------------------*/
+static void sort_run(FileEntry __far *e, uint16_t n)
+{
+    uint16_t gap, i, j;
+    FileEntry temp;
 
-    return regs.x.cflag ? -1 : 0;
+    for (gap = n / 2; gap > 0; gap /= 2) {
+        for (i = gap; i < n; i++) {
+            mem_copy_far(&temp, &e[i], sizeof(FileEntry));
+            for (j = i; j >= gap && file_compare(&e[j - gap], &temp) > 0; j -= gap) {
+                mem_copy_far(&e[j], &e[j - gap], sizeof(FileEntry));
+            }
+            mem_copy_far(&e[j], &temp, sizeof(FileEntry));
+        }
+    }
 }
 
 /*---------------------------------------------------------------------------
- * Compare file entries for sorting (directories first, then alphabetical)
+ * sort_spilled - Sort a list whose tail lives in swap pages
+ *
+ * The memory part and each spilled page are sorted in place as runs, then
+ * merged into the sort pages and copied back, so every page is read or
+ * written a fixed number of times.  The merge keeps the next entry of
+ * each run in fl->heads, which is why it needs no more than one spilled
+ * page read per entry.
  *---------------------------------------------------------------------------*/
-static int file_compare(FileEntry __far *a, FileEntry __far *b)
-{
-    int a_dir = (a->attr & DOS_ATTR_DIRECTORY) ? 1 : 0;
-    int b_dir = (b->attr & DOS_ATTR_DIRECTORY) ? 1 : 0;
+static void sort_spilled(FileList *fl)
+{
+    uint16_t spilled = fl->count - fl->capacity;
+    uint16_t runs = 1 + (spilled + FILES_PER_SWAP_PAGE - 1) / FILES_PER_SWAP_PAGE;
+    uint16_t __far *pos = (uint16_t __far *)(fl->heads + runs);
+    uint16_t sorted = spill_pages(fl);
+    uint16_t out, r, best, end;
+    char __far *page;
+    FileEntry __far *e;
+    FileEntry temp;
 
-    /* ".." always comes first */
-    if (a->name[0] == '.' && a->name[1] == '.' && a->name[2] == '\0') return -1;
-    if (b->name[0] == '.' && b->name[1] == '.' && b->name[2] == '\0') return 1;
+    /* Runs: the memory part, then one per spilled page */
+    sort_run(fl->entries, fl->capacity);
+    for (r = 1; r < runs; r++) {
+        page = swap_page(&fl->spill, r - 1, TRUE);
+        if (page == (char __far *)0) {
+            return;
+        }
+        end = (r == runs - 1) ? spilled - (r - 1) * FILES_PER_SWAP_PAGE :
+                                FILES_PER_SWAP_PAGE;
+        sort_run((FileEntry __far *)page, end);
+    }
 
-    /* Directories before files */
-    if (a_dir != b_dir) {
-        return b_dir - a_dir;
+    for (r = 0; r < runs; r++) {
+        pos[r] = (r == 0) ? 0 : fl->capacity + (r - 1) * FILES_PER_SWAP_PAGE;
+        e = list_entry(fl, pos[r], FALSE);
+        if (e == (FileEntry __far *)0) {
+            return;
+        }
+        mem_copy_far(&fl->heads[r], e, sizeof(FileEntry));
     }
 
-    /* Alphabetical (case-insensitive) */
-    return str_cmp_i(a->name, b->name);
+    /* Merge into the sort pages, in order */
+    for (out = 0; out < fl->count; out++) {
+        best = runs;
+        for (r = 0; r < runs; r++) {
+            end = (r == 0) ? fl->capacity : fl->capacity + r * FILES_PER_SWAP_PAGE;
+            if (end > fl->count) {
+                end = fl->count;
+            }
+            if (pos[r] < end &&
+                (best == runs || file_compare(&fl->heads[r], &fl->heads[best]) < 0)) {
+                best = r;
+            }
+        }
+
+        page = swap_page(&fl->spill, sorted + out / FILES_PER_SWAP_PAGE, TRUE);
+        if (page == (char __far *)0) {
+            return;
+        }
+        mem_copy_far(page + (out % FILES_PER_SWAP_PAGE) * sizeof(FileEntry),
+                     &fl->heads[best], sizeof(FileEntry));
+
+        pos[best]++;
+        end = (best == 0) ? fl->capacity : fl->capacity + best * FILES_PER_SWAP_PAGE;
+        if (pos[best] < end && pos[best] < fl->count) {
+            e = list_entry(fl, pos[best], FALSE);
+            if (e == (FileEntry __far *)0) {
+                return;
+            }
+            mem_copy_far(&fl->heads[best], e, sizeof(FileEntry));
+        }
+    }
+
+    /* Copy back; both pages stay resident for a page's worth of entries */
+    for (out = 0; out < fl->count; out++) {
+        page = swap_page(&fl->spill, sorted + out / FILES_PER_SWAP_PAGE, FALSE);
+        if (page == (char __far *)0) {
+            return;
+        }
+        mem_copy_far(&temp, page + (out % FILES_PER_SWAP_PAGE) * sizeof(FileEntry),
+                     sizeof(FileEntry));
+        e = list_entry(fl, out, TRUE);
+        if (e == (FileEntry __far *)0) {
+            return;
+        }
+        mem_copy_far(e, &temp, sizeof(FileEntry));
+    }
 }
 
 /*---------------------------------------------------------------------------
- * Sort file list (simple bubble sort - adequate for small lists)
+ * Sort file list (directories first, then by name)
  *---------------------------------------------------------------------------*/
 static void sort_files(FileList *fl)
 {
-    uint16_t i, j;
-    FileEntry temp;
-    FileEntry __far *a;
-    FileEntry __far *b;
-
     if (fl->count < 2) return;
 
-    for (i = 0; i < fl->count - 1; i++) {
-        for (j = 0; j < fl->count - i - 1; j++) {
-            a = &fl->entries[j];
-            b = &fl->entries[j + 1];
+    if (fl->count <= fl->capacity) {
+        sort_run(fl->entries, fl->count);
+    } else {
+        sort_spilled(fl);
+    }
+}
 
-            if (file_compare(a, b) > 0) {
-                /* Swap */
-                mem_copy_far(&temp, a, sizeof(FileEntry));
-                mem_copy_far(a, b, sizeof(FileEntry));
-                mem_copy_far(b, &temp, sizeof(FileEntry));
-            }
+/*---------------------------------------------------------------------------
+ * resize_list - Reallocate a file list for capacity entries
+ *---------------------------------------------------------------------------*/
+static bool_t resize_list(FileList *fl, uint16_t capacity)
+{
+    uint16_t keep = (fl->count < fl->capacity) ? fl->count : fl->capacity;
+    uint32_t used = (uint32_t)keep * sizeof(FileEntry);
+    FileEntry __far *entries;
+
+    entries = (FileEntry __far *)mem_realloc(fl->entries, used,
+                                             (uint32_t)capacity * sizeof(FileEntry));
+    if (entries == (FileEntry __far *)0) {
+        return FALSE;
+    }
+    fl->entries = entries;
+    fl->capacity = capacity;
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * grow_list - Double a full file list, up to FILES_PER_PANEL_MAX
+ *---------------------------------------------------------------------------*/
+static bool_t grow_list(FileList *fl, uint16_t count)
+{
+    uint16_t capacity = fl->capacity * 2;
+
+    if (fl->capacity >= FILES_PER_PANEL_MAX) {
+        return FALSE;
+    }
+    if (capacity > FILES_PER_PANEL_MAX) {
+        capacity = FILES_PER_PANEL_MAX;
+    }
+
+    fl->count = count;
+    return resize_list(fl, capacity);
+}
+
+/*---------------------------------------------------------------------------
+ * new_entry - Slot for entry i while reading a directory
+ *
+ * A full list is doubled; when memory cannot hold that, further entries
+ * go to a swap area sized for the rest of FILES_PER_PANEL_MAX.  NULL when
+ * neither works, which truncates the list.
+ *---------------------------------------------------------------------------*/
+static FileEntry __far *new_entry(FileList *fl, uint16_t i)
+{
+    uint16_t pages;
+
+    if (i < fl->capacity) {
+        return &fl->entries[i];
+    }
+    if (fl->spill.pages == 0) {
+        if (grow_list(fl, i)) {
+            return &fl->entries[i];
         }
+        if (fl->capacity >= FILES_PER_PANEL_MAX) {
+            return (FileEntry __far *)0;
+        }
+        /* Merge state for sort_spilled: a head entry and a position per
+         * run (the memory part and each spilled page) */
+        pages = spill_pages(fl);
+        fl->heads = (FileEntry __far *)mem_alloc((uint32_t)(pages + 1) *
+                        (sizeof(FileEntry) + sizeof(uint16_t)), MEM_TAG_PANEL);
+        if (fl->heads == (FileEntry __far *)0) {
+            return (FileEntry __far *)0;
+        }
+        if (!swap_open(&fl->spill, pages + SORT_PAGES)) {
+            mem_free(fl->heads);
+            fl->heads = (FileEntry __far *)0;
+            return (FileEntry __far *)0;
+        }
+    }
+    if (i >= FILES_PER_PANEL_MAX) {
+        return (FileEntry __far *)0;
+    }
+    return list_entry(fl, i, TRUE);
+}
+
+/*---------------------------------------------------------------------------
+ * shrink_list - Give back a grown list once a directory uses a quarter
+ * of it (halving, never below the tier's size)
+ *---------------------------------------------------------------------------*/
+static void shrink_list(FileList *fl)
+{
+    uint16_t base = mem_get_files_per_panel();
+    uint16_t capacity = fl->capacity;
+
+    /* Spill pages are only kept while the directory needs them */
+    if (fl->spill.pages != 0) {
+        if (fl->count > capacity) {
+            return;
+        }
+        swap_close(&fl->spill);
+        mem_free(fl->heads);
+        fl->heads = (FileEntry __far *)0;
+    }
+
+    if (fl->count >= capacity / 4) {
+        return;
+    }
+    while (capacity / 2 >= base && capacity / 2 >= fl->count * 2) {
+        capacity /= 2;
+    }
+    if (capacity < fl->capacity) {
+        resize_list(fl, capacity);
     }
 }
 
@@ -127,9 +316,11 @@ bool_t panel_init(Panel *p, uint16_t capacity)
     p->top = 0;
     p->cursor = 0;
     p->sel_count = 0;
+    p->files.spill.pages = 0;
+    p->files.heads = (FileEntry __far *)0;
 
     bytes = (uint32_t)capacity * sizeof(FileEntry);
-    p->files.entries = (FileEntry __far *)mem_alloc(bytes);
+    p->files.entries = (FileEntry __far *)mem_alloc(bytes, MEM_TAG_PANEL);
 
     if (p->files.entries == (FileEntry __far *)0) {
         p->files.capacity = 0;
@@ -150,6 +341,11 @@ bool_t panel_init(Panel *p, uint16_t capacity)
  *---------------------------------------------------------------------------*/
 void panel_free(Panel *p)
 {
+    swap_close(&p->files.spill);
+    if (p->files.heads != (FileEntry __far *)0) {
+        mem_free(p->files.heads);
+        p->files.heads = (FileEntry __far *)0;
+    }
     if (p->files.entries != (FileEntry __far *)0) {
         mem_free(p->files.entries);
         p->files.entries = (FileEntry __far *)0;
@@ -233,9 +429,10 @@ void panel_switch(void)
 int panel_read_dir(Panel *p)
 {
     char pattern[80];
+    DirEnum dir;
+    DTA *found;
     FileEntry __far *entry;
     uint16_t count = 0;
-    int result;
 
     /* Show loading indicator */
     ui_status("Reading directory...");
@@ -255,9 +452,6 @@ int panel_read_dir(Panel *p)
 
     path_append(pattern, "*.*");
 
-    /* Set DTA */
-    set_dta(&g_dta);
-
     /* Clear file list */
     p->files.count = 0;
     p->files.truncated = FALSE;
@@ -276,41 +470,32 @@ int panel_read_dir(Panel *p)
         count++;
     }
 
-    /* Find first file */
-    result = find_first(pattern, DOS_ATTR_DIRECTORY | DOS_ATTR_HIDDEN | DOS_ATTR_SYSTEM);
+    /* "." and ".." are skipped by the enumerator; ".." was added above */
+    dir_open(&dir, pattern, DOS_ATTR_DIRECTORY | DOS_ATTR_HIDDEN | DOS_ATTR_SYSTEM);
 
-    while (result == 0 && count < p->files.capacity) {
-        /* Skip "." entry */
-        if (g_dta.name[0] == '.' && g_dta.name[1] == '\0') {
-            result = find_next();
-            continue;
-        }
-
-        /* Skip ".." - we add it manually */
-        if (g_dta.name[0] == '.' && g_dta.name[1] == '.' && g_dta.name[2] == '\0') {
-            result = find_next();
-            continue;
+    while ((found = dir_next(&dir)) != (DTA *)0) {
+        /* Out of slots: grow or spill the list, or stop and mark it
+         * truncated */
+        entry = new_entry(&p->files, count);
+        if (entry == (FileEntry __far *)0) {
+            p->files.truncated = TRUE;
+            break;
         }
 
         /* Copy entry */
-        entry = &p->files.entries[count];
-        entry->attr = g_dta.attr;
-        entry->time = g_dta.time;
-        entry->date = g_dta.date;
-        entry->size = g_dta.size;
-        str_copy_n(entry->name, g_dta.name, 13);
+        entry->attr = found->attr;
+        entry->time = found->time;
+        entry->date = found->date;
+        entry->size = found->size;
+        str_copy_n(entry->name, found->name, 13);
         entry->selected = 0;
 
         count++;
-        result = find_next();
-    }
-
-    /* Check if truncated */
-    if (result == 0) {
-        p->files.truncated = TRUE;
     }
+    dir_close(&dir);
 
     p->files.count = count;
+    shrink_list(&p->files);
 
     /* Sort files */
     sort_files(&p->files);
@@ -409,7 +594,7 @@ FileEntry __far *panel_get_cursor_file(Panel *p)
     if (p->cursor >= p->files.count) {
         return (FileEntry __far *)0;
     }
-    return &p->files.entries[p->cursor];
+    return list_entry(&p->files, p->cursor, FALSE);
 }
 
 /*---------------------------------------------------------------------------
@@ -420,7 +605,24 @@ FileEntry __far *panel_get_file(Panel *p, uint16_t index)
     if (index >= p->files.count) {
         return (FileEntry __far *)0;
     }
-    return &p->files.entries[index];
+    return list_entry(&p->files, index, FALSE);
+}
+
+/*---------------------------------------------------------------------------
+ * panel_select_file - Mark a file selected
+ *---------------------------------------------------------------------------*/
+void panel_select_file(Panel *p, uint16_t index)
+{
+    FileEntry __far *f;
+
+    if (index >= p->files.count) {
+        return;
+    }
+    f = list_entry(&p->files, index, TRUE);
+    if (f != (FileEntry __far *)0 && !f->selected) {
+        f->selected = 1;
+        p->sel_count++;
+    }
 }
 
 /*---------------------------------------------------------------------------
@@ -428,8 +630,10 @@ FileEntry __far *panel_get_file(Panel *p, uint16_t index)
  *---------------------------------------------------------------------------*/
 void panel_toggle_selection(Panel *p)
 {
-    FileEntry __far *f = panel_get_cursor_file(p);
+    FileEntry __far *f;
 
+    if (p->cursor >= p->files.count) return;
+    f = list_entry(&p->files, p->cursor, TRUE);
     if (f == (FileEntry __far *)0) return;
 
     /* Don't allow selecting ".." */
@@ -449,10 +653,18 @@ void panel_toggle_selection(Panel *p)
  *---------------------------------------------------------------------------*/
 void panel_clear_selection(Panel *p)
 {
+    FileEntry __far *f;
     uint16_t i;
 
+    /* Only pages holding a selection are rewritten */
     for (i = 0; i < p->files.count; i++) {
-        p->files.entries[i].selected = 0;
+        f = list_entry(&p->files, i, FALSE);
+        if (f != (FileEntry __far *)0 && f->selected) {
+            f = list_entry(&p->files, i, TRUE);
+            if (f != (FileEntry __far *)0) {
+                f->selected = 0;
+            }
+        }
     }
     p->sel_count = 0;
 }
@@ -7,6 +7,7 @@
 #define PANEL_H
 
 #include "igc.h"
+#include "swap.h"
 
 /*---------------------------------------------------------------------------
  * File Entry Structure (24 bytes)
@@ -23,14 +24,20 @@ typedef struct {
 
 #define FILE_ENTRY_SIZE 24
 
+#define FILES_PER_SWAP_PAGE (SWAP_PAGE / sizeof(FileEntry))
+
 /*---------------------------------------------------------------------------
  * File List Structure (dynamic array)
+ * Entries past capacity, when memory ran out, are spilled to swap pages;
+ * reach entries through panel_get_file() rather than indexing entries.
  *---------------------------------------------------------------------------*/
 typedef struct {
     FileEntry __far *entries;   /* Far pointer to file array */
     uint16_t capacity;          /* Allocated slots */
     uint16_t count;             /* Actual files */
     bool_t   truncated;         /* TRUE if more files exist than capacity */
+    SwapArea spill;             /* Entries from capacity on (pages 0 = none) */
+    FileEntry __far *heads;     /* Merge state for sorting while spilled */
 } FileList;
 
 /*---------------------------------------------------------------------------
@@ -107,12 +114,16 @@ int panel_set_drive(Panel *p, uint8_t drive);
  * Cursor/Selection Operations
  *---------------------------------------------------------------------------*/
 
-/* Get file at cursor */
+/* Get file at cursor, for reading only */
 FileEntry __far *panel_get_cursor_file(Panel *p);
 
-/* Get file by index */
+/* Get file by index, for reading only (a spilled entry stays valid until
+ * SWAP_FRAMES other swap pages have been touched) */
 FileEntry __far *panel_get_file(Panel *p, uint16_t index);
 
+/* Mark file by index as selected */
+void panel_select_file(Panel *p, uint16_t index);
+
 /* Toggle selection of file at cursor */
 void panel_toggle_selection(Panel *p);
 
@@ -452,6 +452,32 @@ void scr_restore_rect(uint8_t x, uint8_t y, uint8_t w, uint8_t h,
     }
 }
 
+/*---------------------------------------------------------------------------
+ * scr_scroll_rect - Move rectangle contents up (n > 0) or down (n < 0)
+ * The n rows uncovered keep their old contents; the caller redraws them.
+ *---------------------------------------------------------------------------*/
+void scr_scroll_rect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, int8_t n)
+{
+    uint8_t shift = (n < 0) ? (uint8_t)-n : (uint8_t)n;
+    uint8_t row, col;
+    uint8_t dst_row;
+    uint16_t dst, src;
+
+    if (shift == 0 || shift >= h || y + h > SCR_ROWS) return;
+    if (x + w > SCR_COLS) w = SCR_COLS - x;
+
+    /* Copy in the direction that does not overwrite unread rows */
+    for (row = 0; row < h - shift; row++) {
+        dst_row = (n > 0) ? y + row : y + h - 1 - row;
+        dst = line_offset[dst_row] + x;
+        src = (n > 0) ? line_offset[dst_row + shift] + x
+                      : line_offset[dst_row - shift] + x;
+        for (col = 0; col < w; col++) {
+            g_vram[dst++] = g_vram[src++];
+        }
+    }
+}
+
 /*---------------------------------------------------------------------------
  * scr_put_uint16 - Write unsigned 16-bit number
  *---------------------------------------------------------------------------*/
@@ -115,6 +115,9 @@ void scr_hline(uint8_t x, uint8_t y, uint8_t len, char c, uint8_t attr);
 /* Draw vertical line */
 void scr_vline(uint8_t x, uint8_t y, uint8_t len, char c, uint8_t attr);
 
+/* Move rectangle contents up (n > 0) or down (n < 0) by n rows */
+void scr_scroll_rect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, int8_t n);
+
 /*---------------------------------------------------------------------------
  * Save/Restore (for dialogs)
  *---------------------------------------------------------------------------*/
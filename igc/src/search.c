@@ -0,0 +1,317 @@
+/*
+ * search.c - IGC Text Search Implementation
+ *
+ * Boyer-Moore-Horspool: the pattern is compared from its far end, and on
+ * a mismatch it slides by the shift for the byte under that end, usually
+ * the whole pattern length.  Most of the text is never compared at all.
+ * Sources larger than one read are scanned in SEARCH_CHUNK pieces that
+ * overlap by len - 1 bytes, so matches across a boundary are not missed.
+ */
+
+#include "search.h"
+#include "keyboard.h"
+#include "mem.h"
+#include "util.h"
+
+/*---------------------------------------------------------------------------
+ * Static Variables
+ *---------------------------------------------------------------------------*/
+static uint8_t g_same[256];         /* Identity map */
+static uint8_t g_upper[256];        /* Case folding map */
+static bool_t g_maps_ready = FALSE;
+
+/*---------------------------------------------------------------------------
+ * build_maps - Fill the byte maps (first use)
+ *---------------------------------------------------------------------------*/
+static void build_maps(void)
+{
+    uint16_t c;
+
+    for (c = 0; c < 256; c++) {
+        g_same[c] = (uint8_t)c;
+        g_upper[c] = (uint8_t)char_upper((char)c);
+    }
+    g_maps_ready = TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * search_ignore_case - Ignore case unless the pattern has a capital
+ *---------------------------------------------------------------------------*/
+bool_t search_ignore_case(const char *pat)
+{
+    while (*pat) {
+        if (*pat >= 'A' && *pat <= 'Z') {
+            return FALSE;
+        }
+        pat++;
+    }
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * search_prepare - Build the shift table
+ *
+ * Forward, a byte's shift is its distance from the last pattern byte;
+ * backward, its distance from the first.  With ignore_case the table is
+ * built over folded bytes and looked up through the fold map.
+ *---------------------------------------------------------------------------*/
+bool_t search_prepare(SearchPat *sp, const char *pat, bool_t ignore_case,
+                      bool_t backward)
+{
+    uint8_t shift[256];
+    uint16_t c;
+    uint8_t i;
+    uint16_t len = str_len(pat);
+
+    if (len == 0 || len > SEARCH_MAX) {
+        return FALSE;
+    }
+    if (!g_maps_ready) {
+        build_maps();
+    }
+
+    sp->len = (uint8_t)len;
+    sp->backward = backward;
+    sp->fold = ignore_case ? g_upper : g_same;
+
+    for (i = 0; i < sp->len; i++) {
+        sp->pat[i] = sp->fold[(uint8_t)pat[i]];
+    }
+
+    for (c = 0; c < 256; c++) {
+        shift[c] = sp->len;
+    }
+    if (backward) {
+        for (i = sp->len - 1; i > 0; i--) {
+            shift[sp->pat[i]] = i;
+        }
+    } else {
+        for (i = 0; i + 1 < sp->len; i++) {
+            shift[sp->pat[i]] = sp->len - 1 - i;
+        }
+    }
+
+    for (c = 0; c < 256; c++) {
+        sp->skip[c] = shift[sp->fold[c]];
+    }
+
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * search_block - First (or last) match in a block
+ *---------------------------------------------------------------------------*/
+uint16_t search_block(const SearchPat *sp, const char __far *buf, uint16_t len)
+{
+    const uint8_t __far *p = (const uint8_t __far *)buf;
+    const uint8_t *fold = sp->fold;
+    uint16_t m = sp->len;
+    uint16_t i;
+    uint16_t j;
+
+    if (len < m) {
+        return SEARCH_NONE;
+    }
+
+    if (!sp->backward) {
+        i = 0;
+        while (i <= len - m) {
+            if (fold[p[i + m - 1]] == sp->pat[m - 1]) {
+                for (j = m - 1; j > 0 && fold[p[i + j - 1]] == sp->pat[j - 1]; j--) {
+                }
+                if (j == 0) {
+                    return i;
+                }
+            }
+            i += sp->skip[p[i + m - 1]];
+        }
+    } else {
+        i = len - m;
+        for (;;) {
+            if (fold[p[i]] == sp->pat[0]) {
+                for (j = 1; j < m && fold[p[i + j]] == sp->pat[j]; j++) {
+                }
+                if (j == m) {
+                    return i;
+                }
+            }
+            if (i < sp->skip[p[i]]) {
+                break;
+            }
+            i -= sp->skip[p[i]];
+        }
+    }
+
+    return SEARCH_NONE;
+}
+
+/*---------------------------------------------------------------------------
+ * read_src - Read len bytes at pos from a source
+ *---------------------------------------------------------------------------*/
+static uint16_t read_src(const SearchSrc *src, uint32_t pos, char __far *buf, uint16_t len)
+{
+    int16_t n;
+
+    if (src->tb != (const TextBuf *)0) {
+        return tb_copy_out(src->tb, pos, buf, len);
+    }
+
+    if (dos_seek(src->handle, (int32_t)pos, DOS_SEEK_SET) < 0) {
+        return 0;
+    }
+    n = dos_read(src->handle, buf, len);
+    return (n > 0) ? (uint16_t)n : 0;
+}
+
+/*---------------------------------------------------------------------------
+ * search_range - Match lying wholly within [from, to)
+ *
+ * Forward, pieces are read front to back; backward, back to front.  Each
+ * piece repeats the last (or first) len - 1 bytes of the one before.
+ *---------------------------------------------------------------------------*/
+uint32_t search_range(const SearchPat *sp, const SearchSrc *src,
+                      uint32_t from, uint32_t to)
+{
+    char __far *buf;
+    uint32_t found = SEARCH_NOT_FOUND;
+    uint32_t start;
+    uint16_t want;
+    uint16_t n;
+    uint16_t m;
+
+    if (to < from || to - from < sp->len) {
+        return SEARCH_NOT_FOUND;
+    }
+
+    buf = (char __far *)mem_alloc(SEARCH_CHUNK, MEM_TAG_SEARCH);
+    if (buf == (char __far *)0) {
+        return SEARCH_NOT_FOUND;
+    }
+
+    for (;;) {
+        if (!sp->backward) {
+            start = from;
+            want = (to - from > SEARCH_CHUNK) ? SEARCH_CHUNK : (uint16_t)(to - from);
+        } else {
+            start = (to - from > SEARCH_CHUNK) ? to - SEARCH_CHUNK : from;
+            want = (uint16_t)(to - start);
+        }
+
+        n = read_src(src, start, buf, want);
+        if (n < want) {
+            break;
+        }
+
+        m = search_block(sp, buf, n);
+        if (m != SEARCH_NONE) {
+            found = start + m;
+            break;
+        }
+
+        /* Stop at the end of the range, or when a key is pressed */
+        if (to - from <= SEARCH_CHUNK) {
+            break;
+        }
+        if (src->tb == (const TextBuf *)0 && kbd_check()) {
+            break;
+        }
+
+        if (!sp->backward) {
+            from += n - (sp->len - 1);
+        } else {
+            to = start + sp->len - 1;
+        }
+    }
+
+    mem_free(buf);
+    return found;
+}
+
+/*---------------------------------------------------------------------------
+ * replace_pass - Walk the text replacing matches
+ *
+ * With write FALSE only counts matches and the new length.  With write
+ * TRUE the gap must be at 0: the text then sits at the top of storage
+ * and the result is written from the bottom up.  The output runs ahead
+ * of the input by at most the total growth, which fits in the gap, so it
+ * never overwrites text that has not been read yet.  A lost swap page
+ * (tb_failed) ends the pass.
+ *---------------------------------------------------------------------------*/
+static uint32_t replace_pass(TextBuf *tb, const SearchPat *sp, const char *repl,
+                             uint16_t rlen, char __far *buf, bool_t write,
+                             uint32_t *new_len)
+{
+    uint32_t text_len = tb_length(tb);
+    uint32_t pos = 0;
+    uint32_t out = 0;
+    uint32_t count = 0;
+    uint16_t n;
+    uint16_t off;
+    uint16_t m;
+    uint16_t keep;
+
+    while (pos < text_len) {
+        n = tb_copy_out(tb, pos, buf, SEARCH_CHUNK);
+        if (tb_failed(tb)) {
+            break;
+        }
+        off = 0;
+
+        for (;;) {
+            m = search_block(sp, buf + off, n - off);
+            if (m == SEARCH_NONE) {
+                break;
+            }
+            if (write) {
+                tb_write(tb, out, buf + off, m);
+                tb_write(tb, out + m, repl, rlen);
+            }
+            out += (uint32_t)m + rlen;
+            off += m + sp->len;
+            count++;
+        }
+
+        /* A match may start in the last len - 1 bytes: leave them */
+        keep = (pos + n < text_len) ? sp->len - 1 : 0;
+        if (n - keep > off) {
+            if (write) {
+                tb_write(tb, out, buf + off, n - keep - off);
+            }
+            out += n - keep - off;
+            off = n - keep;
+        }
+        pos += off;
+    }
+
+    *new_len = out;
+    return count;
+}
+
+/*---------------------------------------------------------------------------
+ * search_replace_all - Replace every match in one linear pass
+ *---------------------------------------------------------------------------*/
+uint32_t search_replace_all(TextBuf *tb, const SearchPat *sp,
+                            const char *repl, uint16_t rlen)
+{
+    char __far *buf;
+    uint32_t count;
+    uint32_t new_len;
+
+    buf = (char __far *)mem_alloc(SEARCH_CHUNK, MEM_TAG_SEARCH);
+    if (buf == (char __far *)0) {
+        return SEARCH_NOT_FOUND;
+    }
+
+    count = replace_pass(tb, sp, repl, rlen, buf, FALSE, &new_len);
+    if (new_len > tb->size) {
+        count = SEARCH_NOT_FOUND;
+    } else if (count > 0) {
+        tb_move_gap(tb, 0);
+        replace_pass(tb, sp, repl, rlen, buf, TRUE, &new_len);
+        tb->gap_start = new_len;
+        tb->gap_end = tb->size;
+    }
+
+    mem_free(buf);
+    return count;
+}
@@ -0,0 +1,71 @@
+/*
+ * search.h - IGC Text Search
+ * Boyer-Moore-Horspool search over far buffers, text buffers and files
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "igc.h"
+#include "textbuf.h"
+#include "dosapi.h"
+
+/*---------------------------------------------------------------------------
+ * Limits
+ *---------------------------------------------------------------------------*/
+#define SEARCH_MAX        40        /* Longest pattern */
+#define SEARCH_CHUNK      8192      /* Bytes scanned per read */
+
+#define SEARCH_NONE       0xFFFF        /* No match in a block */
+#define SEARCH_NOT_FOUND  0xFFFFFFFFUL  /* No match in a range */
+
+/*---------------------------------------------------------------------------
+ * Prepared Pattern
+ * skip[c] is how far the pattern may slide when byte c is under its last
+ * (forward) or first (backward) character.
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    uint8_t  pat[SEARCH_MAX];       /* Pattern (upper case if ignore_case) */
+    uint8_t  len;                   /* Pattern length */
+    bool_t   backward;              /* Find the last match, not the first */
+    const uint8_t *fold;            /* Byte map applied before comparing */
+    uint8_t  skip[256];             /* Horspool shift table */
+} SearchPat;
+
+/*---------------------------------------------------------------------------
+ * Source to search: a text buffer, or an open file when tb is NULL
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    const TextBuf *tb;
+    dos_handle_t handle;
+} SearchSrc;
+
+/*---------------------------------------------------------------------------
+ * Searching
+ *---------------------------------------------------------------------------*/
+
+/* Case rule for typed patterns: ignore case unless one is upper case */
+bool_t search_ignore_case(const char *pat);
+
+/* Build the shift table; returns FALSE for an empty or too long pattern */
+bool_t search_prepare(SearchPat *sp, const char *pat, bool_t ignore_case,
+                      bool_t backward);
+
+/* First (or last, if backward) match in a block, SEARCH_NONE if none */
+uint16_t search_block(const SearchPat *sp, const char __far *buf, uint16_t len);
+
+/* Match lying wholly within [from, to), SEARCH_NOT_FOUND if none;
+ * a key press stops a file search */
+uint32_t search_range(const SearchPat *sp, const SearchSrc *src,
+                      uint32_t from, uint32_t to);
+
+/*---------------------------------------------------------------------------
+ * Replacing
+ *---------------------------------------------------------------------------*/
+
+/* Replace every match (forward pattern) in one pass over the buffer;
+ * returns the count, or SEARCH_NOT_FOUND if the result would not fit */
+uint32_t search_replace_all(TextBuf *tb, const SearchPat *sp,
+                            const char *repl, uint16_t rlen);
+
+#endif /* SEARCH_H */
@@ -0,0 +1,351 @@
+/*
+ * swap.c - IGC Swap File Implementation
+ *
+ * IGC.SWP is created in the root of the swap drive when the first area
+ * is opened and deleted when the last one closes, so a machine that never
+ * runs short of memory never touches it.  Areas are laid out first-fit
+ * in the file; a page is only written when it is evicted dirty, so the
+ * file grows no further than the pages actually used.
+ *
+ * SWAP_FRAMES pages are held in memory.  A miss evicts the least
+ * recently used frame, writing it back if it was changed.
+ */
+
+#include "swap.h"
+#include "mem.h"
+#include "dosapi.h"
+#include "util.h"
+
+/*---------------------------------------------------------------------------
+ * Resident page
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    uint16_t page;              /* Page in the file, or SWAP_NO_PAGE */
+    uint16_t used;              /* Clock value at last access */
+    bool_t   dirty;             /* Changed since it was read */
+} SwapFrame;
+
+/*---------------------------------------------------------------------------
+ * Static variables
+ *---------------------------------------------------------------------------*/
+static const char *SWAP_FILE = "IGC.SWP";
+
+static uint8_t g_swap_drive = 0;
+static char g_swap_path[16];
+static dos_handle_t g_swap_h = -1;
+static char __far *g_frame_buf = (char __far *)0;
+static SwapFrame g_frames[SWAP_FRAMES];
+static uint16_t g_clock = 0;
+static SwapArea *g_areas[SWAP_AREAS];
+
+/*---------------------------------------------------------------------------
+ * swap_set_drive - Set the drive for IGC.SWP
+ *---------------------------------------------------------------------------*/
+void swap_set_drive(uint8_t drive)
+{
+    g_swap_drive = (drive <= MAX_DRIVE) ? drive : 0;
+}
+
+/*---------------------------------------------------------------------------
+ * swap_get_drive - Drive set for IGC.SWP
+ *---------------------------------------------------------------------------*/
+uint8_t swap_get_drive(void)
+{
+    return g_swap_drive;
+}
+
+/*---------------------------------------------------------------------------
+ * swap_home_path - Path of one of IGC's files on a drive that stays put
+ *
+ * The swap drive was picked by the user as somewhere to write; failing
+ * that, IGC's directory (DOS 3+ only) at least does not follow the cwd
+ * onto whatever floppy is being browsed.
+ *---------------------------------------------------------------------------*/
+bool_t swap_home_path(uint8_t place, const char *name, char *path, uint16_t size)
+{
+    if (place == 0) {
+        if (g_swap_drive == 0) {
+            return FALSE;
+        }
+        path[0] = 'A' + g_swap_drive - 1;
+        path[1] = ':';
+        path[2] = '\\';
+        path[3] = '\0';
+    } else if (place != 1 ||
+               !dos_get_prog_dir(path, size - str_len(name))) {
+        return FALSE;
+    }
+
+    str_copy(path + str_len(path), name);
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * swap_start - Create IGC.SWP and the resident frames
+ *---------------------------------------------------------------------------*/
+static bool_t swap_start(void)
+{
+    uint8_t i;
+
+    if (g_swap_h >= 0) {
+        return TRUE;
+    }
+    if (g_swap_drive == 0) {
+        return FALSE;
+    }
+
+    g_frame_buf = (char __far *)mem_alloc((uint32_t)SWAP_FRAMES * SWAP_PAGE,
+                                          MEM_TAG_SWAP);
+    if (g_frame_buf == (char __far *)0) {
+        return FALSE;
+    }
+
+    g_swap_path[0] = 'A' + g_swap_drive - 1;
+    g_swap_path[1] = ':';
+    g_swap_path[2] = '\\';
+    str_copy(&g_swap_path[3], SWAP_FILE);
+
+    g_swap_h = dos_create(g_swap_path, 0);
+    if (g_swap_h < 0) {
+        mem_free(g_frame_buf);
+        g_frame_buf = (char __far *)0;
+        return FALSE;
+    }
+
+    for (i = 0; i < SWAP_FRAMES; i++) {
+        g_frames[i].page = SWAP_NO_PAGE;
+        g_frames[i].used = 0;
+        g_frames[i].dirty = FALSE;
+    }
+    g_clock = 0;
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * swap_shutdown - Close and delete IGC.SWP
+ *---------------------------------------------------------------------------*/
+void swap_shutdown(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < SWAP_AREAS; i++) {
+        if (g_areas[i] != (SwapArea *)0) {
+            g_areas[i]->pages = 0;
+            g_areas[i] = (SwapArea *)0;
+        }
+    }
+
+    if (g_swap_h >= 0) {
+        dos_close(g_swap_h);
+        dos_delete(g_swap_path);
+        g_swap_h = -1;
+    }
+    if (g_frame_buf != (char __far *)0) {
+        mem_free(g_frame_buf);
+        g_frame_buf = (char __far *)0;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * overlaps - TRUE if pages [base, base+pages) meet an open area
+ *---------------------------------------------------------------------------*/
+static bool_t overlaps(uint16_t base, uint16_t pages)
+{
+    uint8_t i;
+    SwapArea *a;
+
+    for (i = 0; i < SWAP_AREAS; i++) {
+        a = g_areas[i];
+        if (a != (SwapArea *)0 &&
+            base < a->base + a->pages && a->base < base + pages) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * swap_open - Reserve pages in IGC.SWP
+ *
+ * The lowest free run is found by trying page 0 and the end of each open
+ * area in turn.
+ *---------------------------------------------------------------------------*/
+bool_t swap_open(SwapArea *area, uint16_t pages)
+{
+    uint8_t slot = SWAP_AREAS;
+    uint8_t i;
+    uint16_t base;
+    uint16_t best = SWAP_NO_PAGE;
+
+    area->pages = 0;
+    area->failed = FALSE;
+    if (pages == 0 || !swap_start()) {
+        return FALSE;
+    }
+
+    for (i = 0; i < SWAP_AREAS; i++) {
+        if (g_areas[i] == (SwapArea *)0) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == SWAP_AREAS) {
+        return FALSE;
+    }
+
+    if (!overlaps(0, pages)) {
+        best = 0;
+    }
+    for (i = 0; i < SWAP_AREAS; i++) {
+        if (g_areas[i] == (SwapArea *)0) {
+            continue;
+        }
+        base = g_areas[i]->base + g_areas[i]->pages;
+        if (base < best && (uint32_t)base + pages < SWAP_NO_PAGE &&
+            !overlaps(base, pages)) {
+            best = base;
+        }
+    }
+    if (best == SWAP_NO_PAGE) {
+        return FALSE;
+    }
+
+    area->base = best;
+    area->pages = pages;
+    g_areas[slot] = area;
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * swap_close - Discard an area's pages
+ *---------------------------------------------------------------------------*/
+void swap_close(SwapArea *area)
+{
+    uint8_t i;
+    bool_t any = FALSE;
+
+    if (area->pages == 0) {
+        return;
+    }
+
+    /* Resident copies are dropped without writing them back */
+    for (i = 0; i < SWAP_FRAMES; i++) {
+        if (g_frames[i].page != SWAP_NO_PAGE &&
+            g_frames[i].page >= area->base &&
+            g_frames[i].page < area->base + area->pages) {
+            g_frames[i].page = SWAP_NO_PAGE;
+            g_frames[i].dirty = FALSE;
+        }
+    }
+
+    for (i = 0; i < SWAP_AREAS; i++) {
+        if (g_areas[i] == area) {
+            g_areas[i] = (SwapArea *)0;
+        } else if (g_areas[i] != (SwapArea *)0) {
+            any = TRUE;
+        }
+    }
+    area->pages = 0;
+
+    /* Last area gone: give the frames and the disk space back */
+    if (!any) {
+        swap_shutdown();
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * write_frame - Write a dirty frame back to its page
+ *---------------------------------------------------------------------------*/
+static bool_t write_frame(uint8_t i)
+{
+    int32_t at = (int32_t)g_frames[i].page * SWAP_PAGE;
+
+    if (dos_seek(g_swap_h, at, DOS_SEEK_SET) != at) {
+        return FALSE;
+    }
+    if (dos_write(g_swap_h, g_frame_buf + i * SWAP_PAGE, SWAP_PAGE) !=
+        SWAP_PAGE) {
+        return FALSE;
+    }
+    g_frames[i].dirty = FALSE;
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * restart_clock - Renumber the frames 1..SWAP_FRAMES in the same order
+ * when the clock wraps, so the most recent page is still the newest
+ *---------------------------------------------------------------------------*/
+static void restart_clock(void)
+{
+    uint16_t rank[SWAP_FRAMES];
+    uint8_t i, j;
+
+    for (i = 0; i < SWAP_FRAMES; i++) {
+        rank[i] = 1;
+        for (j = 0; j < SWAP_FRAMES; j++) {
+            if (g_frames[j].used < g_frames[i].used) {
+                rank[i]++;
+            }
+        }
+    }
+    for (i = 0; i < SWAP_FRAMES; i++) {
+        g_frames[i].used = rank[i];
+    }
+    g_clock = SWAP_FRAMES + 1;
+}
+
+/*---------------------------------------------------------------------------
+ * swap_page - Make a page resident and return its frame
+ *
+ * A page past the end of the file was never written: the read comes back
+ * short and the frame just keeps whatever it held.
+ *---------------------------------------------------------------------------*/
+char __far *swap_page(SwapArea *area, uint16_t page, bool_t dirty)
+{
+    uint16_t want;
+    uint8_t i;
+    uint8_t victim = 0;
+    int32_t at;
+
+    if (page >= area->pages) {
+        return (char __far *)0;
+    }
+    want = area->base + page;
+
+    if (++g_clock == 0) {
+        restart_clock();
+    }
+
+    for (i = 0; i < SWAP_FRAMES; i++) {
+        if (g_frames[i].page == want) {
+            g_frames[i].used = g_clock;
+            if (dirty) {
+                g_frames[i].dirty = TRUE;
+            }
+            return g_frame_buf + i * SWAP_PAGE;
+        }
+        if (g_frames[i].page == SWAP_NO_PAGE ||
+            (g_frames[victim].page != SWAP_NO_PAGE &&
+             g_frames[i].used < g_frames[victim].used)) {
+            victim = i;
+        }
+    }
+
+    if (g_frames[victim].dirty && !write_frame(victim)) {
+        area->failed = TRUE;
+        return (char __far *)0;
+    }
+
+    g_frames[victim].page = SWAP_NO_PAGE;
+    at = (int32_t)want * SWAP_PAGE;
+    if (dos_seek(g_swap_h, at, DOS_SEEK_SET) != at ||
+        dos_read(g_swap_h, g_frame_buf + victim * SWAP_PAGE, SWAP_PAGE) < 0) {
+        area->failed = TRUE;
+        return (char __far *)0;
+    }
+
+    g_frames[victim].page = want;
+    g_frames[victim].used = g_clock;
+    g_frames[victim].dirty = dirty;
+    return g_frame_buf + victim * SWAP_PAGE;
+}
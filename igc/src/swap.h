@@ -0,0 +1,68 @@
+/*
+ * swap.h - IGC Swap File
+ * Pages of cold data kept in IGC.SWP, a few of them resident at a time
+ */
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "igc.h"
+
+/*---------------------------------------------------------------------------
+ * Sizes
+ *---------------------------------------------------------------------------*/
+#define SWAP_PAGE       1024        /* Bytes per page */
+#define SWAP_FRAMES     4           /* Pages resident in memory */
+#define SWAP_AREAS      4           /* Areas open at once */
+#define SWAP_NO_PAGE    0xFFFF      /* Frame holds no page */
+
+/*---------------------------------------------------------------------------
+ * Swap Area
+ * A run of pages in IGC.SWP owned by one client.  Pages are numbered
+ * from 0 within the area; their contents are undefined until written.
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    uint16_t base;              /* First page in the file */
+    uint16_t pages;             /* Pages in the area (0 = closed) */
+    bool_t failed;              /* A page could not be read or written back */
+} SwapArea;
+
+/*---------------------------------------------------------------------------
+ * Setup
+ *---------------------------------------------------------------------------*/
+
+/* Set the drive for IGC.SWP (1 = A:, 0 = no swapping) */
+void swap_set_drive(uint8_t drive);
+
+/* Drive set for IGC.SWP (1 = A:, 0 = none) */
+uint8_t swap_get_drive(void);
+
+/* Places for IGC's other files (journal, log), best first: the root of
+ * the swap drive, then IGC's own directory */
+#define SWAP_HOME_PLACES    2
+
+/* Full path of name at a place (0 .. SWAP_HOME_PLACES-1) into path (size
+ * bytes); FALSE if that place is not known */
+bool_t swap_home_path(uint8_t place, const char *name, char *path, uint16_t size);
+
+/* Close and delete IGC.SWP (program exit) */
+void swap_shutdown(void);
+
+/*---------------------------------------------------------------------------
+ * Areas
+ *---------------------------------------------------------------------------*/
+
+/* Reserve pages in IGC.SWP, creating the file on first use; FALSE if no
+ * swap drive is set or the file cannot be made */
+bool_t swap_open(SwapArea *area, uint16_t pages);
+
+/* Discard an area's pages; the file is deleted when no area is open */
+void swap_close(SwapArea *area);
+
+/* Far pointer to a page of an area, reading it in if needed.  Valid for
+ * SWAP_PAGE bytes until SWAP_FRAMES other pages have been touched.  Set
+ * dirty if the page will be written.  NULL on a disk error, which also
+ * sets the area's failed flag until it is closed. */
+char __far *swap_page(SwapArea *area, uint16_t page, bool_t dirty);
+
+#endif /* SWAP_H */
@@ -0,0 +1,554 @@
+/*
+ * textbuf.c - IGC Gap Buffer and Line Index Implementation
+ *
+ * Typing at one spot only ever touches the gap, so it costs O(1); moving
+ * the edit point costs one block move of the text between the old and
+ * the new position, not of the whole file.  The line index is patched
+ * for each edit instead of being rebuilt from the text.
+ *
+ * The storage may be larger than one 64KB segment.  Physical offsets are
+ * 32-bit and turned into a normalized far pointer (segment advanced by
+ * offset / 16) on each access, so reaching text at the end of the buffer
+ * costs the same as at the start.  Block copies are done in TB_STEP
+ * pieces so no single copy runs off the end of a segment.
+ *
+ * A spilled buffer lives in swap pages (see swap.c) instead.  Every
+ * access then goes through swap_page(), and copies are cut at page
+ * boundaries so each piece lies in one resident frame.
+ */
+
+#include <i86.h>
+#include "textbuf.h"
+#include "util.h"
+
+#define TB_STEP     16384       /* Largest single block copy */
+
+/*---------------------------------------------------------------------------
+ * tb_ptr - Far pointer to a physical offset; dirty marks a swap page
+ * for writing back.  NULL if the swap file lost the page (the area is
+ * then marked failed, see tb_failed).
+ *---------------------------------------------------------------------------*/
+static char __far *tb_ptr(const TextBuf *tb, uint32_t phys, bool_t dirty)
+{
+    char __far *page;
+
+    if (tb->swap != (SwapArea *)0) {
+        page = swap_page(tb->swap, (uint16_t)(phys / SWAP_PAGE), dirty);
+        if (page == (char __far *)0) {
+            return (char __far *)0;
+        }
+        return page + (uint16_t)(phys % SWAP_PAGE);
+    }
+
+    phys += FP_OFF(tb->data);
+    return (char __far *)MK_FP(FP_SEG(tb->data) + (uint16_t)(phys >> 4),
+                               (uint16_t)phys & 15);
+}
+
+/*---------------------------------------------------------------------------
+ * tb_addr - Far pointer to a physical offset in the storage
+ *---------------------------------------------------------------------------*/
+char __far *tb_addr(const TextBuf *tb, uint32_t phys)
+{
+    return tb_ptr(tb, phys, TRUE);
+}
+
+/*---------------------------------------------------------------------------
+ * tb_span - Bytes reachable from tb_addr(phys) in one piece
+ *---------------------------------------------------------------------------*/
+uint16_t tb_span(const TextBuf *tb, uint32_t phys)
+{
+    if (tb->swap != (SwapArea *)0) {
+        return SWAP_PAGE - (uint16_t)(phys % SWAP_PAGE);
+    }
+    return TB_STEP;
+}
+
+/*---------------------------------------------------------------------------
+ * tb_write - Copy bytes into the storage at a physical offset
+ *---------------------------------------------------------------------------*/
+bool_t tb_write(TextBuf *tb, uint32_t phys, const char __far *src, uint16_t len)
+{
+    char __far *p;
+    uint16_t step;
+
+    while (len > 0) {
+        step = tb_span(tb, phys);
+        if (step > len) {
+            step = len;
+        }
+        p = tb_ptr(tb, phys, TRUE);
+        if (p == (char __far *)0) {
+            return FALSE;
+        }
+        mem_copy_far(p, src, step);
+        phys += step;
+        src += step;
+        len -= step;
+    }
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * tb_phys - Physical offset of a logical position
+ *---------------------------------------------------------------------------*/
+static uint32_t tb_phys(const TextBuf *tb, uint32_t pos)
+{
+    return (pos < tb->gap_start) ? pos : pos + (tb->gap_end - tb->gap_start);
+}
+
+/*---------------------------------------------------------------------------
+ * move_paged - Move n physical bytes of a spilled buffer (may overlap)
+ *
+ * Each piece ends at the next page boundary of both source and target,
+ * so it is one copy between two frames or within one.  The source is
+ * touched first; mapping the target then cannot evict it.  A lost page
+ * ends the move; the area is failed by then.
+ *---------------------------------------------------------------------------*/
+static void move_paged(TextBuf *tb, uint32_t dst, uint32_t src, uint32_t n)
+{
+    const char __far *from;
+    char __far *to;
+    uint16_t step;
+    uint16_t room;
+
+    while (n > 0) {
+        if (dst > src) {
+            /* Back to front: pieces end at src + n and dst + n */
+            step = (uint16_t)((src + n - 1) % SWAP_PAGE) + 1;
+            room = (uint16_t)((dst + n - 1) % SWAP_PAGE) + 1;
+            if (room < step) {
+                step = room;
+            }
+            if (n < step) {
+                step = (uint16_t)n;
+            }
+            n -= step;
+            from = tb_ptr(tb, src + n, FALSE);
+            to = tb_ptr(tb, dst + n, TRUE);
+            if (from == (const char __far *)0 || to == (char __far *)0) {
+                return;
+            }
+            mem_move_far(to, from, step);
+        } else {
+            step = SWAP_PAGE - (uint16_t)(src % SWAP_PAGE);
+            room = SWAP_PAGE - (uint16_t)(dst % SWAP_PAGE);
+            if (room < step) {
+                step = room;
+            }
+            if (n < step) {
+                step = (uint16_t)n;
+            }
+            from = tb_ptr(tb, src, FALSE);
+            to = tb_ptr(tb, dst, TRUE);
+            if (from == (const char __far *)0 || to == (char __far *)0) {
+                return;
+            }
+            mem_move_far(to, from, step);
+            dst += step;
+            src += step;
+            n -= step;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * move_block - Move n physical bytes from src to dst (may overlap)
+ *
+ * Moving up, the pieces go back to front so the source survives.  When
+ * a piece overlaps its target, both pointers are built on one segment so
+ * mem_move_far sees the overlap and picks the right direction.
+ *---------------------------------------------------------------------------*/
+static void move_block(TextBuf *tb, uint32_t dst, uint32_t src, uint32_t n)
+{
+    uint32_t at_dst;
+    uint32_t at_src;
+    uint32_t lo;
+    char __far *base;
+    uint16_t step;
+
+    if (tb->swap != (SwapArea *)0) {
+        move_paged(tb, dst, src, n);
+        return;
+    }
+
+    while (n > 0) {
+        step = (n > TB_STEP) ? TB_STEP : (uint16_t)n;
+        n -= step;
+        if (dst > src) {
+            at_dst = dst + n;
+            at_src = src + n;
+        } else {
+            at_dst = dst;
+            at_src = src;
+            dst += step;
+            src += step;
+        }
+
+        lo = (at_dst < at_src) ? at_dst : at_src;
+        if ((at_dst > at_src ? at_dst - at_src : at_src - at_dst) < TB_STEP) {
+            base = tb_addr(tb, lo);
+            mem_move_far(base + (uint16_t)(at_dst - lo),
+                         base + (uint16_t)(at_src - lo), step);
+        } else {
+            mem_copy_far(tb_addr(tb, at_dst), tb_addr(tb, at_src), step);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * tb_init - Attach storage
+ *---------------------------------------------------------------------------*/
+void tb_init(TextBuf *tb, char __far *data, uint32_t size)
+{
+    tb->data = data;
+    tb->size = size;
+    tb->swap = (SwapArea *)0;
+    tb_clear(tb);
+}
+
+/*---------------------------------------------------------------------------
+ * tb_clear - Empty the buffer
+ *---------------------------------------------------------------------------*/
+void tb_clear(TextBuf *tb)
+{
+    tb->gap_start = 0;
+    tb->gap_end = tb->size;
+}
+
+/*---------------------------------------------------------------------------
+ * tb_set_length - Text was loaded into data[0..len)
+ *---------------------------------------------------------------------------*/
+void tb_set_length(TextBuf *tb, uint32_t len)
+{
+    tb->gap_start = len;
+    tb->gap_end = tb->size;
+}
+
+/*---------------------------------------------------------------------------
+ * tb_resize - Storage was reallocated (gap already at the end of the text)
+ *---------------------------------------------------------------------------*/
+void tb_resize(TextBuf *tb, char __far *data, uint32_t size)
+{
+    tb->data = data;
+    tb->size = size;
+    tb->gap_end = size;
+}
+
+/*---------------------------------------------------------------------------
+ * tb_spill - Move the text into a swap area
+ *
+ * The gap goes to the end first so the text is one run from offset 0,
+ * which is copied page by page while the storage is still data.
+ *---------------------------------------------------------------------------*/
+bool_t tb_spill(TextBuf *tb, SwapArea *area)
+{
+    uint32_t len = tb_length(tb);
+    uint32_t pos = 0;
+    uint16_t step;
+    char __far *page;
+
+    if (tb->swap != (SwapArea *)0 ||
+        (uint32_t)area->pages * SWAP_PAGE <= len) {
+        return FALSE;
+    }
+
+    tb_move_gap(tb, len);
+    while (pos < len) {
+        step = (len - pos > SWAP_PAGE) ? SWAP_PAGE : (uint16_t)(len - pos);
+        page = swap_page(area, (uint16_t)(pos / SWAP_PAGE), TRUE);
+        if (page == (char __far *)0) {
+            return FALSE;
+        }
+        mem_copy_far(page, tb_addr(tb, pos), step);
+        pos += step;
+    }
+
+    tb->swap = area;
+    tb->size = (uint32_t)area->pages * SWAP_PAGE;
+    tb->gap_end = tb->size;
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * tb_char_at - Character at logical position
+ *---------------------------------------------------------------------------*/
+char tb_char_at(const TextBuf *tb, uint32_t pos)
+{
+    const char __far *p = tb_ptr(tb, tb_phys(tb, pos), FALSE);
+
+    return (p != (const char __far *)0) ? *p : '\0';
+}
+
+/*---------------------------------------------------------------------------
+ * tb_copy_out - Copy logical range out of the buffer
+ *---------------------------------------------------------------------------*/
+uint16_t tb_copy_out(const TextBuf *tb, uint32_t pos, char __far *dst, uint16_t len)
+{
+    uint32_t text_len = tb_length(tb);
+    const char __far *p;
+    uint16_t n;
+    uint16_t done = 0;
+
+    if (pos >= text_len) {
+        return 0;
+    }
+    if ((uint32_t)len > text_len - pos) {
+        len = (uint16_t)(text_len - pos);
+    }
+
+    while (done < len) {
+        p = tb_chunk(tb, pos, &n);
+        if (n == 0) {
+            break;
+        }
+        if (n > len - done) {
+            n = len - done;
+        }
+        mem_copy_far(&dst[done], p, n);
+        done += n;
+        pos += n;
+    }
+
+    return done;
+}
+
+/*---------------------------------------------------------------------------
+ * tb_chunk - Contiguous run of text starting at a logical position
+ *
+ * The run stops at the gap, at the end of the text, or after TB_STEP
+ * bytes (the page end when spilled), whichever comes first.  A lost
+ * page gives an empty run.
+ *---------------------------------------------------------------------------*/
+const char __far *tb_chunk(const TextBuf *tb, uint32_t pos, uint16_t *len)
+{
+    uint32_t phys = tb_phys(tb, pos);
+    uint16_t span = tb_span(tb, phys);
+    uint32_t avail;
+    const char __far *p;
+
+    if (pos >= tb_length(tb)) {
+        avail = 0;
+    } else if (pos < tb->gap_start) {
+        avail = tb->gap_start - pos;
+    } else {
+        avail = tb_length(tb) - pos;
+    }
+
+    *len = (avail > span) ? span : (uint16_t)avail;
+    if (*len == 0) {
+        return (const char __far *)0;
+    }
+    p = tb_ptr(tb, phys, FALSE);
+    if (p == (const char __far *)0) {
+        *len = 0;
+    }
+    return p;
+}
+
+/*---------------------------------------------------------------------------
+ * tb_move_gap - Move the gap to a logical position
+ *
+ * Moving left shifts the text between pos and the gap up to the gap's
+ * end; moving right shifts the text after the gap down to its start.
+ *---------------------------------------------------------------------------*/
+void tb_move_gap(TextBuf *tb, uint32_t pos)
+{
+    uint32_t gap = tb->gap_end - tb->gap_start;
+
+    if (pos < tb->gap_start) {
+        move_block(tb, pos + gap, pos, tb->gap_start - pos);
+    } else if (pos > tb->gap_start) {
+        move_block(tb, tb->gap_start, tb->gap_end, pos - tb->gap_start);
+    } else {
+        return;
+    }
+
+    tb->gap_start = pos;
+    tb->gap_end = pos + gap;
+}
+
+/*---------------------------------------------------------------------------
+ * tb_insert - Insert text at pos
+ *---------------------------------------------------------------------------*/
+bool_t tb_insert(TextBuf *tb, uint32_t pos, const char __far *text, uint16_t len)
+{
+    if ((uint32_t)len > tb_free(tb)) {
+        return FALSE;
+    }
+
+    tb_move_gap(tb, pos);
+    if (!tb_write(tb, tb->gap_start, text, len)) {
+        return FALSE;
+    }
+    tb->gap_start += len;
+
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * tb_delete - Delete len bytes at pos (the gap just swallows them)
+ *---------------------------------------------------------------------------*/
+void tb_delete(TextBuf *tb, uint32_t pos, uint16_t len)
+{
+    uint32_t text_len = tb_length(tb);
+
+    if (pos >= text_len) {
+        return;
+    }
+    if ((uint32_t)len > text_len - pos) {
+        len = (uint16_t)(text_len - pos);
+    }
+
+    tb_move_gap(tb, pos);
+    tb->gap_end += len;
+}
+
+/*---------------------------------------------------------------------------
+ * li_init - Attach line index storage
+ *---------------------------------------------------------------------------*/
+void li_init(LineIndex *li, uint32_t __far *offs, uint16_t max)
+{
+    li->offs = offs;
+    li->max = max;
+    li->count = 1;
+    li->offs[0] = 0;
+}
+
+/*---------------------------------------------------------------------------
+ * li_resize - Storage was reallocated for max lines
+ *---------------------------------------------------------------------------*/
+void li_resize(LineIndex *li, uint32_t __far *offs, uint16_t max)
+{
+    li->offs = offs;
+    li->max = max;
+    if (li->count > max) {
+        li->count = max;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * li_build - Index every line of the text
+ *
+ * Scans the text a contiguous chunk at a time rather than going through
+ * tb_char_at() for every byte.
+ *---------------------------------------------------------------------------*/
+void li_build(LineIndex *li, const TextBuf *tb)
+{
+    const char __far *p;
+    uint32_t pos = 0;
+    uint16_t len;
+    uint16_t i;
+
+    li->offs[0] = 0;
+    li->count = 1;
+
+    for (;;) {
+        p = tb_chunk(tb, pos, &len);
+        if (len == 0) {
+            break;
+        }
+        for (i = 0; i < len && li->count < li->max; i++) {
+            if (p[i] == '\n') {
+                li->offs[li->count++] = pos + i + 1;
+            }
+        }
+        pos += len;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * li_find - Line containing pos (binary search)
+ *---------------------------------------------------------------------------*/
+uint16_t li_find(const LineIndex *li, uint32_t pos)
+{
+    uint16_t lo = 0;
+    uint16_t hi = li->count - 1;
+    uint16_t mid;
+
+    while (lo < hi) {
+        mid = (uint16_t)((lo + hi + 1) >> 1);
+        if (li->offs[mid] <= pos) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    return lo;
+}
+
+/*---------------------------------------------------------------------------
+ * splice_in - Insert a line start at index 'at'
+ *
+ * A full index drops its last entry, which matches what li_build keeps:
+ * the first max lines.
+ *---------------------------------------------------------------------------*/
+static void splice_in(LineIndex *li, uint16_t at, uint32_t off)
+{
+    uint16_t n;
+
+    if (at >= li->max) {
+        return;
+    }
+
+    n = (li->count < li->max) ? li->count - at : li->count - at - 1;
+    mem_move_far(&li->offs[at + 1], &li->offs[at], n * sizeof(uint32_t));
+    li->offs[at] = off;
+
+    if (li->count < li->max) {
+        li->count++;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * li_insert - Account for text inserted at pos
+ *
+ * Lines starting after pos move down by len.  Each newline in the new
+ * text adds a line start right after the line being edited, so a plain
+ * keystroke costs one pass over the offsets that follow, not a rescan
+ * of the text.
+ *---------------------------------------------------------------------------*/
+void li_insert(LineIndex *li, uint32_t pos, const char __far *text, uint16_t len)
+{
+    uint16_t line = li_find(li, pos);
+    uint16_t i;
+
+    for (i = line + 1; i < li->count; i++) {
+        li->offs[i] += len;
+    }
+
+    for (i = 0; i < len; i++) {
+        if (text[i] == '\n') {
+            line++;
+            splice_in(li, line, pos + i + 1);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * li_delete - Account for len bytes deleted at pos
+ *
+ * A line whose start lies in (pos, pos+len] lost the newline before it
+ * and is merged into its predecessor; later lines move up by len.
+ *---------------------------------------------------------------------------*/
+void li_delete(LineIndex *li, uint32_t pos, uint16_t len)
+{
+    uint16_t first = li_find(li, pos) + 1;
+    uint16_t last = first;
+    uint16_t i;
+
+    while (last < li->count && li->offs[last] <= pos + len) {
+        last++;
+    }
+
+    if (last > first) {
+        mem_move_far(&li->offs[first], &li->offs[last],
+                     (li->count - last) * sizeof(uint32_t));
+        li->count -= last - first;
+    }
+
+    for (i = first; i < li->count; i++) {
+        li->offs[i] -= len;
+    }
+}
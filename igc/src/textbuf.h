@@ -0,0 +1,127 @@
+/*
+ * textbuf.h - IGC Gap Buffer and Line Index
+ * Text storage for the editor; inserts and deletes happen at the gap
+ */
+
+#ifndef TEXTBUF_H
+#define TEXTBUF_H
+
+#include "igc.h"
+#include "swap.h"
+
+/*---------------------------------------------------------------------------
+ * Text Buffer Structure
+ * data holds the text before the gap, the gap, then the text after it.
+ * Positions in the API are logical (gap excluded).  The storage may span
+ * several 64KB segments; use tb_addr() rather than indexing data.
+ * A spilled buffer keeps its storage in swap pages instead of data; if
+ * the swap file loses a page the text can no longer be trusted and
+ * tb_failed() stays TRUE until the area is closed.
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    char __far *data;           /* Storage (far heap, may exceed 64KB) */
+    uint32_t size;              /* Capacity in bytes */
+    uint32_t gap_start;         /* First byte of gap = logical edit point */
+    uint32_t gap_end;           /* First byte after gap */
+    SwapArea *swap;             /* Storage when spilled, else NULL */
+} TextBuf;
+
+/* Text length and free space */
+#define tb_length(tb)   ((tb)->size - ((tb)->gap_end - (tb)->gap_start))
+#define tb_free(tb)     ((tb)->gap_end - (tb)->gap_start)
+
+/* A swap page of the text was lost: reads came back short, writes failed */
+#define tb_failed(tb)   ((tb)->swap != (SwapArea *)0 && (tb)->swap->failed)
+
+/*---------------------------------------------------------------------------
+ * Setup
+ *---------------------------------------------------------------------------*/
+
+/* Attach storage; the buffer starts empty */
+void tb_init(TextBuf *tb, char __far *data, uint32_t size);
+
+/* Empty the buffer */
+void tb_clear(TextBuf *tb);
+
+/* Text of len bytes was read straight into the storage; gap goes after it */
+void tb_set_length(TextBuf *tb, uint32_t len);
+
+/* Storage was reallocated to size bytes; the gap must be at the end of
+ * the text (tb_move_gap) and the text must fit */
+void tb_resize(TextBuf *tb, char __far *data, uint32_t size);
+
+/* Move the text into a swap area, which becomes the storage; data is
+ * left alone.  FALSE if the text does not fit or the swap fails. */
+bool_t tb_spill(TextBuf *tb, SwapArea *area);
+
+/* Far pointer to a physical offset in the storage (for loading); valid
+ * for tb_span() bytes.  NULL if the swap page is lost. */
+char __far *tb_addr(const TextBuf *tb, uint32_t phys);
+
+/* Bytes that can be reached from tb_addr(phys) in one piece */
+uint16_t tb_span(const TextBuf *tb, uint32_t phys);
+
+/* Copy len bytes into the storage at a physical offset; FALSE if a swap
+ * page is lost */
+bool_t tb_write(TextBuf *tb, uint32_t phys, const char __far *src, uint16_t len);
+
+/*---------------------------------------------------------------------------
+ * Access
+ *---------------------------------------------------------------------------*/
+
+/* Character at logical position ('\0' if its swap page is lost) */
+char tb_char_at(const TextBuf *tb, uint32_t pos);
+
+/* Copy up to len bytes from pos into dst, returns bytes copied (short
+ * if a swap page is lost) */
+uint16_t tb_copy_out(const TextBuf *tb, uint32_t pos, char __far *dst, uint16_t len);
+
+/* Contiguous run of text at pos (stops at the gap, the end, or 16KB, or
+ * a page end when spilled); sets *len, which is 0 at the end of the text
+ * or if the swap page is lost */
+const char __far *tb_chunk(const TextBuf *tb, uint32_t pos, uint16_t *len);
+
+/*---------------------------------------------------------------------------
+ * Editing
+ *---------------------------------------------------------------------------*/
+
+/* Move the gap to a logical position (one block move) */
+void tb_move_gap(TextBuf *tb, uint32_t pos);
+
+/* Insert text at pos, returns FALSE if there is no room or a swap page
+ * is lost */
+bool_t tb_insert(TextBuf *tb, uint32_t pos, const char __far *text, uint16_t len);
+
+/* Delete len bytes at pos */
+void tb_delete(TextBuf *tb, uint32_t pos, uint16_t len);
+
+/*---------------------------------------------------------------------------
+ * Line Index Structure
+ * offs[i] is the logical position where line i starts (offs[0] = 0).
+ * Built once on load, then kept up to date by li_insert/li_delete.
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    uint32_t __far *offs;       /* Line start offsets (far heap) */
+    uint16_t max;               /* Capacity in lines */
+    uint16_t count;             /* Lines indexed (at least 1) */
+} LineIndex;
+
+/* Attach storage for max lines; index holds one empty line */
+void li_init(LineIndex *li, uint32_t __far *offs, uint16_t max);
+
+/* Storage was reallocated for max lines; lines past max are dropped */
+void li_resize(LineIndex *li, uint32_t __far *offs, uint16_t max);
+
+/* Full scan of the text (load only); lines past max are not indexed */
+void li_build(LineIndex *li, const TextBuf *tb);
+
+/* Line containing logical position pos */
+uint16_t li_find(const LineIndex *li, uint32_t pos);
+
+/* Text of len bytes was inserted at pos: shift and splice in new lines */
+void li_insert(LineIndex *li, uint32_t pos, const char __far *text, uint16_t len);
+
+/* len bytes at pos are being deleted: splice out lines and shift */
+void li_delete(LineIndex *li, uint32_t pos, uint16_t len);
+
+#endif /* TEXTBUF_H */
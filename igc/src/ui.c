@@ -7,6 +7,8 @@
 #include "util.h"
 #include "mem.h"
 #include "dosapi.h"
+#include "dialog.h"
+#include "keyboard.h"
 
 /*---------------------------------------------------------------------------
  * Constants
@@ -407,3 +409,63 @@ void ui_hide_progress(void)
 {
     ui_clear_status();
 }
+
+/*---------------------------------------------------------------------------
+ * ui_show_memory - Show memory use by owner until a key is pressed
+ * The window's own save buffer is counted under Dialogs.
+ *---------------------------------------------------------------------------*/
+void ui_show_memory(void)
+{
+    DialogWindow win;
+    MemStats st;
+    char buf[40];
+    char num[16];
+    uint8_t i;
+
+    if (!dlg_open(&win, 22, 3, 36, 19, "Memory")) {
+        return;
+    }
+
+    mem_get_stats(&st);
+
+    dlg_print(&win, 1, 0, "Owner          In use       Peak");
+    for (i = 0; i < MEM_TAG_COUNT; i++) {
+        mem_format_row(buf, mem_get_tag_name(i),
+                       st.tag_bytes[i], st.tag_peak[i]);
+        dlg_print(&win, 1, 1 + i, buf);
+    }
+    mem_format_row(buf, "Total", st.bytes_in_use, st.peak_bytes);
+    dlg_print(&win, 1, 1 + MEM_TAG_COUNT, buf);
+
+    str_copy(buf, "Blocks ");
+    num_format(num, st.live);
+    str_copy(buf + str_len(buf), num);
+    str_copy(buf + str_len(buf), ", allocations ");
+    num_format(num, st.allocs);
+    str_copy(buf + str_len(buf), num);
+    dlg_print(&win, 1, 3 + MEM_TAG_COUNT, buf);
+
+    str_copy(buf, "Pools ");
+    num_format(num, st.pools);
+    str_copy(buf + str_len(buf), num);
+    str_copy(buf + str_len(buf), ", fragmentation ");
+    num_format(num, st.frag_pct);
+    str_copy(buf + str_len(buf), num);
+    str_copy(buf + str_len(buf), "%");
+    dlg_print(&win, 1, 4 + MEM_TAG_COUNT, buf);
+
+    str_copy(buf, "Held from DOS ");
+    num_format(num, (st.dos_bytes + 1023L) / 1024L);
+    str_copy(buf + str_len(buf), num);
+    str_copy(buf + str_len(buf), "KB, free ");
+    num_format(num, st.largest_free / 1024L);
+    str_copy(buf + str_len(buf), num);
+    str_copy(buf + str_len(buf), "KB");
+    dlg_print(&win, 1, 5 + MEM_TAG_COUNT, buf);
+
+    dlg_print_center(&win, 7 + MEM_TAG_COUNT, "Press any key");
+
+    kbd_flush();
+    kbd_wait();
+    dlg_close(&win);
+}
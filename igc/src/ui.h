@@ -74,4 +74,11 @@ void ui_show_progress(const char *title, const char *filename,
 /* Hide progress display */
 void ui_hide_progress(void);
 
+/*---------------------------------------------------------------------------
+ * Memory Display
+ *---------------------------------------------------------------------------*/
+
+/* Show memory use by owner until a key is pressed (M) */
+void ui_show_memory(void);
+
 #endif /* UI_H */
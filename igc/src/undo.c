@@ -0,0 +1,325 @@
+/*
+ * undo.c - IGC Editor Undo/Redo Log Implementation
+ *
+ * Each record is stored as
+ *
+ *     type(1) pos(4) len(2) bytes(len) size(2)
+ *
+ * The trailing size lets undo walk back from the top without an index.
+ * Records below g_top can be undone; those between g_top and g_end can
+ * be redone until a new edit discards them.  When space runs out the
+ * oldest records are dropped, so memory use never grows.
+ */
+
+#include "undo.h"
+#include "mem.h"
+#include "util.h"
+
+#define UNDO_HDR        7       /* type + pos + len */
+#define UNDO_TRL        2       /* trailing size */
+#define UNDO_OVERHEAD   (UNDO_HDR + UNDO_TRL)
+
+/*---------------------------------------------------------------------------
+ * Static variables
+ *---------------------------------------------------------------------------*/
+static char __far *g_ring = (char __far *)0;
+static uint16_t g_size = 0;
+static uint16_t g_head = 0;         /* Oldest record */
+static uint16_t g_top = 0;          /* End of newest undoable record */
+static uint16_t g_end = 0;          /* End of newest redoable record */
+static uint16_t g_used = 0;         /* Bytes from g_head to g_end */
+static uint16_t g_redo_bytes = 0;   /* Bytes from g_top to g_end */
+static uint16_t g_undo_n = 0;       /* Records that can be undone */
+static uint16_t g_redo_n = 0;       /* Records that can be redone */
+
+/* Typing group: the newest record can still absorb typed characters */
+static bool_t g_open = FALSE;
+static uint16_t g_open_at = 0;      /* Ring offset of that record */
+static uint32_t g_open_pos = 0;
+static uint16_t g_open_len = 0;
+
+/*---------------------------------------------------------------------------
+ * Ring helpers
+ *---------------------------------------------------------------------------*/
+static uint16_t ring_add(uint16_t at, uint16_t n)
+{
+    at += n;
+    return (at >= g_size) ? at - g_size : at;
+}
+
+static uint16_t ring_sub(uint16_t at, uint16_t n)
+{
+    return (at >= n) ? at - n : at + g_size - n;
+}
+
+static void ring_put(uint16_t at, const void __far *src, uint16_t n)
+{
+    uint16_t first = (n < g_size - at) ? n : g_size - at;
+
+    mem_copy_far(&g_ring[at], src, first);
+    if (n > first) {
+        mem_copy_far(g_ring, (const char __far *)src + first, n - first);
+    }
+}
+
+static void ring_get(uint16_t at, void __far *dst, uint16_t n)
+{
+    uint16_t first = (n < g_size - at) ? n : g_size - at;
+
+    mem_copy_far(dst, &g_ring[at], first);
+    if (n > first) {
+        mem_copy_far((char __far *)dst + first, g_ring, n - first);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * read_rec - Decode the record starting at 'at'
+ *---------------------------------------------------------------------------*/
+static void read_rec(uint16_t at, UndoRec *rec)
+{
+    uint16_t data_at;
+
+    ring_get(at, &rec->type, 1);
+    ring_get(ring_add(at, 1), &rec->pos, 4);
+    ring_get(ring_add(at, 5), &rec->len, 2);
+
+    data_at = ring_add(at, UNDO_HDR);
+    rec->text = &g_ring[data_at];
+    rec->text_len = (rec->len < g_size - data_at) ? rec->len : g_size - data_at;
+    rec->wrap = g_ring;
+}
+
+/*---------------------------------------------------------------------------
+ * drop_redo - A new edit makes the undone records unreachable
+ *---------------------------------------------------------------------------*/
+static void drop_redo(void)
+{
+    g_used -= g_redo_bytes;
+    g_redo_bytes = 0;
+    g_end = g_top;
+    g_redo_n = 0;
+}
+
+/*---------------------------------------------------------------------------
+ * drop_oldest - Discard the oldest record
+ *---------------------------------------------------------------------------*/
+static void drop_oldest(void)
+{
+    uint16_t len;
+    uint16_t size;
+
+    if (g_open && g_open_at == g_head) {
+        g_open = FALSE;
+    }
+
+    ring_get(ring_add(g_head, 5), &len, 2);
+    size = len + UNDO_OVERHEAD;
+
+    g_head = ring_add(g_head, size);
+    g_used -= size;
+    g_undo_n--;
+}
+
+/*---------------------------------------------------------------------------
+ * make_room - Drop old records until n bytes are free
+ *
+ * With keep_open set, the open typing record is never dropped.
+ *---------------------------------------------------------------------------*/
+static bool_t make_room(uint16_t n, bool_t keep_open)
+{
+    while (g_size - g_used < n && g_undo_n > 0) {
+        if (keep_open && g_open && g_open_at == g_head) {
+            return FALSE;
+        }
+        drop_oldest();
+    }
+    return (g_size - g_used >= n) ? TRUE : FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * begin_record - Append a record header/trailer, return data offset
+ *---------------------------------------------------------------------------*/
+static bool_t begin_record(uint8_t type, uint32_t pos, uint16_t len, uint16_t *data_at)
+{
+    uint32_t need = (uint32_t)len + UNDO_OVERHEAD;
+    uint16_t size = (uint16_t)need;
+    uint16_t at;
+
+    if (g_ring == (char __far *)0) {
+        return FALSE;
+    }
+
+    drop_redo();
+    g_open = FALSE;
+
+    /* Larger than the whole log: older history would be inconsistent */
+    if (need > g_size) {
+        undo_clear();
+        return FALSE;
+    }
+    make_room(size, FALSE);
+
+    at = g_top;
+    ring_put(at, &type, 1);
+    ring_put(ring_add(at, 1), &pos, 4);
+    ring_put(ring_add(at, 5), &len, 2);
+    *data_at = ring_add(at, UNDO_HDR);
+    ring_put(ring_add(*data_at, len), &size, UNDO_TRL);
+
+    g_top = g_end = ring_add(at, size);
+    g_used += size;
+    g_undo_n++;
+
+    g_open_at = at;
+    g_open_pos = pos;
+    g_open_len = len;
+
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * undo_init - Allocate the log
+ *---------------------------------------------------------------------------*/
+bool_t undo_init(uint16_t size)
+{
+    g_ring = (char __far *)mem_alloc(size, MEM_TAG_EDITOR);
+    if (g_ring == (char __far *)0) {
+        g_size = 0;
+        return FALSE;
+    }
+
+    g_size = size;
+    undo_clear();
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * undo_shutdown - Free the log
+ *---------------------------------------------------------------------------*/
+void undo_shutdown(void)
+{
+    if (g_ring != (char __far *)0) {
+        mem_free(g_ring);
+        g_ring = (char __far *)0;
+    }
+    g_size = 0;
+}
+
+/*---------------------------------------------------------------------------
+ * undo_clear - Forget all records
+ *---------------------------------------------------------------------------*/
+void undo_clear(void)
+{
+    g_head = g_top = g_end = 0;
+    g_used = 0;
+    g_redo_bytes = 0;
+    g_undo_n = g_redo_n = 0;
+    g_open = FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * undo_record_insert - Record inserted bytes
+ *
+ * A typed character right after the open record's text is appended to
+ * it in place: the trailer is overwritten by the new byte and rewritten
+ * after it, so a typed word costs one record, not one per key.
+ *---------------------------------------------------------------------------*/
+void undo_record_insert(uint32_t pos, const char __far *text, uint16_t len)
+{
+    uint16_t data_at;
+    uint16_t size;
+
+    if (len == 0 || g_ring == (char __far *)0) {
+        return;
+    }
+
+    if (g_open && len == 1 && g_redo_n == 0 &&
+        pos == g_open_pos + g_open_len && g_open_len < 0x7FFF &&
+        make_room(1, TRUE)) {
+        data_at = ring_add(g_open_at, UNDO_HDR + g_open_len);
+        ring_put(data_at, text, 1);
+        g_open_len++;
+        size = g_open_len + UNDO_OVERHEAD;
+        ring_put(ring_add(g_open_at, 5), &g_open_len, 2);
+        ring_put(ring_add(data_at, 1), &size, UNDO_TRL);
+        g_top = g_end = ring_add(g_open_at, size);
+        g_used++;
+    } else if (begin_record(UNDO_INSERT, pos, len, &data_at)) {
+        ring_put(data_at, text, len);
+        g_open = (len == 1) ? TRUE : FALSE;
+    }
+
+    /* A line ends the typing group */
+    if (text[len - 1] == '\n') {
+        g_open = FALSE;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * undo_record_delete - Record bytes about to be deleted
+ *---------------------------------------------------------------------------*/
+void undo_record_delete(const TextBuf *tb, uint32_t pos, uint16_t len)
+{
+    uint16_t data_at;
+    uint16_t first;
+
+    if (len == 0 || !begin_record(UNDO_DELETE, pos, len, &data_at)) {
+        return;
+    }
+
+    /* Copy straight from the text buffer into the ring */
+    first = (len < g_size - data_at) ? len : g_size - data_at;
+    tb_copy_out(tb, pos, &g_ring[data_at], first);
+    if (len > first) {
+        tb_copy_out(tb, pos + first, g_ring, len - first);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * undo_break - Close the typing group
+ *---------------------------------------------------------------------------*/
+void undo_break(void)
+{
+    g_open = FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * undo_pop - Step back one record
+ *---------------------------------------------------------------------------*/
+bool_t undo_pop(UndoRec *rec)
+{
+    uint16_t size;
+
+    if (g_undo_n == 0) {
+        return FALSE;
+    }
+
+    ring_get(ring_sub(g_top, UNDO_TRL), &size, UNDO_TRL);
+    g_top = ring_sub(g_top, size);
+    read_rec(g_top, rec);
+
+    g_redo_bytes += size;
+    g_undo_n--;
+    g_redo_n++;
+    g_open = FALSE;
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * redo_pop - Step forward one record
+ *---------------------------------------------------------------------------*/
+bool_t redo_pop(UndoRec *rec)
+{
+    if (g_redo_n == 0) {
+        return FALSE;
+    }
+
+    read_rec(g_top, rec);
+    g_top = ring_add(g_top, rec->len + UNDO_OVERHEAD);
+
+    g_redo_bytes -= rec->len + UNDO_OVERHEAD;
+    g_redo_n--;
+    g_undo_n++;
+    g_open = FALSE;
+    return TRUE;
+}
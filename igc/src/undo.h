@@ -0,0 +1,76 @@
+/*
+ * undo.h - IGC Editor Undo/Redo Log
+ * Bounded ring buffer of edit records; oldest records drop off when full
+ */
+
+#ifndef UNDO_H
+#define UNDO_H
+
+#include "igc.h"
+#include "textbuf.h"
+
+/*---------------------------------------------------------------------------
+ * Log Size (based on memory tier)
+ *---------------------------------------------------------------------------*/
+#define UNDO_BUF_TINY     1024
+#define UNDO_BUF_LOW      2048
+#define UNDO_BUF_MEDIUM   4096
+#define UNDO_BUF_HIGH     8192
+
+/*---------------------------------------------------------------------------
+ * Record Types
+ *---------------------------------------------------------------------------*/
+#define UNDO_INSERT     1       /* Bytes were inserted at pos */
+#define UNDO_DELETE     2       /* Bytes were deleted at pos */
+
+/*---------------------------------------------------------------------------
+ * Record (as handed back by undo_pop/redo_pop)
+ * The bytes live in the ring; if they wrap, the rest starts at 'wrap'.
+ * They stay valid until the next undo_record_* call.
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    uint8_t  type;                  /* UNDO_INSERT or UNDO_DELETE */
+    uint32_t pos;                   /* Logical position of the edit */
+    uint16_t len;                   /* Bytes inserted or deleted */
+    const char __far *text;         /* First run of the bytes */
+    uint16_t text_len;              /* Length of first run */
+    const char __far *wrap;         /* Remaining len - text_len bytes */
+} UndoRec;
+
+/*---------------------------------------------------------------------------
+ * Setup
+ *---------------------------------------------------------------------------*/
+
+/* Allocate the log (size bytes) */
+bool_t undo_init(uint16_t size);
+
+/* Free the log */
+void undo_shutdown(void);
+
+/* Forget all records (new file loaded) */
+void undo_clear(void);
+
+/*---------------------------------------------------------------------------
+ * Recording
+ *---------------------------------------------------------------------------*/
+
+/* Record an insert; consecutive typed characters join one record */
+void undo_record_insert(uint32_t pos, const char __far *text, uint16_t len);
+
+/* Record a delete; call before the bytes leave the buffer */
+void undo_record_delete(const TextBuf *tb, uint32_t pos, uint16_t len);
+
+/* End the current typing group (cursor moved, other command) */
+void undo_break(void);
+
+/*---------------------------------------------------------------------------
+ * Undo / Redo
+ *---------------------------------------------------------------------------*/
+
+/* Step back: returns the record to invert, FALSE if none */
+bool_t undo_pop(UndoRec *rec);
+
+/* Step forward: returns the record to apply again, FALSE if none */
+bool_t redo_pop(UndoRec *rec);
+
+#endif /* UNDO_H */
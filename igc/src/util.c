@@ -313,3 +313,125 @@ void mem_set_far(void __far *dst, uint8_t val, uint16_t count)
         *d++ = (char)val;
     }
 }
+
+/*---------------------------------------------------------------------------
+ * mem_move_far - Copy memory that may overlap (far pointers)
+ *
+ * One REP MOVS does the whole block.  When the destination lies above the
+ * source in the same segment the copy runs backwards (STD) so the source
+ * is not overwritten before it is read.
+ *---------------------------------------------------------------------------*/
+void mem_move_far(void __far *dst, const void __far *src, uint16_t count)
+{
+    if (count == 0) {
+        return;
+    }
+
+    _asm {
+        push    si
+        push    di
+        push    ds
+        mov     cx, count
+        les     di, dst
+        lds     si, src
+        mov     ax, es
+        mov     bx, ds
+        cmp     ax, bx
+        jne     mv_fwd
+        cmp     di, si
+        jbe     mv_fwd
+        add     si, cx
+        dec     si
+        add     di, cx
+        dec     di
+        std
+        rep     movsb
+        cld
+        jmp     mv_done
+    mv_fwd:
+        cld
+        shr     cx, 1
+        rep     movsw
+        adc     cx, cx
+        rep     movsb
+    mv_done:
+        pop     ds
+        pop     di
+        pop     si
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * CRC-32 lookup table (1KB, built on first use)
+ *---------------------------------------------------------------------------*/
+static uint32_t crc_table[256];
+static bool_t crc_table_ready = FALSE;
+
+static void crc32_build_table(void)
+{
+    uint32_t c;
+    uint16_t n;
+    uint8_t k;
+
+    for (n = 0; n < 256; n++) {
+        c = (uint32_t)n;
+        for (k = 0; k < 8; k++) {
+            if (c & 1) {
+                c = 0xEDB88320UL ^ (c >> 1);
+            } else {
+                c >>= 1;
+            }
+        }
+        crc_table[n] = c;
+    }
+    crc_table_ready = TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * crc32_update - Update running CRC-32 with a far buffer
+ *
+ * The inner loop keeps the CRC in DX:AX and walks the buffer with ES:SI,
+ * so each byte costs one table lookup, two word XORs and a byte shuffle -
+ * no 32-bit shifts through the C runtime.
+ *---------------------------------------------------------------------------*/
+uint32_t crc32_update(uint32_t crc, const void __far *buf, uint16_t len)
+{
+    const uint8_t __far *p = (const uint8_t __far *)buf;
+    uint16_t lo = (uint16_t)(crc & 0xFFFF);
+    uint16_t hi = (uint16_t)(crc >> 16);
+
+    if (!crc_table_ready) {
+        crc32_build_table();
+    }
+
+    if (len == 0) {
+        return crc;
+    }
+
+    _asm {
+        push    si
+        les     si, p
+        mov     cx, len
+        mov     ax, lo
+        mov     dx, hi
+    crc_next:
+        mov     bl, es:[si]
+        inc     si
+        xor     bl, al
+        xor     bh, bh
+        shl     bx, 1
+        shl     bx, 1
+        mov     al, ah
+        mov     ah, dl
+        mov     dl, dh
+        xor     dh, dh
+        xor     ax, word ptr crc_table[bx]
+        xor     dx, word ptr crc_table[bx+2]
+        loop    crc_next
+        mov     lo, ax
+        mov     hi, dx
+        pop     si
+    }
+
+    return ((uint32_t)hi << 16) | lo;
+}
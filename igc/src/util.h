@@ -81,4 +81,17 @@ void mem_copy_far(void __far *dst, const void __far *src, uint16_t count);
 /* Set memory (far) */
 void mem_set_far(void __far *dst, uint8_t val, uint16_t count);
 
+/* Copy memory that may overlap (far, block move) */
+void mem_move_far(void __far *dst, const void __far *src, uint16_t count);
+
+/*---------------------------------------------------------------------------
+ * CRC-32 (IEEE 802.3 polynomial, reflected)
+ *---------------------------------------------------------------------------*/
+
+/* Starting value for a running CRC */
+#define CRC32_INIT      0xFFFFFFFFUL
+
+/* Update running CRC-32 with a far buffer (table-driven, 8086 inner loop) */
+uint32_t crc32_update(uint32_t crc, const void __far *buf, uint16_t len);
+
 #endif /* UTIL_H */
@@ -0,0 +1,991 @@
+/*
+ * viewer.c - IGC Paged File Viewer Implementation
+ *
+ * Only a VIEW_WIN_SIZE window of the file is in memory; moving past it
+ * seeks and reads the next window.  While no key is waiting the viewer
+ * scans ahead and records a checkpoint every few lines, so a jump to a
+ * line only walks forward from the nearest checkpoint instead of from
+ * the top of the file.
+ *
+ * Hex mode needs no index at all: row n is always at offset n * 16, so
+ * paging and jumps are plain arithmetic and the file opens instantly.
+ */
+
+#include "viewer.h"
+#include "screen.h"
+#include "keyboard.h"
+#include "dosapi.h"
+#include "mem.h"
+#include "ui.h"
+#include "util.h"
+#include "dialog.h"
+#include "search.h"
+
+/*---------------------------------------------------------------------------
+ * Static Variables
+ *---------------------------------------------------------------------------*/
+static Viewer g_view;
+
+/* Last search (F or B, repeated by N) */
+static char g_find[SEARCH_MAX + 1];
+static bool_t g_find_back = FALSE;
+
+/* Glyph for each nibble of a hex byte */
+static const char g_nibble[16] = {
+    '0', '1', '2', '3', '4', '5', '6', '7',
+    '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+/* Hex row layout: offset, two groups of eight bytes, then the text */
+#define HEX_COL_BYTES   10
+#define HEX_COL_TEXT    60
+#define HEX_ROW_LEN     76
+
+/* Byte at a file offset; back = TRUE when scanning towards the start */
+#define VIEW_BYTE(off, back) \
+    (((uint32_t)(off) - g_view.win_off < g_view.win_len) ? \
+     g_view.win[(uint16_t)((off) - g_view.win_off)] : view_load((off), (back)))
+
+/*---------------------------------------------------------------------------
+ * view_load - Read the window around off, return the byte there
+ *
+ * Scanning backwards the window is placed to end at off, so the bytes
+ * before it are in memory for the next steps.
+ *---------------------------------------------------------------------------*/
+static char view_load(uint32_t off, bool_t back)
+{
+    uint32_t start = off;
+    int16_t n;
+
+    if (back) {
+        start = (off + 1 > VIEW_WIN_SIZE) ? off + 1 - VIEW_WIN_SIZE : 0;
+    }
+
+    g_view.win_off = start;
+    g_view.win_len = 0;
+    if (dos_seek(g_view.handle, (int32_t)start, DOS_SEEK_SET) >= 0) {
+        n = dos_read(g_view.handle, g_view.win, VIEW_WIN_SIZE);
+        if (n > 0) {
+            g_view.win_len = (uint16_t)n;
+        }
+    }
+
+    /* Read error: treat as a line end so scans stop */
+    if (off - start >= g_view.win_len) {
+        return '\n';
+    }
+    return g_view.win[(uint16_t)(off - start)];
+}
+
+/*---------------------------------------------------------------------------
+ * next_line - Start of the line after the one at off
+ *---------------------------------------------------------------------------*/
+static uint32_t next_line(uint32_t off)
+{
+    while (off < g_view.size) {
+        if (VIEW_BYTE(off, FALSE) == '\n') {
+            return (off + 1 < g_view.size) ? off + 1 : VIEW_NONE;
+        }
+        off++;
+    }
+    return VIEW_NONE;
+}
+
+/*---------------------------------------------------------------------------
+ * line_start - Start of the line containing off
+ *---------------------------------------------------------------------------*/
+static uint32_t line_start(uint32_t off)
+{
+    while (off > 0 && VIEW_BYTE(off - 1, TRUE) != '\n') {
+        off--;
+    }
+    return off;
+}
+
+/*---------------------------------------------------------------------------
+ * prev_line - Start of the line before the one at off
+ *---------------------------------------------------------------------------*/
+static uint32_t prev_line(uint32_t off)
+{
+    return (off == 0) ? VIEW_NONE : line_start(off - 1);
+}
+
+/*---------------------------------------------------------------------------
+ * cp_interval - Lines between checkpoints
+ *---------------------------------------------------------------------------*/
+static uint32_t cp_interval(void)
+{
+    return (uint32_t)VIEW_CP_LINES << g_view.cp_shift;
+}
+
+/*---------------------------------------------------------------------------
+ * add_checkpoint - Record the start of line scan_lines
+ *---------------------------------------------------------------------------*/
+static void add_checkpoint(uint32_t off)
+{
+    uint16_t i;
+
+    /* Table full: keep every other entry and double the spacing */
+    if (g_view.cp_count == VIEW_CP_MAX) {
+        for (i = 1; i < VIEW_CP_MAX / 2; i++) {
+            g_view.cp[i] = g_view.cp[i * 2];
+        }
+        g_view.cp_count = VIEW_CP_MAX / 2;
+        g_view.cp_shift++;
+    }
+
+    if ((g_view.scan_lines & (cp_interval() - 1)) == 0) {
+        g_view.cp[g_view.cp_count++] = off;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * scan_slice - Index the next VIEW_SCAN_CHUNK bytes
+ * Returns FALSE when there is nothing left to index.
+ *---------------------------------------------------------------------------*/
+static bool_t scan_slice(void)
+{
+    int16_t n;
+    uint16_t i;
+    uint32_t mask;
+
+    if (g_view.scan_done) {
+        return FALSE;
+    }
+
+    n = -1;
+    if (dos_seek(g_view.handle, (int32_t)g_view.scan_off, DOS_SEEK_SET) >= 0) {
+        n = dos_read(g_view.handle, g_view.scan_buf, VIEW_SCAN_CHUNK);
+    }
+    if (n <= 0) {
+        g_view.scan_done = TRUE;
+        return FALSE;
+    }
+
+    mask = cp_interval() - 1;
+    for (i = 0; i < (uint16_t)n; i++) {
+        if (g_view.scan_buf[i] == '\n' && g_view.scan_off + i + 1 < g_view.size) {
+            g_view.scan_lines++;
+            if ((g_view.scan_lines & mask) == 0) {
+                add_checkpoint(g_view.scan_off + i + 1);
+                mask = cp_interval() - 1;
+            }
+        }
+    }
+
+    g_view.scan_off += (uint16_t)n;
+    if (g_view.scan_off >= g_view.size) {
+        g_view.scan_done = TRUE;
+    }
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * resolve_line - Find the line number of top_off from the checkpoints
+ * Only possible once the indexer has passed top_off.
+ *---------------------------------------------------------------------------*/
+static bool_t resolve_line(void)
+{
+    uint16_t lo = 0;
+    uint16_t hi = g_view.cp_count - 1;
+    uint16_t mid;
+    uint32_t off;
+    uint32_t line;
+
+    if (g_view.line_known) {
+        return TRUE;
+    }
+    if (g_view.top_off > g_view.scan_off) {
+        return FALSE;
+    }
+
+    /* Last checkpoint at or before top_off */
+    while (lo < hi) {
+        mid = (uint16_t)((lo + hi + 1) >> 1);
+        if (g_view.cp[mid] <= g_view.top_off) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    /* Count the lines from there */
+    line = (uint32_t)lo * cp_interval();
+    for (off = g_view.cp[lo]; off < g_view.top_off; off++) {
+        if (VIEW_BYTE(off, FALSE) == '\n') {
+            line++;
+        }
+    }
+
+    g_view.top_line = line;
+    g_view.line_known = TRUE;
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * layout - Find the offsets of the visible lines
+ *---------------------------------------------------------------------------*/
+static void layout(void)
+{
+    uint16_t i;
+    uint32_t off;
+
+    if (g_view.hex) {
+        off = g_view.top_off;
+        for (i = 0; i <= EDIT_ROWS; i++) {
+            g_view.rows[i] = (off < g_view.size) ? off : VIEW_NONE;
+            off += VIEW_HEX_BYTES;
+        }
+        return;
+    }
+
+    g_view.rows[0] = g_view.top_off;
+    for (i = 1; i <= EDIT_ROWS; i++) {
+        g_view.rows[i] = (g_view.rows[i - 1] == VIEW_NONE) ?
+                         VIEW_NONE : next_line(g_view.rows[i - 1]);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * hex_format - Write v as eight hex digits
+ *---------------------------------------------------------------------------*/
+static void hex_format(char *buf, uint32_t v)
+{
+    uint16_t i;
+
+    for (i = 8; i > 0; i--) {
+        buf[i - 1] = g_nibble[(uint8_t)v & 0x0F];
+        v >>= 4;
+    }
+    buf[8] = '\0';
+}
+
+/*---------------------------------------------------------------------------
+ * hex_row_bytes - Bytes of the hex row at off, from the window
+ *
+ * Rows above the window reload it to end at the row, so scrolling back
+ * reads a window's worth at a time, as scrolling forward does.
+ *---------------------------------------------------------------------------*/
+static const uint8_t __far *hex_row_bytes(uint32_t off, uint16_t *n)
+{
+    uint32_t left = g_view.size - off;
+    uint16_t want = (left < VIEW_HEX_BYTES) ? (uint16_t)left : VIEW_HEX_BYTES;
+
+    if (off < g_view.win_off) {
+        view_load(off + want - 1, TRUE);
+    } else if (off - g_view.win_off + want > g_view.win_len) {
+        view_load(off, FALSE);
+    }
+
+    /* Short read: show what arrived */
+    *n = 0;
+    if (off >= g_view.win_off && off - g_view.win_off < g_view.win_len) {
+        *n = g_view.win_len - (uint16_t)(off - g_view.win_off);
+        if (*n > want) {
+            *n = want;
+        }
+    }
+    return (const uint8_t __far *)g_view.win + (uint16_t)(off - g_view.win_off);
+}
+
+/*---------------------------------------------------------------------------
+ * hex_last_top - Top row offset that shows the last screenful
+ *---------------------------------------------------------------------------*/
+static uint32_t hex_last_top(void)
+{
+    uint32_t rows = (g_view.size + VIEW_HEX_BYTES - 1) / VIEW_HEX_BYTES;
+
+    return (rows > EDIT_ROWS) ? (rows - EDIT_ROWS) * VIEW_HEX_BYTES : 0;
+}
+
+/*---------------------------------------------------------------------------
+ * draw_status_bar - Draw status bar at top
+ *---------------------------------------------------------------------------*/
+static void draw_status_bar(void)
+{
+    char buf[80];
+    uint16_t i;
+    uint32_t pct;
+
+    scr_fill_rect(0, 0, 80, 1, ' ', ATTR_DIM_REV);
+
+    /* Left: filename */
+    str_copy(buf, " ");
+    str_copy_n(buf + 1, g_view.filename, 40);
+    str_copy(buf + str_len(buf), g_view.hex ? " [Hex]" : " [View]");
+    scr_puts_xy(0, 0, buf, ATTR_DIM_REV);
+
+    /* Right: line (or offset), position, indexing progress */
+    buf[0] = g_view.hex ? 'O' : 'L';
+    buf[1] = ':';
+    if (g_view.hex) {
+        hex_format(&buf[2], g_view.top_off);
+    } else if (g_view.line_known) {
+        num_format(&buf[2], g_view.top_line + 1);
+    } else {
+        str_copy(&buf[2], "?");
+    }
+    i = str_len(buf);
+    buf[i++] = ' ';
+
+    if (g_view.size == 0) {
+        pct = 100;
+    } else if (g_view.size > 0x01000000UL) {
+        pct = g_view.top_off / (g_view.size / 100);
+    } else {
+        pct = g_view.top_off * 100 / g_view.size;
+    }
+    num_format_simple(&buf[i], pct);
+    str_copy(buf + str_len(buf), "%");
+
+    if (!g_view.scan_done && !g_view.hex) {
+        str_copy(buf + str_len(buf), " Indexing");
+    }
+    scr_puts_xy(80 - str_len(buf) - 1, 0, buf, ATTR_DIM_REV);
+}
+
+/*---------------------------------------------------------------------------
+ * draw_help_bar - Draw help bar at bottom
+ *---------------------------------------------------------------------------*/
+static void draw_help_bar(void)
+{
+    scr_fill_rect(0, 24, 80, 1, ' ', ATTR_DIM);
+    scr_puts_xy(0, 24, "7Exit   ", ATTR_DIM_REV);
+    scr_puts_xy(11, 24, "G GoTo  ", ATTR_DIM_REV);
+    scr_puts_xy(22, 24, "F Find  ", ATTR_DIM_REV);
+    scr_puts_xy(33, 24, "N Next  ", ATTR_DIM_REV);
+    scr_puts_xy(44, 24, g_view.hex ? "H Text  " : "H Hex   ", ATTR_DIM_REV);
+}
+
+/*---------------------------------------------------------------------------
+ * draw_hex_row - Draw one hex row
+ *
+ * The row is built in one pass over its bytes, each costing two nibble
+ * lookups and a text glyph, then written with a single scr_puts_xy.
+ *---------------------------------------------------------------------------*/
+static void draw_hex_row(uint16_t row)
+{
+    uint8_t y = EDIT_TOP_ROW + row;
+    uint32_t off = g_view.rows[row];
+    const uint8_t __far *p;
+    char line[HEX_ROW_LEN + 1];
+    char *h;
+    char *t;
+    uint16_t n;
+    uint16_t i;
+    uint8_t b;
+
+    scr_fill_rect(0, y, 80, 1, ' ', ATTR_DIM);
+
+    if (off == VIEW_NONE) {
+        scr_putc_xy(0, y, '~', ATTR_DIM);
+        return;
+    }
+
+    p = hex_row_bytes(off, &n);
+
+    hex_format(line, off);
+    for (i = 8; i < HEX_ROW_LEN; i++) {
+        line[i] = ' ';
+    }
+    line[HEX_ROW_LEN] = '\0';
+
+    h = &line[HEX_COL_BYTES];
+    t = &line[HEX_COL_TEXT];
+    for (i = 0; i < n; i++) {
+        b = p[i];
+        h[0] = g_nibble[b >> 4];
+        h[1] = g_nibble[b & 0x0F];
+        h += (i == 7) ? 4 : 3;
+        *t++ = (b >= 32 && b < 127) ? (char)b : '.';
+    }
+    scr_puts_xy(EDIT_LEFT_COL, y, line, ATTR_DIM);
+
+    /* Search hit or jump target */
+    for (i = 0; i < n; i++) {
+        if (off + i - g_view.match_off < g_view.match_len) {
+            h = &line[HEX_COL_BYTES + i * 3 + (i > 7 ? 1 : 0)];
+            scr_putc_xy(EDIT_LEFT_COL + (uint8_t)(h - line), y, h[0], ATTR_DIM_REV);
+            scr_putc_xy(EDIT_LEFT_COL + (uint8_t)(h - line) + 1, y, h[1], ATTR_DIM_REV);
+            scr_putc_xy(EDIT_LEFT_COL + HEX_COL_TEXT + i, y, line[HEX_COL_TEXT + i],
+                        ATTR_DIM_REV);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * draw_row - Draw one screen row
+ *---------------------------------------------------------------------------*/
+static void draw_row(uint16_t row)
+{
+    uint8_t y = EDIT_TOP_ROW + row;
+    uint32_t start = g_view.rows[row];
+    uint32_t end;
+    uint32_t off;
+    uint8_t attr;
+    char c;
+
+    if (g_view.hex) {
+        draw_hex_row(row);
+        return;
+    }
+
+    scr_fill_rect(0, y, 80, 1, ' ', ATTR_DIM);
+
+    if (start == VIEW_NONE) {
+        scr_putc_xy(0, y, '~', ATTR_DIM);
+        return;
+    }
+
+    end = start + g_view.left_col + EDIT_COLS;
+    if (end > g_view.size) {
+        end = g_view.size;
+    }
+
+    for (off = start; off < end; off++) {
+        c = VIEW_BYTE(off, FALSE);
+        if (c == '\n') {
+            break;
+        }
+        if (off - start < g_view.left_col) {
+            continue;
+        }
+        if (c == '\t' || c == '\r') c = ' ';
+        if (c < 32) c = '.';
+        attr = (off - g_view.match_off < g_view.match_len) ? ATTR_DIM_REV : ATTR_DIM;
+        scr_putc_xy(EDIT_LEFT_COL + (uint8_t)(off - start - g_view.left_col), y, c, attr);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * draw_screen - Lay out and draw the whole view
+ *---------------------------------------------------------------------------*/
+static void draw_screen(void)
+{
+    uint16_t i;
+
+    layout();
+    for (i = 0; i < EDIT_ROWS; i++) {
+        draw_row(i);
+    }
+
+    draw_status_bar();
+    draw_help_bar();
+}
+
+/*---------------------------------------------------------------------------
+ * go_end - Show the last screenful of the file
+ *---------------------------------------------------------------------------*/
+static void go_end(void)
+{
+    uint32_t off;
+    uint16_t back = 0;
+
+    if (g_view.hex) {
+        g_view.top_off = hex_last_top();
+        return;
+    }
+
+    off = (g_view.size > 0) ? line_start(g_view.size - 1) : 0;
+    while (back < EDIT_ROWS - 1 && off > 0) {
+        off = prev_line(off);
+        back++;
+    }
+
+    g_view.top_off = off;
+    if (g_view.scan_done) {
+        g_view.top_line = g_view.scan_lines - back;
+        g_view.line_known = TRUE;
+    } else {
+        g_view.line_known = FALSE;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * line_up - Scroll up one line
+ *---------------------------------------------------------------------------*/
+static bool_t line_up(void)
+{
+    if (g_view.top_off == 0) {
+        return FALSE;
+    }
+
+    if (g_view.hex) {
+        g_view.top_off -= VIEW_HEX_BYTES;
+        return TRUE;
+    }
+
+    g_view.top_off = prev_line(g_view.top_off);
+    if (g_view.line_known) {
+        g_view.top_line--;
+    }
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * page_down - Scroll down one screen (rows must be laid out)
+ *---------------------------------------------------------------------------*/
+static void page_down(void)
+{
+    if (g_view.rows[EDIT_ROWS] == VIEW_NONE) {
+        return;
+    }
+
+    g_view.top_off = g_view.rows[EDIT_ROWS];
+    g_view.top_line += EDIT_ROWS;
+
+    /* Do not leave a partial last page */
+    layout();
+    if (g_view.rows[EDIT_ROWS - 1] == VIEW_NONE) {
+        go_end();
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * go_line - Show line (0-based), indexing up to it first
+ *---------------------------------------------------------------------------*/
+static void go_line(uint32_t line)
+{
+    uint32_t interval;
+    uint32_t off;
+    uint32_t next;
+    uint32_t cur;
+    uint16_t idx;
+
+    if (!g_view.scan_done && line > g_view.scan_lines) {
+        ui_status("Indexing...");
+        while (line > g_view.scan_lines && scan_slice()) {
+            if (kbd_check()) {
+                kbd_flush();
+                break;
+            }
+        }
+    }
+    if (line > g_view.scan_lines) {
+        line = g_view.scan_lines;
+    }
+
+    /* Nearest checkpoint, then walk forward */
+    interval = cp_interval();
+    idx = (uint16_t)(line / interval);
+    if (idx >= g_view.cp_count) {
+        idx = g_view.cp_count - 1;
+    }
+    off = g_view.cp[idx];
+    cur = (uint32_t)idx * interval;
+    while (cur < line) {
+        next = next_line(off);
+        if (next == VIEW_NONE) {
+            break;
+        }
+        off = next;
+        cur++;
+    }
+
+    g_view.top_off = off;
+    g_view.top_line = cur;
+    g_view.line_known = TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ * go_percent - Show the line at pct percent of the file
+ *---------------------------------------------------------------------------*/
+static void go_percent(uint32_t pct)
+{
+    uint32_t off;
+
+    if (pct > 100) {
+        pct = 100;
+    }
+    if (g_view.size > 0x01000000UL) {
+        off = g_view.size / 100 * pct;
+    } else {
+        off = g_view.size * pct / 100;
+    }
+    if (off >= g_view.size) {
+        go_end();
+        return;
+    }
+
+    g_view.top_off = line_start(off);
+    g_view.line_known = FALSE;
+    resolve_line();
+}
+
+/*---------------------------------------------------------------------------
+ * show_offset - Bring the row or line holding off to the top
+ *---------------------------------------------------------------------------*/
+static void show_offset(uint32_t off)
+{
+    if (g_view.hex) {
+        g_view.top_off = off - off % VIEW_HEX_BYTES;
+        if (g_view.top_off > hex_last_top()) {
+            g_view.top_off = hex_last_top();
+        }
+        return;
+    }
+
+    g_view.top_off = line_start(off);
+    g_view.line_known = FALSE;
+    resolve_line();
+}
+
+/*---------------------------------------------------------------------------
+ * go_offset - Ask for a hex offset or NN% and jump there (hex mode)
+ *
+ * The byte at the offset is highlighted like a search hit, and the next
+ * search starts from it.
+ *---------------------------------------------------------------------------*/
+static void go_offset(void)
+{
+    char buf[12];
+    uint32_t n = 0;
+    uint16_t i;
+    char c;
+
+    buf[0] = '\0';
+    if (dlg_input("Go To", "Hex offset or percent (50%):", buf, 10) != DLG_OK) {
+        return;
+    }
+
+    for (i = 0; buf[i] >= '0' && buf[i] <= '9'; i++) {
+        n = n * 10 + (buf[i] - '0');
+    }
+    if (i > 0 && buf[i] == '%') {
+        if (n > 100) {
+            n = 100;
+        }
+        n = (g_view.size > 0x01000000UL) ? g_view.size / 100 * n
+                                          : g_view.size * n / 100;
+    } else {
+        n = 0;
+        for (i = 0; buf[i] != '\0'; i++) {
+            c = char_upper(buf[i]);
+            if (c >= '0' && c <= '9') {
+                n = (n << 4) | (uint32_t)(c - '0');
+            } else if (c >= 'A' && c <= 'F') {
+                n = (n << 4) | (uint32_t)(c - 'A' + 10);
+            } else {
+                break;
+            }
+        }
+        if (i == 0) {
+            return;
+        }
+    }
+
+    if (g_view.size == 0) {
+        return;
+    }
+    if (n >= g_view.size) {
+        n = g_view.size - 1;
+    }
+    g_view.match_off = n;
+    g_view.match_len = 1;
+    show_offset(n);
+}
+
+/*---------------------------------------------------------------------------
+ * go_to - Ask for a line number or NN% and jump there
+ *---------------------------------------------------------------------------*/
+static void go_to(void)
+{
+    char buf[12];
+    uint32_t n = 0;
+    uint16_t i;
+
+    if (g_view.hex) {
+        go_offset();
+        return;
+    }
+
+    buf[0] = '\0';
+    if (dlg_input("Go To", "Line or percent (50%):", buf, 10) != DLG_OK) {
+        return;
+    }
+
+    for (i = 0; buf[i] >= '0' && buf[i] <= '9'; i++) {
+        n = n * 10 + (buf[i] - '0');
+    }
+    if (i == 0) {
+        return;
+    }
+
+    if (buf[i] == '%') {
+        go_percent(n);
+    } else {
+        go_line(n > 0 ? n - 1 : 0);
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * find_next - Search the file for the last pattern (N)
+ *
+ * Starts after the previous hit if it is on the top line, otherwise at
+ * the top line, and streams through the file in SEARCH_CHUNK reads.
+ *---------------------------------------------------------------------------*/
+static void find_next(void)
+{
+    SearchPat sp;
+    SearchSrc src;
+    uint32_t at = g_view.top_off;
+    uint32_t hit;
+
+    if (!search_prepare(&sp, g_find, search_ignore_case(g_find), g_find_back)) {
+        return;
+    }
+    src.tb = (const TextBuf *)0;
+    src.handle = g_view.handle;
+
+    if (g_view.match_off != VIEW_NONE && g_view.match_off >= g_view.top_off &&
+        (g_view.rows[1] == VIEW_NONE || g_view.match_off < g_view.rows[1])) {
+        at = g_view.match_off + (g_find_back ? 0 : 1);
+    }
+
+    ui_status("Searching...");
+    if (!g_find_back) {
+        hit = search_range(&sp, &src, at, g_view.size);
+    } else {
+        hit = search_range(&sp, &src, 0,
+                           (at + sp.len - 1 < g_view.size) ? at + sp.len - 1 : g_view.size);
+    }
+    kbd_flush();
+
+    if (hit == SEARCH_NOT_FOUND) {
+        ui_status("Not found");
+        return;
+    }
+
+    ui_clear_status();
+    g_view.match_off = hit;
+    g_view.match_len = sp.len;
+    show_offset(hit);
+}
+
+/*---------------------------------------------------------------------------
+ * find - Ask for a pattern and search (F forward, B backward)
+ *---------------------------------------------------------------------------*/
+static void find(bool_t backward)
+{
+    int result;
+
+    result = dlg_input(backward ? "Find Backward" : "Find", "Text:",
+                       g_find, SEARCH_MAX + 1);
+    draw_screen();
+
+    if (result == DLG_OK && g_find[0] != '\0') {
+        g_find_back = backward;
+        find_next();
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * toggle_hex - Switch between text lines and hex rows (H)
+ *---------------------------------------------------------------------------*/
+static void toggle_hex(void)
+{
+    g_view.hex = !g_view.hex;
+
+    if (g_view.hex) {
+        g_view.top_off -= g_view.top_off % VIEW_HEX_BYTES;
+    } else {
+        g_view.top_off = line_start(g_view.top_off);
+        g_view.line_known = FALSE;
+        resolve_line();
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * viewer_run - Main viewer loop
+ *---------------------------------------------------------------------------*/
+static void viewer_run(void)
+{
+    KeyEvent key;
+    bool_t running = TRUE;
+    bool_t was_done;
+    uint16_t i;
+
+    draw_screen();
+
+    while (running) {
+        /* Index in the background while no key is waiting (text only) */
+        was_done = g_view.scan_done;
+        while (!g_view.hex && !kbd_check() && scan_slice()) {
+            if (!g_view.line_known && resolve_line()) {
+                draw_status_bar();
+            }
+        }
+        if (g_view.scan_done != was_done) {
+            draw_status_bar();
+        }
+
+        key = kbd_wait();
+
+        if (key.type == KEY_ASCII) {
+            switch (key.code) {
+                case KEY_ESC:
+                    running = FALSE;
+                    break;
+                case 'g':
+                case 'G':
+                    go_to();
+                    draw_screen();
+                    break;
+                case 'f':
+                case 'F':
+                case '/':
+                    find(FALSE);
+                    draw_screen();
+                    break;
+                case 'b':
+                case 'B':
+                case '?':
+                    find(TRUE);
+                    draw_screen();
+                    break;
+                case 'n':
+                case 'N':
+                    find_next();
+                    draw_screen();
+                    break;
+                case 'h':
+                case 'H':
+                    toggle_hex();
+                    draw_screen();
+                    break;
+            }
+        } else if (key.type == KEY_EXTENDED) {
+            switch (key.code) {
+                case KEY_UP:
+                    if (line_up()) {
+                        draw_screen();
+                    }
+                    break;
+                case KEY_DOWN:
+                    if (g_view.rows[EDIT_ROWS] != VIEW_NONE) {
+                        g_view.top_off = g_view.rows[1];
+                        g_view.top_line++;
+                        draw_screen();
+                    }
+                    break;
+                case KEY_PGUP:
+                    for (i = 0; i < EDIT_ROWS && line_up(); i++) {
+                    }
+                    draw_screen();
+                    break;
+                case KEY_PGDN:
+                    page_down();
+                    draw_screen();
+                    break;
+                case KEY_LEFT:
+                    if (g_view.left_col > 0) {
+                        g_view.left_col = (g_view.left_col > 8) ? g_view.left_col - 8 : 0;
+                        draw_screen();
+                    }
+                    break;
+                case KEY_RIGHT:
+                    if (g_view.left_col < 1024) {
+                        g_view.left_col += 8;
+                        draw_screen();
+                    }
+                    break;
+                case KEY_HOME:
+                    g_view.top_off = 0;
+                    g_view.top_line = 0;
+                    g_view.line_known = TRUE;
+                    g_view.left_col = 0;
+                    draw_screen();
+                    break;
+                case KEY_END:
+                    go_end();
+                    draw_screen();
+                    break;
+                case KEY_F3:
+                case KEY_F7:
+                case KEY_F10:
+                    running = FALSE;
+                    break;
+            }
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * viewer_is_binary - Check the start of a file for binary content
+ *
+ * Text files may hold tabs, line ends, form feeds and a trailing ^Z;
+ * any NUL, or more than a few other control bytes, means binary.
+ *---------------------------------------------------------------------------*/
+bool_t viewer_is_binary(dos_handle_t handle)
+{
+    uint8_t buf[VIEW_SNIFF_SIZE];
+    int16_t n;
+    uint16_t i;
+    uint16_t odd = 0;
+
+    if (dos_seek(handle, 0L, DOS_SEEK_SET) < 0) {
+        return FALSE;
+    }
+    n = dos_read(handle, buf, VIEW_SNIFF_SIZE);
+
+    for (i = 0; (int16_t)i < n; i++) {
+        if (buf[i] == 0) {
+            return TRUE;
+        }
+        if (buf[i] < 32 && buf[i] != '\t' && buf[i] != '\r' &&
+            buf[i] != '\n' && buf[i] != '\f' && buf[i] != 0x1A) {
+            odd++;
+        }
+    }
+    return (n > 0 && odd > (uint16_t)n / 16) ? TRUE : FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ * viewer_show - View a file of any size
+ *---------------------------------------------------------------------------*/
+bool_t viewer_show(const char *filename, bool_t hex)
+{
+    bool_t ok = FALSE;
+
+    g_view.handle = dos_open(filename, DOS_OPEN_READ);
+    if (g_view.handle < 0) {
+        return FALSE;
+    }
+
+    g_view.win = (char __far *)mem_alloc(VIEW_WIN_SIZE, MEM_TAG_VIEWER);
+    g_view.scan_buf = (char __far *)mem_alloc(VIEW_SCAN_CHUNK, MEM_TAG_VIEWER);
+    g_view.cp = (uint32_t __far *)mem_alloc((uint32_t)VIEW_CP_MAX * sizeof(uint32_t),
+                                            MEM_TAG_VIEWER);
+
+    if (g_view.win != (char __far *)0 &&
+        g_view.scan_buf != (char __far *)0 &&
+        g_view.cp != (uint32_t __far *)0) {
+        str_copy_n(g_view.filename, filename, sizeof(g_view.filename) - 1);
+        g_view.size = dos_file_size(g_view.handle);
+        g_view.win_off = 0;
+        g_view.win_len = 0;
+        g_view.cp[0] = 0;
+        g_view.cp_count = 1;
+        g_view.cp_shift = 0;
+        g_view.scan_off = 0;
+        g_view.scan_lines = 0;
+        g_view.scan_done = (g_view.size == 0) ? TRUE : FALSE;
+        g_view.hex = hex;
+        g_view.top_off = 0;
+        g_view.top_line = 0;
+        g_view.line_known = TRUE;
+        g_view.left_col = 0;
+        g_view.match_off = VIEW_NONE;
+        g_view.match_len = 0;
+
+        viewer_run();
+        ok = TRUE;
+    }
+
+    if (g_view.cp != (uint32_t __far *)0) mem_free(g_view.cp);
+    if (g_view.scan_buf != (char __far *)0) mem_free(g_view.scan_buf);
+    if (g_view.win != (char __far *)0) mem_free(g_view.win);
+    dos_close(g_view.handle);
+
+    return ok;
+}
@@ -0,0 +1,72 @@
+/*
+ * viewer.h - IGC Paged File Viewer
+ * Views files too large for the editor buffer through a small window,
+ * and binary files as hex
+ */
+
+#ifndef VIEWER_H
+#define VIEWER_H
+
+#include "igc.h"
+#include "editor.h"
+#include "dosapi.h"
+
+/*---------------------------------------------------------------------------
+ * Viewer Sizes (fixed: memory use does not depend on file size)
+ *---------------------------------------------------------------------------*/
+#define VIEW_WIN_SIZE     4096      /* File bytes held for display */
+#define VIEW_SCAN_CHUNK   1024      /* Bytes indexed per idle slice */
+#define VIEW_CP_MAX       512       /* Line checkpoint table entries */
+#define VIEW_CP_LINES     64        /* Initial lines between checkpoints */
+#define VIEW_HEX_BYTES    16        /* File bytes per hex row */
+#define VIEW_SNIFF_SIZE   256       /* Bytes checked for binary content */
+
+#define VIEW_NONE         0xFFFFFFFFUL  /* No such line */
+
+/*---------------------------------------------------------------------------
+ * Viewer Structure
+ * cp[i] is the file offset of line i * (VIEW_CP_LINES << cp_shift).  When
+ * the table fills, every other entry is dropped and the spacing doubles.
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    dos_handle_t handle;            /* Open file */
+    uint32_t size;                  /* File size */
+
+    char __far *win;                /* Window of file bytes */
+    uint32_t win_off;               /* File offset of win[0] */
+    uint16_t win_len;               /* Valid bytes in win */
+
+    char __far *scan_buf;           /* Indexer read buffer */
+    uint32_t __far *cp;             /* Line checkpoints */
+    uint16_t cp_count;              /* Checkpoints stored */
+    uint8_t  cp_shift;              /* Spacing is VIEW_CP_LINES << cp_shift */
+    uint32_t scan_off;              /* Bytes indexed so far */
+    uint32_t scan_lines;            /* Line starts found after line 0 */
+    bool_t   scan_done;             /* Whole file indexed */
+
+    bool_t   hex;                   /* Hex rows instead of text lines */
+    uint32_t top_off;               /* File offset of first visible line */
+    uint32_t top_line;              /* Its line number (if line_known) */
+    bool_t   line_known;            /* FALSE after a jump past the index */
+    uint16_t left_col;              /* Left column for horizontal scroll */
+    uint32_t rows[EDIT_ROWS + 1];   /* Line offsets on screen, then next */
+
+    uint32_t match_off;             /* Last search hit (VIEW_NONE if none) */
+    uint8_t  match_len;             /* Its length, for highlighting */
+
+    char     filename[80];          /* File being viewed */
+} Viewer;
+
+/*---------------------------------------------------------------------------
+ * Viewer Operations
+ *---------------------------------------------------------------------------*/
+
+/* TRUE if the start of an open file looks binary rather than text */
+bool_t viewer_is_binary(dos_handle_t handle);
+
+/* View a file of any size, as hex rows if hex is TRUE (caller
+ * saves/restores the screen); returns FALSE if the file cannot be
+ * opened or memory is short */
+bool_t viewer_show(const char *filename, bool_t hex);
+
+#endif /* VIEWER_H */